@@ -10,6 +10,10 @@ ReactiveArray::ReactiveArray(std::weak_ptr<Environment> env, const CompositeKey&
    
 }
 
+ReactiveArray::ReactiveArray(std::weak_ptr<Environment> env, const CompositeKey& key,
+                             std::vector<std::shared_ptr<VarValue>> data)
+    : environment(env), arrayKey(key), arrayData(std::move(data)) {}
+
 void ReactiveArray::setKey(const CompositeKey& newKey) { arrayKey = newKey; }
     
 const std::string& ReactiveArray::getName() const { return name; }
@@ -24,7 +28,7 @@ void ReactiveArray::push(const std::shared_ptr<VarValue>& value) {
         if (envPtr->hasVariable(arrayKey)) {
             envPtr->markDirty(arrayKey);
         }
-        std::cout << "[ReactiveArray] push: Added value to array '" << envPtr->getCompositeName(arrayKey) << "'.\n";
+        envPtr->logStream() << "[ReactiveArray] push: Added value to array '" << envPtr->getCompositeName(arrayKey) << "'.\n";
     } else {
         throw std::runtime_error("Invalid weak_ptr to Environment in ReactiveArray::push.");
     }
@@ -38,7 +42,7 @@ std::shared_ptr<VarValue> ReactiveArray::pop() {
         auto value = arrayData.back();
         arrayData.pop_back();
         envPtr->markDirty(arrayKey);
-        std::cout << "[ReactiveArray] pop: Removed value from array '" << envPtr->getCompositeName(arrayKey) << "'.\n";
+        envPtr->logStream() << "[ReactiveArray] pop: Removed value from array '" << envPtr->getCompositeName(arrayKey) << "'.\n";
         return value;
     } else {
         throw std::runtime_error("Invalid weak_ptr to Environment in ReactiveArray::pop.");
@@ -56,7 +60,7 @@ void ReactiveArray::splice(int index, int deleteCount, const std::vector<std::sh
         arrayData.erase(begin, end);
         arrayData.insert(begin, values.begin(), values.end());
         envPtr->markDirty(arrayKey);
-        std::cout << "[ReactiveArray] splice: Modified array '" << envPtr->getCompositeName(arrayKey) << "'.\n";
+        envPtr->logStream() << "[ReactiveArray] splice: Modified array '" << envPtr->getCompositeName(arrayKey) << "'.\n";
     } else {
         throw std::runtime_error("Invalid weak_ptr to Environment in ReactiveArray::splice.");
     }
@@ -82,7 +86,7 @@ void ReactiveArray::set(int index, const std::shared_ptr<VarValue>& value) {
         if (envPtr->hasVariable(arrayKey)) {
             envPtr->markDirty(arrayKey);
         }
-        std::cout << "[ReactiveArray] set: Updated index " << index << " in array '" << envPtr->getCompositeName(arrayKey) << "'.\n";
+        envPtr->logStream() << "[ReactiveArray] set: Updated index " << index << " in array '" << envPtr->getCompositeName(arrayKey) << "'.\n";
     } else {
         throw std::runtime_error("Invalid weak_ptr to Environment in ReactiveArray::set.");
     }
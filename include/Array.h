@@ -16,6 +16,9 @@ namespace JTMLInterpreter {
 class ReactiveArray {
 public:
     ReactiveArray(std::weak_ptr<Environment> env, const CompositeKey& key);
+    // Starting out with `data` (built for a copy: nothing is notified)
+    ReactiveArray(std::weak_ptr<Environment> env, const CompositeKey& key,
+                  std::vector<std::shared_ptr<VarValue>> data);
 
     // Array methods
     void push(const std::shared_ptr<VarValue>& value);
@@ -10,6 +10,10 @@ ReactiveDict::ReactiveDict(std::weak_ptr<Environment> env, const CompositeKey& k
   
     }
 
+ReactiveDict::ReactiveDict(std::weak_ptr<Environment> env, const CompositeKey& key,
+                           std::unordered_map<std::string, std::shared_ptr<VarValue>> data)
+    : environment(std::move(env)), dictKey(key), dictData(std::move(data)) {}
+
 void ReactiveDict::setKey(const CompositeKey& newKey) { dictKey = newKey; }
     
 const std::string& ReactiveDict::getName() const { return name; }
@@ -23,7 +27,7 @@ void ReactiveDict::set(const std::string& dictKeyName, const std::shared_ptr<Var
     if (auto envPtr = environment.lock()) {
         if (envPtr->hasVariable(dictKey)) {
             envPtr->markDirty(dictKey);
-            std::cout << "[ReactiveDict] set: Set key '" << dictKeyName << "' in dict '" << envPtr->getCompositeName(dictKey) << "'.\n";
+            envPtr->logStream() << "[ReactiveDict] set: Set key '" << dictKeyName << "' in dict '" << envPtr->getCompositeName(dictKey) << "'.\n";
         }
     } else {
         throw std::runtime_error("Environment is no longer valid");
@@ -34,9 +38,9 @@ void ReactiveDict::deleteKey(const std::string& dictKeyName) {
     if (auto envPtr = environment.lock()) {
         if (dictData.erase(dictKeyName) > 0) {
             envPtr->markDirty(dictKey);
-            std::cout << "[ReactiveDict] deleteKey: Deleted key '" << dictKeyName << "' from dict '" << envPtr->getCompositeName(dictKey) << "'.\n";
+            envPtr->logStream() << "[ReactiveDict] deleteKey: Deleted key '" << dictKeyName << "' from dict '" << envPtr->getCompositeName(dictKey) << "'.\n";
         } else {
-            std::cerr << "[ReactiveDict] deleteKey: Key '" << dictKeyName << "' not found in dict '" << envPtr->getCompositeName(dictKey) << "'.\n";
+            envPtr->errorStream() << "[ReactiveDict] deleteKey: Key '" << dictKeyName << "' not found in dict '" << envPtr->getCompositeName(dictKey) << "'.\n";
         }
     } else {
         throw std::runtime_error("Environment is no longer valid");
@@ -15,6 +15,9 @@ class Environment;
 class ReactiveDict {
 public:
     ReactiveDict(std::weak_ptr<Environment> env, const CompositeKey& key);
+    // Starting out with `data` (built for a copy: nothing is notified)
+    ReactiveDict(std::weak_ptr<Environment> env, const CompositeKey& key,
+                 std::unordered_map<std::string, std::shared_ptr<VarValue>> data);
     
     // Dictionary methods
     void set(const std::string& dictKey, const std::shared_ptr<VarValue>& value);
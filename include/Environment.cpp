@@ -11,14 +11,101 @@ namespace JTMLInterpreter {
 
 
 Environment::Environment(std::shared_ptr<Environment> parentEnv, size_t id, Renderer* rend)
-    : parent(parentEnv), instanceID(id), renderer(rend) {}
+    : parent(parentEnv), instanceID(id), renderer(rend),
+      logOut(parentEnv ? parentEnv->logOut : &std::cout),
+      errorOut(parentEnv ? parentEnv->errorOut : &std::cerr) {}
 
 void Environment::setRenderer(Renderer* rend) {
     this->renderer = rend;
 }
 
-std::unordered_map<std::string, std::vector<BindingInfo>> Environment::getBindings() {
-    return bindings;
+void Environment::setLogStreams(std::ostream& log, std::ostream& errors) {
+    logOut = &log;
+    errorOut = &errors;
+}
+
+std::shared_ptr<Environment> Environment::fork(Renderer* rend) const {
+    auto forked = std::make_shared<Environment>(parent, instanceID, rend);
+    forked->base = shared_from_this();
+    forked->setLogStreams(*logOut, *errorOut);
+    forked->structure = structure;
+    return forked;
+}
+
+Environment::Structure& Environment::mutableGraph() {
+    if (structure.use_count() > 1) {
+        structure = std::make_shared<Structure>(*structure);
+    }
+    return *structure;
+}
+
+std::shared_ptr<Environment::VarInfo> Environment::findVariable(const CompositeKey& key) const {
+    auto it = variables.find(key);
+    if (it != variables.end()) {
+        return it->second;
+    }
+    return base ? base->findVariable(key) : nullptr;
+}
+
+std::shared_ptr<Environment::VarInfo> Environment::ownVariable(const CompositeKey& key, bool copyValue) {
+    auto it = variables.find(key);
+    if (it != variables.end()) {
+        return it->second;
+    }
+    std::shared_ptr<VarInfo> shared = base ? base->findVariable(key) : nullptr;
+    if (!shared) {
+        return nullptr;
+    }
+    auto info = std::make_shared<VarInfo>();
+    info->kind = shared->kind;
+    info->expression = shared->expression;
+    info->dependencies = shared->dependencies;
+    info->currentValue = copyValue ? copyIn(shared->currentValue) : shared->currentValue;
+    variables[key] = info;
+    return info;
+}
+
+std::shared_ptr<VarValue> Environment::copyIn(const std::shared_ptr<VarValue>& value) {
+    if (!value) {
+        return value;
+    }
+    if (value->isArray()) {
+        auto array = value->getArray();
+        std::vector<std::shared_ptr<VarValue>> items;
+        items.reserve(array->getArrayData().size());
+        for (const auto& item : array->getArrayData()) {
+            items.push_back(copyIn(item));
+        }
+        return std::make_shared<VarValue>(
+            std::make_shared<ReactiveArray>(weak_from_this(), array->getKey(), std::move(items)));
+    }
+    if (value->isDict()) {
+        auto dict = value->getDict();
+        std::unordered_map<std::string, std::shared_ptr<VarValue>> fields;
+        for (const auto& [name, field] : dict->getDictData()) {
+            fields.emplace(name, copyIn(field));
+        }
+        return std::make_shared<VarValue>(
+            std::make_shared<ReactiveDict>(weak_from_this(), dict->getKey(), std::move(fields)));
+    }
+    if (value->isObject()) {
+        const ObjectHandle& handle = value->getObjectHandle();
+        if (!handle.instanceEnv) {
+            return value;
+        }
+        // The instance now resolves outer names through this environment
+        ObjectHandle copy;
+        copy.instanceEnv = handle.instanceEnv->fork(renderer);
+        if (copy.instanceEnv->parent && copy.instanceEnv->parent.get() == base.get()) {
+            copy.instanceEnv->parent = shared_from_this();
+        }
+        return std::make_shared<VarValue>(std::move(copy));
+    }
+    return value;
+}
+
+const std::unordered_map<std::string, std::vector<BindingInfo>>& Environment::getBindings() const {
+    return graph().bindings;
 }
 
 bool Environment::isGlobalEnvironment() const {
@@ -40,6 +127,14 @@ std::shared_ptr<VarValue> Environment::getVariable(const CompositeKey& key) cons
     if (it != variables.end()) {
         return it->second->currentValue;
     }
+    if (auto shared = base ? base->findVariable(key) : nullptr) {
+        // Whatever can be changed in place becomes this fork's own first
+        const auto& value = shared->currentValue;
+        if (value && (value->isArray() || value->isDict() || value->isObject())) {
+            return mutable_cast()->ownVariable(key)->currentValue;
+        }
+        return value;
+    }
     auto parentEnv = parent;
     while (parentEnv) {
         CompositeKey parentKey = { parentEnv->instanceID, key.varName };
@@ -49,23 +144,34 @@ std::shared_ptr<VarValue> Environment::getVariable(const CompositeKey& key) cons
     throw std::runtime_error("Undefined variable: " + getCompositeName(key));
 }
 
+std::shared_ptr<VarValue> Environment::peekVariable(const CompositeKey& key) const {
+    if (auto info = findVariable(key)) {
+        return info->currentValue;
+    }
+    if (parent) {
+        return parent->peekVariable({ parent->instanceID, key.varName });
+    }
+    throw std::runtime_error("Undefined variable: " + getCompositeName(key));
+}
+
 // Variable Assignment
 void Environment::setVariable(const CompositeKey& key, std::shared_ptr<VarValue> value) {
-    auto it = variables.find(key);
+    // A fork takes its own copy of the variable (the value is replaced anyway)
+    auto info = ownVariable(key, false);
     VarID varID = getVarID(key);
 
-    if (it != variables.end()) {
-        it->second->currentValue = value;
+    if (info) {
+        info->currentValue = value;
         notifySubscribers(varID);
         markDirty(key);
-        std::cout << "[DEBUG] Set variable '" << getCompositeName(key) << "' = " << value->toString() << "\n";
+        logStream() << "[DEBUG] Set variable '" << getCompositeName(key) << "' = " << value->toString() << "\n";
         return;
     }
 
     if (parent && parent->hasVariable(key)) {
         CompositeKey parentKey = { parent->instanceID, key.varName };
         parent->setVariable(parentKey, value);
-        std::cout << "[DEBUG] Set variable '" << getCompositeName(key) << "' = " << value->toString() << "\n";
+        logStream() << "[DEBUG] Set variable '" << getCompositeName(key) << "' = " << value->toString() << "\n";
         return;
     }
 
@@ -77,18 +183,25 @@ void Environment::setVariable(const CompositeKey& key, std::shared_ptr<VarValue>
     if (value->isArray()) {
         auto array = value->getArray();
         array->setKey(key);
-        std::cout << "[DEBUG] Assigned name '" << getCompositeName(array->getKey()) << "' to ReactiveArray\n";
+        logStream() << "[DEBUG] Assigned name '" << getCompositeName(array->getKey()) << "' to ReactiveArray\n";
     }
 
     if (value->isDict()) {
         auto dict = value->getDict();
         dict->setKey(key); // Update dict's internal key
-        std::cout << "[DEBUG] Assigned name '" << getCompositeName(dict ->getKey()) << "' to ReactiveDict\n";
+        logStream() << "[DEBUG] Assigned name '" << getCompositeName(dict ->getKey()) << "' to ReactiveDict\n";
     }
 
     variables[key] = varInfo;
 
-    std::cout << "[DEBUG] Defined variable '" << getCompositeName(key) << "' = " << value->toString() << "\n";
+    logStream() << "[DEBUG] Defined variable '" << getCompositeName(key) << "' = " << value->toString() << "\n";
+}
+
+void Environment::defineLocal(const CompositeKey& key, std::shared_ptr<VarValue> value) {
+    auto varInfo = std::make_shared<VarInfo>();
+    varInfo->kind = VarKind::Normal;
+    varInfo->currentValue = std::move(value);
+    variables[key] = varInfo;
 }
 
 // Data Bindings
@@ -96,8 +209,8 @@ void Environment::registerBinding(const BindingInfo& binding) {
 std::lock_guard<std::mutex> lock(bindingMutex);
 
 // Register the binding in the current environment
-bindings[binding.varName.varName].push_back(binding);
-std::cout << "[DEBUG] Binding registered: VarName=" << binding.varName.varName
+mutableGraph().bindings[binding.varName.varName].push_back(binding);
+logStream() << "[DEBUG] Binding registered: VarName=" << binding.varName.varName
             << ", ElementID=" << binding.elementId
             << ", Attribute=" << binding.attribute
             << ", BindingType=" << binding.bindingType << "\n";
@@ -106,9 +219,9 @@ std::cout << "[DEBUG] Binding registered: VarName=" << binding.varName.varName
 auto parentEnv = parent;
 while (parentEnv) {
     std::lock_guard<std::mutex> parentLock(parentEnv->bindingMutex);
-    parentEnv->bindings[binding.varName.varName].push_back(binding);
+    parentEnv->mutableGraph().bindings[binding.varName.varName].push_back(binding);
 
-    std::cout << "[DEBUG] Binding propagated to parent environment: VarName=" 
+    logStream() << "[DEBUG] Binding propagated to parent environment: VarName=" 
                 << binding.varName.varName << "\n";
 
     parentEnv = parentEnv->parent;
@@ -128,22 +241,22 @@ void Environment::deriveVariable(const CompositeKey& key,
         throw std::runtime_error("Cyclic dependency detected while deriving variable '" + getCompositeName(key) + "'");
     }
 
-    auto it = variables.find(key);
-    if (it != variables.end()) {
+    auto existing = findVariable(key);
+    if (existing) {
         // Allow redefinition only if there are no existing dependencies
-        if (it->second->kind == VarKind::Derived && !it->second->dependencies.empty()) {
+        if (existing->kind == VarKind::Derived && !existing->dependencies.empty()) {
             throw std::runtime_error("Cannot redefine derived variable '" + getCompositeName(key) + "' with existing dependencies.");
         }
 
         // Remove existing dependencies
-        for (const auto& depKey : it->second->dependencies) {
+        for (const auto& depKey : existing->dependencies) {
             removeDependency(depKey, key);
         }
 
         // Clear existing subscriptions
-        eventSubscribers.erase(getVarID(key));
+        mutableGraph().eventSubscribers.erase(getVarID(key));
 
-        std::cout << "[REDEFINE] " << getCompositeName(key) << " as Derived\n";
+        logStream() << "[REDEFINE] " << getCompositeName(key) << " as Derived\n";
     }
 
     // Create or redefine the derived variable
@@ -152,7 +265,7 @@ void Environment::deriveVariable(const CompositeKey& key,
     info->expression = std::move(expr);
     info->dependencies = std::move(deps);
 
-    std::cout <<"[DEBUG] Derived variable expression: " << info->expression->toString() << "\n"; 
+    logStream() <<"[DEBUG] Derived variable expression: " << info->expression->toString() << "\n"; 
 
     try {
         // Evaluate the initial value of the derived variable using the provided evaluator
@@ -170,59 +283,61 @@ void Environment::deriveVariable(const CompositeKey& key,
         // Propagate subscriptions from the derived variable to its dependencies
         VarID varID = getVarID(key);
         VarID depID = getVarID(dep);
-        for (const auto& [funcName, subID] : functionSubscriptions[varID]) {
-            auto callbackIt = eventSubscribers[varID].find(subID);
-            if (callbackIt != eventSubscribers[varID].end()) {
-                    CompositeKey depKey = idToKey[depID];
+        Structure& g = mutableGraph();
+        for (const auto& [funcName, subID] : g.functionSubscriptions[varID]) {
+            auto callbackIt = g.eventSubscribers[varID].find(subID);
+            if (callbackIt != g.eventSubscribers[varID].end()) {
+                    CompositeKey depKey = g.idToKey[depID];
                     subscribeToVariable(depKey, funcName, callbackIt->second);
             } else {
-                std::cout << "Callback not found for SubscriptionID " + std::to_string(subID) << "\n";
+                logStream() << "Callback not found for SubscriptionID " + std::to_string(subID) << "\n";
         }
     }
     }
     // Initial calculation
     markDirty(key);
 
-    std::cout << "[DERIVE] " << getCompositeName(key) << " = " 
+    logStream() << "[DERIVE] " << getCompositeName(key) << " = " 
             << (info->currentValue ? info->currentValue->toString() : "undefined") << "\n";
 }
 
 void Environment::unbindVariable(const CompositeKey& key) {
-    auto it = variables.find(key);
-    if (it == variables.end()) {
+    auto info = ownVariable(key);
+    if (!info) {
         throw std::runtime_error("Attempted to unbind undefined variable '" + key.varName + "'");
     }
 
     VarID varID = getVarID(key);
-    eventSubscribers.erase(varID);
+    mutableGraph().eventSubscribers.erase(varID);
 
-    if (it->second->kind == VarKind::Derived) {
+    if (info->kind == VarKind::Derived) {
         // Remove dependencies if it's a derived variable
-        for (const auto& depKey : it->second->dependencies) {
+        for (const auto& depKey : info->dependencies) {
             removeDependency(depKey, key);
         }
 
-        it->second->kind = VarKind::Normal;
-        it->second->dependencies.clear();
-        it->second->expression.reset();  // Clear the derived expression
+        info->kind = VarKind::Normal;
+        info->dependencies.clear();
+        info->expression.reset();  // Clear the derived expression
         clearDirty(varID);
 
-        std::cout << "[UNBIND] Derived variable '" << getCompositeName(key)
-                    << "' (retains value: " << it->second->currentValue->toString() << ")\n";
+        logStream() << "[UNBIND] Derived variable '" << getCompositeName(key)
+                    << "' (retains value: " << info->currentValue->toString() << ")\n";
     } else {
         // For normal variables, just remove subscriptions
-        std::cout << "[UNBIND] Normal variable '" << getCompositeName(key)
+        logStream() << "[UNBIND] Normal variable '" << getCompositeName(key)
                     << "' (retains value if any)\n";
     }
 
     // Remove outgoing dependencies
-    for (const auto& depVarID : adjacency[varID]) {
-        CompositeKey depKey = idToKey[depVarID];
+    const DependencyList dependents = graph().adjacency[varID];
+    for (const auto& depVarID : dependents) {
+        CompositeKey depKey = graph().idToKey[depVarID];
         removeDependency(depKey, key);
     }
 
     // Clear all outgoing dependencies for this variable
-    reverseAdjacency[varID].clear();
+    mutableGraph().reverseAdjacency[varID].clear();
 }
 
 // Dependency Tracking
@@ -232,34 +347,37 @@ std::string Environment::getCompositeName(const CompositeKey& key) const {
 
 // Dependency Tracking
 VarID Environment::getVarID(const CompositeKey& key) const {
-    auto it = nameToId.find(key);
-    if (it != nameToId.end()) {
+    auto it = graph().nameToId.find(key);
+    if (it != graph().nameToId.end()) {
         return it->second;
     }
     // Assign new ID
-    VarID newID = idToKey.size();
-    mutable_cast()->nameToId[key] = newID;
-    mutable_cast()->idToKey.emplace_back(key);
-    mutable_cast()->adjacency.emplace_back(); 
-    mutable_cast()->reverseAdjacency.emplace_back();
+    Structure& g = mutable_cast()->mutableGraph();
+    VarID newID = g.idToKey.size();
+    g.nameToId[key] = newID;
+    g.idToKey.emplace_back(key);
+    g.adjacency.emplace_back(); 
+    g.reverseAdjacency.emplace_back();
     return newID;
 }
 
 void Environment::addDependency(const CompositeKey& dependency, const CompositeKey& dependent) {
     VarID depID = getVarID(dependency);
     VarID depntID = getVarID(dependent);
-    adjacency[depID].push_back(depntID);
-    reverseAdjacency[depntID].push_back(depID);
+    Structure& g = mutableGraph();
+    g.adjacency[depID].push_back(depntID);
+    g.reverseAdjacency[depntID].push_back(depID);
 }
 
 void Environment::removeDependency(const CompositeKey& dependency, const CompositeKey& dependent) {
     VarID depID = getVarID(dependency);
     VarID depntID = getVarID(dependent);
 
-    auto& depList = adjacency[depID];
+    Structure& g = mutableGraph();
+    auto& depList = g.adjacency[depID];
     depList.erase(std::remove(depList.begin(), depList.end(), depntID), depList.end());
 
-    auto& revDepList = reverseAdjacency[depntID];
+    auto& revDepList = g.reverseAdjacency[depntID];
     revDepList.erase(std::remove(revDepList.begin(), revDepList.end(), depID), revDepList.end());
 }
 
@@ -267,8 +385,8 @@ void Environment::removeDependency(const CompositeKey& dependency, const Composi
 // Function Lookup
 std::shared_ptr<Function> Environment::getFunction(const CompositeKey& key) const {
     std::lock_guard<std::mutex> lock(envMutex);
-    auto it = functions.find(key);
-    if (it != functions.end()) {
+    auto it = graph().functions.find(key);
+    if (it != graph().functions.end()) {
         return it->second;
     }
     
@@ -285,11 +403,11 @@ std::shared_ptr<Function> Environment::getFunction(const CompositeKey& key) cons
 // Function Definition
 void Environment::defineFunction(const CompositeKey& key, std::shared_ptr<Function> func) {
     std::lock_guard<std::mutex> lock(envMutex);
-    if (functions.find(key) != functions.end()) {
+    if (graph().functions.find(key) != graph().functions.end()) {
         throw std::runtime_error("Function already defined: " + key.varName + " (InstanceID: " + std::to_string(key.instanceID) + ")");
     }
-    functions[key] = func;
-    std::cout << "[DEBUG] Defined function '" << key.varName << "' in InstanceID " << key.instanceID << "\n";
+    mutableGraph().functions[key] = func;
+    logStream() << "[DEBUG] Defined function '" << key.varName << "' in InstanceID " << key.instanceID << "\n";
 }
 
 // Event System: Subscribe to variable changes
@@ -300,24 +418,25 @@ SubscriptionID Environment::subscribeFunctionToVariable(
     std::function<void()> callback
 ) {
     VarID varID = getVarID(key);
+    Structure& g = mutableGraph();
 
     // Check if the function is already subscribed to this varID
-    auto varSubsIt = functionSubscriptions.find(varID);
-    if (varSubsIt != functionSubscriptions.end()) {
+    auto varSubsIt = g.functionSubscriptions.find(varID);
+    if (varSubsIt != g.functionSubscriptions.end()) {
         auto& funcSubs = varSubsIt->second;
         if (funcSubs.find(funcName) != funcSubs.end()) {
             // Already subscribed – skip
-            std::cout << "[SUBSCRIBE] Skipped duplicate subscription for '"
+            logStream() << "[SUBSCRIBE] Skipped duplicate subscription for '"
                         << funcName << "' to variable '" << getCompositeName(key) << "'\n";
             return funcSubs[funcName]; 
         }
     }
 
     // Otherwise, create a new subscription
-    SubscriptionID id = nextSubscriptionID++;
-    eventSubscribers[varID][id] = callback;
-    functionSubscriptions[varID][funcName] = id;
-    std::cout << "[SUBSCRIBE] Function '" << funcName 
+    SubscriptionID id = g.nextSubscriptionID++;
+    g.eventSubscribers[varID][id] = callback;
+    g.functionSubscriptions[varID][funcName] = id;
+    logStream() << "[SUBSCRIBE] Function '" << funcName 
                 << "' subscribed to variable '" << getCompositeName(key) 
                 << "' with SubscriptionID " << id << "\n";
     return id;
@@ -332,6 +451,7 @@ void Environment::subscribeToVariable(const CompositeKey& key,
 
 void Environment::unsubscribeFunctionFromVariable(const CompositeKey& key, const std::string& funcName) {
     VarID varID = getVarID(key);
+    auto& functionSubscriptions = mutableGraph().functionSubscriptions;
     auto varSubsIt = functionSubscriptions.find(varID);
     if (varSubsIt != functionSubscriptions.end()) {
         auto& funcSubs = varSubsIt->second;
@@ -343,36 +463,38 @@ void Environment::unsubscribeFunctionFromVariable(const CompositeKey& key, const
             return;
         }
     }
-    std::cerr << "[UNSUBSCRIBE ERROR] Function '" << funcName
+    errorStream() << "[UNSUBSCRIBE ERROR] Function '" << funcName
                 << "' not found for variable '" << getCompositeName(key) << "'\n";
 }
 
 void Environment::unsubscribeFromVariable(VarID varID, SubscriptionID id) {
+    const auto& idToKey = graph().idToKey;
+    auto& eventSubscribers = mutableGraph().eventSubscribers;
     auto varIt = eventSubscribers.find(varID);
     if (varIt != eventSubscribers.end()) {
         auto& subscribers = varIt->second;
         auto subIt = subscribers.find(id);
         if (subIt != subscribers.end()) {
             subscribers.erase(subIt);
-            std::cout << "[UNSUBSCRIBE] Removed subscription ID " 
+            logStream() << "[UNSUBSCRIBE] Removed subscription ID " 
                         << id << " from variable '" << idToKey[varID] << "'\n";
             return;
         }
     }
-    std::cerr << "[UNSUBSCRIBE ERROR] Subscription ID "
+    errorStream() << "[UNSUBSCRIBE ERROR] Subscription ID "
                 << id << " not found for variable '" << idToKey[varID] << "'\n";
 }
 // Trigger callbacks for a variable
 void Environment::notifySubscribers(VarID varID) {
-    auto varIt = eventSubscribers.find(varID);
-    if (varIt != eventSubscribers.end()) {
+    auto varIt = graph().eventSubscribers.find(varID);
+    if (varIt != graph().eventSubscribers.end()) {
         // Copy to allow safe iteration even if subscribers are modified
         auto subscribersCopy = varIt->second;
         for (const auto& [id, callback] : subscribersCopy) {
             try {
                 callback();
             } catch (const std::exception& e) {
-                std::cerr << "[ERROR] Callback execution failed for SubscriptionID "
+                errorStream() << "[ERROR] Callback execution failed for SubscriptionID "
                             << id << ": " << e.what() << "\n";
             }
         }
@@ -383,27 +505,31 @@ void Environment::notifySubscribers(VarID varID) {
 void Environment::notifySubscribersRecursive(VarID varID) {
     notifySubscribers(varID);
 
-    for (VarID dependent : adjacency[varID]) {
+    for (VarID dependent : graph().adjacency[varID]) {
         notifySubscribers(dependent);
     }
     // Propagate to parent environment if needed
-    if (parent && parent->nameToId.count(idToKey[varID])) {
-        parent->notifySubscribers(parent->getVarID(idToKey[varID]));
+    const CompositeKey& key = graph().idToKey[varID];
+    if (parent && parent->graph().nameToId.count(key)) {
+        parent->notifySubscribers(parent->getVarID(key));
     }
 }
 
 void Environment::emitEvents(VarID varID) {
     notifySubscribersRecursive(varID);
 
-    CompositeKey key = idToKey[varID];
-    auto it = bindings.find(key.varName);
-    if (it != bindings.end()) {
-    std::shared_ptr<VarValue> val = variables[key]->currentValue;
+    CompositeKey key = graph().idToKey[varID];
+    auto it = graph().bindings.find(key.varName);
+    if (it != graph().bindings.end()) {
+    auto info = findVariable(key);
+    std::shared_ptr<VarValue> val = info ? info->currentValue : nullptr;
     std::string newVal = val ? val->toString() : "";
     if (renderer) {
         for (auto& b : it->second) {
-            if (b.bindingType=="content") {renderer->sendBindingUpdate(b.elementId, newVal);};
-            if (b.bindingType=="attribute") {renderer->sendAttributeUpdate(b.elementId, b.attribute, newVal);};
+            if (b.bindingType=="content") {renderer->sendBindingUpdate(b.elementId, newVal, b.bindingId);};
+            if (b.bindingType=="attribute") {renderer->sendAttributeUpdate(b.elementId, b.attribute, newVal, b.bindingId);};
+            if (b.bindingType=="if") {renderer->sendConditionUpdate(b.elementId, newVal, b.bindingId);};
+            if (b.bindingType=="for") {renderer->sendListUpdate(b.elementId, val, b.bindingId);};
             // etc.
         }
     } else {
@@ -437,7 +563,7 @@ bool Environment::dfsCycleCheck(VarID node, int timestamp) const {
     mutable_cast()->visitTimestamp[node] = timestamp;
 
     // Recursively check all neighbors
-    for (const auto& neighbor : adjacency[node]) {
+    for (const auto& neighbor : graph().adjacency[node]) {
         if (dfsCycleCheck(neighbor, timestamp)) {
             return true; // Cycle detected in neighbors
         }
@@ -456,13 +582,13 @@ void Environment::markDirty(const CompositeKey& key) {
 
         emitEvents(varID);
 
-        for (VarID dependentID : adjacency[varID]) {
-            std::cout << "[MARK DIRTY] Propagating to dependent: " << idToKey[dependentID] << "\n";
+        for (VarID dependentID : graph().adjacency[varID]) {
+            logStream() << "[MARK DIRTY] Propagating to dependent: " << graph().idToKey[dependentID] << "\n";
             // Assuming compositeName remains consistent
-            CompositeKey dependentKey = idToKey[dependentID];
+            CompositeKey dependentKey = graph().idToKey[dependentID];
             markDirty(dependentKey);
         }
-        std::cout << "[MARK DIRTY] Variable: " << getCompositeName(key) 
+        logStream() << "[MARK DIRTY] Variable: " << getCompositeName(key) 
                     << " (ID: " << varID << ", Priority: " << priority << ")\n";
     }
 
@@ -484,15 +610,17 @@ void Environment::clearDirty(VarID varID) {
 }   
 
 void Environment::recalcDirty(std::function<void(VarID)> updater) {
+    const auto& idToKey = graph().idToKey;
+    const auto& adjacency = graph().adjacency;
     // Step 1: Identify the subgraph consisting only of dirty variables
     std::unordered_set<VarID> dirtySet(dirtyVars.begin(), dirtyVars.end());
 
     // Debug: Log the dirty set
-    std::cout << "[RECALC_DIRTY] Dirty Set: ";
+    logStream() << "[RECALC_DIRTY] Dirty Set: ";
     for (const auto& varID : dirtySet) {
-        std::cout << idToKey[varID] << " ";
+        logStream() << idToKey[varID] << " ";
     }
-    std::cout << "\n";
+    logStream() << "\n";
 
     // Step 2: Initialize in-degree for each dirty variable
     std::unordered_map<VarID, int> inDegree;
@@ -539,14 +667,14 @@ void Environment::recalcDirty(std::function<void(VarID)> updater) {
     }
 
     // Step 7: Update variables in sorted order
-    std::cout << "[RECALC_DIRTY] Sorted Vars: ";
+    logStream() << "[RECALC_DIRTY] Sorted Vars: ";
     for (const auto& varID : sortedVars) {
-        std::cout << idToKey[varID] << " ";
+        logStream() << idToKey[varID] << " ";
     }
-    std::cout << "\n";
+    logStream() << "\n";
 
     for (const auto& varID : sortedVars) {
-        std::cout << "[RECALC_DIRTY] Updating variable: " << idToKey[varID] << "\n";
+        logStream() << "[RECALC_DIRTY] Updating variable: " << idToKey[varID] << "\n";
         updater(varID);
     }
 
@@ -566,6 +694,8 @@ int Environment::dfsCalculateDepth(VarID varID, std::unordered_map<VarID, int>&
         return cache[varID];
     }
 
+    const auto& adjacency = graph().adjacency;
+
     // Base case: No dependents
     if (adjacency[varID].empty()) {
         return 1;
@@ -584,7 +714,7 @@ int Environment::dfsCalculateDepth(VarID varID, std::unordered_map<VarID, int>&
 
 // Check if a variable exists
 bool Environment::hasVariable(const CompositeKey& key) const {
-    return variables.find(key) != variables.end();
+    return findVariable(key) != nullptr;
 }
 
     // Additional methods for dependency management can be added here
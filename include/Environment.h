@@ -42,7 +42,7 @@ public:
     struct VarInfo {
         VarKind kind;
         std::shared_ptr<VarValue> currentValue;
-        std::unique_ptr<ExpressionStatementNode> expression; // For derived variables
+        std::shared_ptr<ExpressionStatementNode> expression; // For derived variables (shared by forks)
         std::vector<CompositeKey> dependencies; // Variable names this variable depends on
     };
 
@@ -54,9 +54,39 @@ public:
     // Execution queue for dynamic subscriptions
     std::vector<std::function<void()>> executionQueue;    
 
-    // Separate maps for variables and functions
+    // Variables defined (or, in a fork, written) in this environment
     std::unordered_map<CompositeKey, std::shared_ptr<VarInfo>, CompositeKeyHash> variables;
-    std::unordered_map<CompositeKey, std::shared_ptr<Function>, CompositeKeyHash> functions;
+
+    /**
+     * Everything but the values: functions, the dependency graph, event
+     * subscriptions and data bindings. It is built while the program runs
+     * and rarely changes after, so a fork shares its template's until it
+     * changes something (mutableGraph() copies it then).
+     */
+    struct Structure {
+        std::unordered_map<CompositeKey, std::shared_ptr<Function>, CompositeKeyHash> functions;
+
+        // Dependency Tracking using integer IDs
+        std::unordered_map<CompositeKey, VarID, CompositeKeyHash> nameToId; // Maps CompositeKey to VarID
+        std::vector<CompositeKey> idToKey;
+        std::vector<DependencyList> adjacency; // adjacency[VarID] = list of dependent VarIDs
+        std::vector<DependencyList> reverseAdjacency;
+
+        // Event Subscribers: varID -> (subscriptionID -> callback)
+        std::unordered_map<VarID, std::unordered_map<SubscriptionID, std::function<void()>>> eventSubscribers;
+        std::unordered_map<VarID, std::unordered_map<std::string, SubscriptionID>> functionSubscriptions;
+
+        // Data bindings
+        std::unordered_map<std::string, std::vector<BindingInfo>> bindings;
+
+        // Subscription ID counter
+        SubscriptionID nextSubscriptionID = 1;
+    };
+
+    std::shared_ptr<Structure> structure = std::make_shared<Structure>();
+
+    const Structure& graph() const { return *structure; }
+    Structure& mutableGraph();
 
     mutable std::mutex envMutex; // Mutex to protect environment's data
     mutable std::mutex bindingMutex; // Mutex to protect environment's data
@@ -64,29 +94,12 @@ public:
         // Renderer instance
     Renderer* renderer;
 
-    // Dependency Tracking using integer IDs
-    std::unordered_map<CompositeKey, VarID, CompositeKeyHash> nameToId; // Maps CompositeKey to VarID
-    std::vector<CompositeKey> idToKey;
-    std::vector<DependencyList> adjacency; // adjacency[VarID] = list of dependent VarIDs
-    std::vector<DependencyList> reverseAdjacency;
-
     // Dirty variables for recalculation
     std::unordered_set<VarID> dirtyVars;
     std::priority_queue<std::pair<VarID, int>, 
                     std::vector<std::pair<VarID, int>>, 
                     std::greater<>> dirtyQueue;
 
-        // Event Subscribers: varID -> list of function callbacks
-        // Event Subscribers: varID -> (subscriptionID -> callback)
-    std::unordered_map<VarID, std::unordered_map<SubscriptionID, std::function<void()>>> eventSubscribers;
-    std::unordered_map<VarID, std::unordered_map<std::string, SubscriptionID>> functionSubscriptions;
-
-    // Data bindings
-    std::unordered_map<std::string, std::vector<BindingInfo>> bindings;
-
-    // Subscription ID counter
-    SubscriptionID nextSubscriptionID = 1;
-
     // Cycle Detection
     std::unordered_map<VarID, int> visitTimestamp; // Timestamp for visitation
     int currentTimestamp = 0;
@@ -97,23 +110,60 @@ public:
     // Instance ID
     InstanceID instanceID;
 
+    // Environment this one was forked from (values not in `variables` are
+    // read from it), or null
+    std::shared_ptr<const Environment> base;
+
+    std::ostream* logOut;
+    std::ostream* errorOut;
+
     Environment(std::shared_ptr<Environment> parentEnv = nullptr, size_t id = InstanceIDGenerator::getNextID(), Renderer* rend = nullptr);
 
+    // Copy-on-write copy for one session, rendering through `rend`: it
+    // starts with no values or structure of its own and copies a variable
+    // (deep, for arrays, dicts and objects) the first time it writes it
+    std::shared_ptr<Environment> fork(Renderer* rend) const;
+
     void setRenderer(Renderer* rend);
 
+    // Where debug output and errors go (std::cout / std::cerr unless set);
+    // inherited from the parent when the environment is made
+    void setLogStreams(std::ostream& log, std::ostream& errors);
+    std::ostream& logStream() const { return *logOut; }
+    std::ostream& errorStream() const { return *errorOut; }
+
     bool isGlobalEnvironment() const;
 
     std::shared_ptr<ReactiveArray> createReactiveArray(const CompositeKey& key);
     std::shared_ptr<ReactiveDict> createReactiveDict(const CompositeKey& key);
-    // Variable Lookup
+    // Variable Lookup. In a fork, reading an array, dict or object copies
+    // it in (it may be changed in place); peekVariable never copies.
     std::shared_ptr<VarValue> getVariable(const CompositeKey& key) const;
+    std::shared_ptr<VarValue> peekVariable(const CompositeKey& key) const;
+
+    // This environment's VarInfo for `key`, or the one it was forked from
+    // (null if neither has it)
+    std::shared_ptr<VarInfo> findVariable(const CompositeKey& key) const;
+
+    // This environment's own VarInfo for `key`, copied from `base` first if
+    // need be (with its value when `copyValue`); null if there is none
+    std::shared_ptr<VarInfo> ownVariable(const CompositeKey& key, bool copyValue = true);
+
+    // `value` as this environment's own: arrays and dicts (recursively) are
+    // rebuilt to notify it, objects get a fork of their instance environment
+    std::shared_ptr<VarValue> copyIn(const std::shared_ptr<VarValue>& value);
 
     // Variable Assignment
     void setVariable(const CompositeKey& key, std::shared_ptr<VarValue> value);
 
+    // Bind `key` in this environment itself, shadowing any outer variable
+    // of that name; the value (an item that lives elsewhere, such as a
+    // loop row's) keeps its own key
+    void defineLocal(const CompositeKey& key, std::shared_ptr<VarValue> value);
+
     // Data Bindings
 void registerBinding(const BindingInfo& binding);
-std::unordered_map<std::string, std::vector<BindingInfo>> getBindings();
+const std::unordered_map<std::string, std::vector<BindingInfo>>& getBindings() const;
 
 
     // Derive Variable
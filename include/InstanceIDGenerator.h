@@ -3,7 +3,8 @@
 #ifndef INSTANCE_ID_GENERATOR_H
 #define INSTANCE_ID_GENERATOR_H
 
-#include <mutex>
+#include <atomic>
+#include <cstddef>
 
 namespace JTMLInterpreter {
 class InstanceIDGenerator {
@@ -13,17 +14,30 @@ public:
     InstanceIDGenerator(const InstanceIDGenerator&) = delete;
     InstanceIDGenerator& operator=(const InstanceIDGenerator&) = delete;
 
-    // Static method to get the next unique ID
-    static size_t getNextID() { // Changed return type to size_t
-        // Static variables ensure that they are initialized only once
-        static std::mutex idMutex;
-        static size_t currentID = 1000; // Starting from 1000 to differentiate from globalEnv
+    // IDs a thread reserves at a time
+    static constexpr size_t BLOCK_SIZE = 1024;
 
-        std::lock_guard<std::mutex> lock(idMutex);
-        return ++currentID;
+    // Static method to get the next unique ID. Each thread hands out IDs
+    // from its own block and only touches the shared counter to reserve
+    // the next one, so interpreters on different threads never contend.
+    // IDs are unique, but only increasing within a thread.
+    static size_t getNextID() {
+        thread_local size_t next = 0;
+        thread_local size_t blockEnd = 0;
+        if (next == blockEnd) {
+            next = nextBlock().fetch_add(BLOCK_SIZE, std::memory_order_relaxed);
+            blockEnd = next + BLOCK_SIZE;
+        }
+        return next++;
+    }
+
+private:
+    static std::atomic<size_t>& nextBlock() {
+        // Starting from 1001 to differentiate from globalEnv
+        static std::atomic<size_t> start{1001};
+        return start;
     }
 };
 } // namespace JTMLInterpreter
 
 #endif // INSTANCE_ID_GENERATOR_H
-
@@ -0,0 +1,78 @@
+// binding_table.h
+#pragma once
+
+#include "jtml_ast.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * What a binding slot drives on the client.
+ */
+enum class BindingKind : uint8_t {
+    Content,    // show => textContent of the placeholder
+    Attribute,  // reactive element attribute
+    Event,      // onClick / onInput / ... handler
+    If,         // data-jtml-if condition
+    For,        // data-jtml-for iterable
+    While       // data-jtml-while condition
+};
+
+using BindingID = uint32_t;
+
+/**
+ * A hole in a for-host's body. Rows are clones of the body, so these get
+ * no slot of their own: the interpreter evaluates them per item, with the
+ * iterator bound to it, and ships the results as the row's value. The
+ * client fills the k-th one into the row's data-jtml-hole="k" element
+ * (Content) or its data-jtml-hole-ATTR="k" attribute (Attribute).
+ */
+struct RowHole {
+    BindingKind kind = BindingKind::Content;
+    std::string attribute;  // Attribute only
+    std::shared_ptr<ExpressionStatementNode> expression;
+};
+
+/**
+ * One reactive hole emitted by the compiler. The slot's index in the
+ * BindingTable is its BindingID; `name` is the derived variable the
+ * interpreter creates for it (expr_N, attr_N, cond_N, range_N) and
+ * `elementId` is what the front end addresses it by.
+ */
+struct BindingSlot {
+    BindingKind kind = BindingKind::Content;
+    std::string name;
+    std::string elementId;
+    std::string attribute;     // Attribute / Event only
+    std::string iteratorName;  // For only
+    size_t windowSize = 0;     // For only: rows kept around the viewport, 0 = all
+    std::vector<RowHole> rowHoles;  // For only: what each row shows of its item
+    EventPolicy eventPolicy;   // Event only
+    std::shared_ptr<ExpressionStatementNode> expression;
+
+    // Where server-side rendering writes the current value into the page:
+    // the {{expr}} placeholder of a show, the point after an attribute's
+    // data-jtml-attr-* marker, or the open tag of an if/for host (for its
+    // data-jtml-value). A hole in a branch or loop body is recorded within
+    // the body and moved to where its hoisted <template> lands. npos for
+    // events, which have no value to show.
+    size_t htmlOffset = std::string::npos;
+    size_t htmlLength = 0;
+};
+
+using BindingTable = std::vector<BindingSlot>;
+
+inline const char* bindingKindName(BindingKind kind) {
+    switch (kind) {
+        case BindingKind::Content:   return "content";
+        case BindingKind::Attribute: return "attribute";
+        case BindingKind::Event:     return "attribute_event";
+        case BindingKind::If:        return "if";
+        case BindingKind::For:       return "for";
+        case BindingKind::While:     return "while";
+    }
+    return "unknown";
+}
@@ -0,0 +1,160 @@
+// event_gate.h
+#pragma once
+
+#include "jtml_ast.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace JTMLInterpreter {
+
+/**
+ * EventGate
+ * Applies the handlers' EventPolicy on the way into the interpreter's
+ * executor. Per connection and handler only the latest event waits, and
+ * at most one run of it is queued or on a timer, so a burst of mouse-moves
+ * costs one handler run (and one recalc) per window instead of one each.
+ *
+ * offer() is called from the I/O threads; `run` is called on the executor
+ * (through `post` / `postAfter`, which the owner supplies).
+ */
+class EventGate {
+public:
+    typedef uint64_t Source;  // a ConnectionID
+    typedef std::function<void()> Task;
+    typedef std::function<void(Task)> Post;
+    typedef std::function<void(uint32_t, Task)> PostAfter;  // delay in ms
+    typedef std::function<void(Source, const std::string&)> Run;
+
+    EventGate(Post post, PostAfter postAfter, Run run)
+        : post(std::move(post)), postAfter(std::move(postAfter)), run(std::move(run)) {}
+
+    EventGate(const EventGate&) = delete;
+    EventGate& operator=(const EventGate&) = delete;
+
+    // Set while loading the binding table, before any event arrives
+    void setPolicy(const std::string& elementId, EventPolicy policy) {
+        if (policy.kind == EventPolicy::Kind::None) {
+            policies.erase(elementId);
+        } else {
+            policies[elementId] = policy;
+        }
+    }
+
+    bool empty() const { return policies.empty(); }
+
+    // Take `message`, an event for `elementId`, unless that handler has no
+    // policy (false: the caller runs it as usual)
+    bool offer(Source source, const std::string& elementId, std::string message) {
+        auto policyIt = policies.find(elementId);
+        if (policyIt == policies.end()) {
+            return false;
+        }
+        const EventPolicy& policy = policyIt->second;
+        const Key key{ source, elementId };
+        const Clock::time_point now = Clock::now();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Pending& pending = waiting[key];
+        pending.message = std::move(message);
+        if (policy.kind == EventPolicy::Kind::Debounce) {
+            pending.deadline = now + std::chrono::milliseconds(policy.value);
+        }
+        if (pending.scheduled) {
+            return true;  // the run already on its way takes this message
+        }
+        pending.scheduled = true;
+
+        Task fire = [this, key] { release(key); };
+        switch (policy.kind) {
+            case EventPolicy::Kind::Throttle: {
+                const auto interval = std::chrono::microseconds(1000000 / policy.value);
+                const auto wait = pending.lastRun + interval - now;
+                if (pending.hasRun && wait > Clock::duration::zero()) {
+                    postAfter(delayMs(wait), std::move(fire));
+                } else {
+                    post(std::move(fire));
+                }
+                break;
+            }
+            case EventPolicy::Kind::Debounce:
+                postAfter(policy.value, std::move(fire));
+                break;
+            default:
+                post(std::move(fire));
+                break;
+        }
+        return true;
+    }
+
+    // Forget what a closed connection left waiting
+    void drop(Source source) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = waiting.lower_bound(Key{ source, std::string() });
+        while (it != waiting.end() && it->first.first == source) {
+            it = waiting.erase(it);
+        }
+    }
+
+    size_t waitingCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return waiting.size();
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    typedef std::pair<Source, std::string> Key;
+
+    struct Pending {
+        std::string message;         // latest event
+        bool scheduled = false;      // a release() is queued or on a timer
+        bool hasRun = false;
+        Clock::time_point lastRun;   // Throttle
+        Clock::time_point deadline;  // Debounce: quiet until then
+    };
+
+    static uint32_t delayMs(Clock::duration wait) {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(wait).count();
+        return static_cast<uint32_t>(ms > 0 ? ms : 1);
+    }
+
+    // On the executor: run the latest event, unless a debounced handler saw
+    // another event since the timer was set
+    void release(const Key& key) {
+        std::string message;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = waiting.find(key);
+            if (it == waiting.end()) {
+                return;  // dropped with its connection
+            }
+            Pending& pending = it->second;
+            const Clock::time_point now = Clock::now();
+            if (pending.deadline > now) {
+                postAfter(delayMs(pending.deadline - now), [this, key] { release(key); });
+                return;
+            }
+            message = std::move(pending.message);
+            pending.scheduled = false;
+            pending.hasRun = true;
+            pending.lastRun = now;
+        }
+        run(key.first, message);
+    }
+
+    Post post;
+    PostAfter postAfter;
+    Run run;
+    std::unordered_map<std::string, EventPolicy> policies;
+
+    mutable std::mutex mutex;  // guards waiting
+    std::map<Key, Pending> waiting;
+};
+
+} // namespace JTMLInterpreter
@@ -0,0 +1,120 @@
+// interest_index.h
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace JTMLInterpreter {
+
+/**
+ * InterestIndex
+ * Which connections show which binding slots, kept both ways: slot to
+ * connections (to route a change) and connection to slots (to forget it).
+ * A connection that has not said what it shows yet gets every slot.
+ *
+ * Called from the I/O threads (open, drop) and the executor.
+ */
+class InterestIndex {
+public:
+    typedef uint64_t Source;  // a ConnectionID
+    typedef uint32_t Slot;    // a BindingID
+
+    // A new connection, interested in everything until it declares
+    void open(Source source) {
+        std::lock_guard<std::mutex> lock(mutex);
+        undeclared.insert(source);
+    }
+
+    void drop(Source source) {
+        std::lock_guard<std::mutex> lock(mutex);
+        undeclared.erase(source);
+        auto it = slotsOf.find(source);
+        if (it == slotsOf.end()) {
+            return;
+        }
+        for (Slot slot : it->second) {
+            unlink(slot, source);
+        }
+        slotsOf.erase(it);
+    }
+
+    // Apply one announcement; true for the connection's first, which
+    // replaces "everything" with what it lists
+    bool update(Source source, const std::vector<Slot>& added, const std::vector<Slot>& removed) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const bool first = undeclared.erase(source) > 0;
+        std::unordered_set<Slot>& slots = slotsOf[source];
+        for (Slot slot : removed) {
+            if (slots.erase(slot)) {
+                unlink(slot, source);
+            }
+        }
+        for (Slot slot : added) {
+            if (slots.insert(slot).second) {
+                connectionsOf[slot].push_back(source);
+            }
+        }
+        return first;
+    }
+
+    bool wants(Source source, Slot slot) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (undeclared.count(source)) {
+            return true;
+        }
+        auto it = slotsOf.find(source);
+        return it != slotsOf.end() && it->second.count(slot) > 0;
+    }
+
+    // The connections to send a change of any of `slots` to
+    std::vector<Source> audience(const std::vector<Slot>& slots) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Source> sources(undeclared.begin(), undeclared.end());
+        if (slots.size() == 1) {
+            auto it = connectionsOf.find(slots.front());
+            if (it != connectionsOf.end()) {
+                sources.insert(sources.end(), it->second.begin(), it->second.end());
+            }
+            return sources;
+        }
+        std::unordered_set<Source> seen(sources.begin(), sources.end());
+        for (Slot slot : slots) {
+            auto it = connectionsOf.find(slot);
+            if (it == connectionsOf.end()) continue;
+            for (Source source : it->second) {
+                if (seen.insert(source).second) sources.push_back(source);
+            }
+        }
+        return sources;
+    }
+
+private:
+    // Caller holds mutex
+    void unlink(Slot slot, Source source) {
+        auto it = connectionsOf.find(slot);
+        if (it == connectionsOf.end()) {
+            return;
+        }
+        std::vector<Source>& sources = it->second;
+        for (size_t i = 0; i < sources.size(); ++i) {
+            if (sources[i] == source) {
+                sources[i] = sources.back();
+                sources.pop_back();
+                break;
+            }
+        }
+        if (sources.empty()) {
+            connectionsOf.erase(it);
+        }
+    }
+
+    mutable std::mutex mutex;
+    std::unordered_map<Slot, std::vector<Source>> connectionsOf;
+    std::unordered_map<Source, std::unordered_set<Slot>> slotsOf;
+    std::unordered_set<Source> undeclared;
+};
+
+} // namespace JTMLInterpreter
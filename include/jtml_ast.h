@@ -44,6 +44,7 @@ enum class ASTNodeType {
 
     NoOp,
     ClassDeclaration,
+    ImportStatement,
     // Add more as needed
 };
 
@@ -268,12 +269,27 @@ struct ASTNode {
 };
 
 // ------------------- Markup Node -------------------
+/**
+ * What the server does with a burst of one event handler's events, set
+ * with a modifier on the attribute (onMouseOver.throttle(20) = track()):
+ *   None      every event runs its handler
+ *   Coalesce  events waiting to run collapse into the latest one
+ *   Throttle  at most `value` runs per second, each with the latest event
+ *   Debounce  one run, with the latest event, once none came for `value` ms
+ */
+struct EventPolicy {
+    enum class Kind : uint8_t { None, Coalesce, Throttle, Debounce };
+    Kind kind = Kind::None;
+    uint32_t value = 0;
+};
+
 /**
  * Holds a key:value attribute (e.g., style, class, onclick).
  */
 struct JtmlAttribute {
     std::string key;
     std::unique_ptr<ExpressionStatementNode> value;
+    EventPolicy policy;  // event attributes only
 
     // Default constructor
     JtmlAttribute() = default;
@@ -284,7 +300,7 @@ struct JtmlAttribute {
 
     // Copy constructor (deep copy)
     JtmlAttribute(const JtmlAttribute& other)
-        : key(other.key), value(other.value ? other.value->clone() : nullptr) {}
+        : key(other.key), value(other.value ? other.value->clone() : nullptr), policy(other.policy) {}
 
     // Move constructor
     JtmlAttribute(JtmlAttribute&& other) noexcept = default;
@@ -294,6 +310,7 @@ struct JtmlAttribute {
         if (this != &other) {
             key = other.key;
             value = other.value ? other.value->clone() : nullptr;
+            policy = other.policy;
         }
         return *this;
     }
@@ -474,6 +491,9 @@ struct ForStatementNode : public ASTNode {
     std::string iteratorName;
     std::unique_ptr<ExpressionStatementNode> iterableExpression;
     std::unique_ptr<ExpressionStatementNode> rangeEndExpr;
+    // 'window N': the page holds at most N rows around the client's viewport
+    // (0 = every row)
+    size_t windowSize = 0;
     std::vector<std::unique_ptr<ASTNode>> body;
 
     ASTNodeType getType() const override;
@@ -571,6 +591,17 @@ struct ClassDeclarationNode : public ASTNode {
     std::string toString() const override;
 };
 
+// -- ImportStatementNode (e.g., 'import "widgets.jtml" as ui\\') --
+struct ImportStatementNode : public ASTNode {
+    std::string modulePath; // as written, resolved relative to the importing file
+    std::string alias;      // namespace name; defaults to the file stem
+
+    ASTNodeType getType() const override;
+
+    std::unique_ptr<ASTNode> clone() const override;
+    std::string toString() const override;
+};
+
 struct FunctionCallExpressionStatementNode : public ExpressionStatementNode {
     std::string functionName;
     std::vector<std::unique_ptr<ExpressionStatementNode>> arguments;
@@ -3,6 +3,7 @@
 
 #include "jtml_ast.h"
 #include "transpiler.h"
+#include "binding_table.h"
 #include "jtml_parser.h"
 #include "jtml_lexer.h" 
 #include "jtml_value.h"
@@ -14,6 +15,13 @@
 #include "Function.h"
 #include "renderer.h"
 #include "websocket_server.h"
+#include "worker_pool.h"
+#include "event_gate.h"
+#include "interest_index.h"
+#include "sent_values.h"
+#include "module_loader.h"
+#include <map>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
@@ -27,17 +35,38 @@ namespace JTML = JTMLInterpreter;
 // Interpreter class
 class Interpreter {
 public:
-    explicit Interpreter(JtmlTranspiler& transpiler); // Constructor declaration
+    static constexpr uint16_t DEFAULT_WEBSOCKET_PORT = 8080;
+
+    Interpreter(); // Constructor declaration
     ~Interpreter(); // Default destructor
 
-    void handleFrontendMessage(const std::string& msg, websocketpp::connection_hdl hdl);
-    void populateBindings(websocketpp::connection_hdl hdl);
+    // Start the WebSocket server on `port` (once; nothing listens until then)
+    void listen(uint16_t port = DEFAULT_WEBSOCKET_PORT);
+
+    void handleFrontendMessage(const std::string& msg, JTML::ConnectionID connection);
+    void handleEvent(const nlohmann::json& event);
+    void handleEventBatch(const nlohmann::json& message, JTML::ConnectionID connection);
+    // The slots a connection's page shows changed ({"add": [...], "remove": [...]})
+    void handleInterest(const nlohmann::json& message, JTML::ConnectionID connection);
+    // Current state for one connection: the changes since `lastVersion` when
+    // the journal of this run (`epoch`) still has them, else the snapshot
+    void populateBindings(JTML::ConnectionID connection, const std::string& epoch = std::string(),
+                          uint64_t lastVersion = 0);
 
     // Interpret methods
     void interpret(const JtmlElementNode&);
     void interpret(const std::vector<std::unique_ptr<ASTNode>>& program);
     void interpret(const std::string& code);
 
+    // Derive and register every slot the compiler emitted (run after the
+    // program's statements so the variables they read exist). One table per
+    // interpreter: loading a second non-empty one throws.
+    void loadBindingTable(const BindingTable& table);
+
+    // Current value of a loaded slot as the client would display it
+    // (false if the slot is unknown or has no value yet)
+    bool bindingValue(BindingID id, std::string& out) const;
+
     std::shared_ptr<JTML::VarValue> evaluateExpression(const ExpressionStatementNode* exprNode, std::shared_ptr<JTML::Environment> env);
 
     
@@ -46,18 +75,135 @@ public:
 
     std::shared_ptr<JTML::Environment> getCurrentEnvironment() const;
 
+    // Directory that top-level 'import' paths are resolved against
+    void setModuleBaseDirectory(const std::string& dir);
+
+    // Offer binary framing to clients that ask for it (default on)
+    void setBinaryFraming(bool enabled);
+
+    // permessage-deflate settings (JTML_WITH_DEFLATE builds): minimum
+    // payload size and whether to keep the compression context
+    void setCompression(size_t threshold, bool contextTakeover);
+
+    // Size of the WebSocket I/O thread pool, and what a connection's
+    // outbound queue does when its client falls behind
+    void setIoThreads(size_t threads);
+    void setBackpressure(JTML::BackpressurePolicy policy);
+
+    // Give every connection its own state instead of one shared by all
+    // (off by default): a copy-on-write fork of the global environment,
+    // made when it connects, with a renderer that only sends to it
+    void setSessions(bool enabled);
+    size_t sessionCount() const;
+
+    // Where this interpreter's debug output and errors go (std::cout and
+    // std::cerr by default); set before interpreting
+    void setLogStreams(std::ostream& log, std::ostream& errors);
+
+    // Client messages never run on the WebSocket I/O threads: the server
+    // queues them for this interpreter's executor, a worker thread of its
+    // own unless it is pinned to one of `pool`'s (interpreters sharing a
+    // pool serve their pages in parallel); set before listen()
+    void setWorkerPool(std::shared_ptr<JTML::WorkerPool> pool);
+
+    // Run `task` on the executor and wait for it (in place before
+    // listen(), or when called from the executor), for other threads that
+    // read the interpreter's state while it serves
+    void execute(const std::function<void()>& task);
+
     // Error handling
     
 private:
-    JtmlTranspiler& transpiler;
     std::shared_ptr<JTML::Environment> globalEnv;
     std::shared_ptr<JTML::Environment> currentEnv;
     bool inFunctionContext = false;
+    int callDepth = 0; // nested executeFunction calls
 
     std::thread wsThread;
 
-    int nodeID;
-    int uniqueVarID;
+    std::ostream* logOut = &std::cout;
+    std::ostream* errorOut = &std::cerr;
+    std::ostream& logStream() const { return *logOut; }
+    std::ostream& errorStream() const { return *errorOut; }
+
+    std::shared_ptr<JTML::WorkerPool> workerPool;
+    JTML::WorkerPool::WorkerID worker = 0;
+    // Queue a WebSocket callback's work for the executor
+    void dispatch(std::function<void()> task);
+
+    // Holds back events of handlers with a policy (.coalesce, .throttle,
+    // .debounce) before they reach the executor
+    std::unique_ptr<JTML::EventGate> eventGate;
+    // An inbound message with the events the gate took out (empty if that
+    // was all of it); on the I/O thread
+    std::string admitEvents(const std::string& msg, JTML::ConnectionID connection);
+
+    // Which connections show which slots; changes go only to those
+    std::unique_ptr<JTML::InterestIndex> interest;
+    // What each connection was last sent per slot; a change it already
+    // has is not sent to it again
+    std::unique_ptr<JTML::SentValues> sentValues;
+    // Send a change of `slots` to the connections showing any of them (to
+    // all when one has no slot), except `except`. A change with a `value`
+    // (of a single slot) skips the connections that have it.
+    void sendToInterested(const std::vector<uint32_t>& slots, const std::string& text, const std::string& binary,
+                          const std::string& key, JTML::Lane lane, JTML::ConnectionID except = 0,
+                          const JTML::SentValues::Value& value = nullptr);
+
+    // Per-connection sessions (setSessions). While one handles a message,
+    // programEnv is the environment they all fork and globalEnv the session's.
+    struct Session {
+        std::unique_ptr<JTML::Renderer> renderer;
+        std::shared_ptr<JTML::Environment> env;
+    };
+    class SessionScope;
+    bool sessionsEnabled = false;
+    std::unordered_map<JTML::ConnectionID, Session> sessions;
+    std::shared_ptr<JTML::Environment> programEnv;
+
+    void openSession(JTML::ConnectionID connection);
+    // Environment a call to `func` runs under (its closure, or the
+    // session's fork of it)
+    std::shared_ptr<JTML::Environment> closureOf(const JTML::Function& func) const;
+    // In a session, the session's value of a global variable a subscription
+    // was made on (null otherwise)
+    std::shared_ptr<JTML::VarValue> sessionValueOf(const JTML::CompositeKey& key) const;
+
+    // Slot index == BindingID
+    BindingTable bindingTable;
+
+    // Windowed for-hosts (elementId -> slot) and, per connection, the slice
+    // of each one it was last sent
+    struct ListViewport {
+        size_t first = 0;   // first row the client shows
+        size_t count = 0;   // rows it has room for
+        size_t start = 0;   // first row it was sent
+        size_t total = 0;   // list length at the time
+        std::vector<JTML::ListEntry> rows;  // base of the next patch
+    };
+    std::unordered_map<std::string, BindingID> windowedHosts;
+    std::unordered_map<JTML::ConnectionID, std::unordered_map<std::string, ListViewport>> viewports;
+    std::mutex viewportsMutex;
+
+    // What a row of each for-host (by elementId) shows of its item: the
+    // JSON array of its body's holes, evaluated with the iterator bound
+    std::unordered_map<std::string, JTML::RowRenderer> rowRenderers;
+    std::string renderRow(const BindingSlot& slot, const std::shared_ptr<JTML::VarValue>& item);
+    // Scope a row's holes are evaluated in: the iterator bound to `item`
+    std::shared_ptr<JTML::Environment> rowScope(const BindingSlot& slot, const std::shared_ptr<JTML::VarValue>& item) const;
+    // A for-host's rows as its client shows them
+    std::vector<JTML::ListEntry> rowsOf(const std::string& elementId, const std::shared_ptr<JTML::VarValue>& list,
+                                        size_t first = 0, size_t count = static_cast<size_t>(-1)) const;
+
+    // Full-state populateBindings message (and its Deflated frame when it is
+    // large enough), cached in the journal until the next change
+    std::string buildSnapshot(std::string& compressed);
+
+    // Slice of a windowed host around `viewport` (rows stored back into it)
+    nlohmann::json listWindow(const std::string& elementId, const std::shared_ptr<JTML::VarValue>& list,
+                              ListViewport& viewport) const;
+    void sendListWindow(JTML::ConnectionID connection, const std::string& elementId, ListViewport& viewport,
+                        JTML::Lane lane = JTML::Lane::Updates);
 
     int uniqueArrayVarID;
     int uniqueDictVarID ;
@@ -66,6 +212,18 @@ private:
     std::shared_ptr<JTML::WebSocketServer> wsServer;
         
     std::unordered_map<std::string, std::shared_ptr<ClassDeclarationNode>> classDeclarations;
+
+    // Modules instantiated by this interpreter: canonical path -> module + its namespace
+    struct LoadedModule {
+        std::shared_ptr<const Module> module;
+        std::shared_ptr<JTML::Environment> env;
+    };
+    std::string moduleBaseDir = ".";
+    std::unordered_map<std::string, LoadedModule> loadedModules;
+    std::vector<std::string> importStack; // canonical paths of modules being executed
+    // Per-module class namespaces, keyed by the module environment's InstanceID
+    std::unordered_map<JTML::InstanceID, std::unordered_map<std::string, std::shared_ptr<ClassDeclarationNode>>> moduleClassDeclarations;
+    std::shared_ptr<ClassDeclarationNode> findClassDeclaration(const std::string& name, std::shared_ptr<JTML::Environment> env) const;
     
     // Function Execution
     std::shared_ptr<JTML::VarValue> executeFunction(
@@ -106,14 +264,10 @@ private:
     void interpret(const ASTNode& node);
     void interpretNode(const ASTNode& node);
     void interpretElement(const JtmlElementNode& elem);
-    void interpretElementAttributes(const JtmlElementNode& node);
+    void bindSlot(BindingID id);
     bool isEventAttribute(const std::string& attrName) const;
     std::string extractEventType(const std::string& attrName) const;
     bool containsExpression(const ExpressionStatementNode* exprNode) const;
-    void interpretShowElement(const ShowStatementNode& node);
-    void interpretIfElement(const IfStatementNode& node);
-    void interpretWhileElement(const WhileStatementNode& node);
-    void interpretForElement(const ForStatementNode& node);
     void interpretBlockStatement(const BlockStatementNode& block);
     void interpretShow(const ShowStatementNode& stmt);
     void interpretExpression(const ExpressionNode& node);
@@ -134,6 +288,7 @@ private:
     void interpretThrow(const ThrowStatementNode& stmt);
     void interpretFunctionDeclaration(const FunctionDeclarationNode& outerDecl);
     void interpretClassDeclaration(const ClassDeclarationNode& node);
+    void interpretImport(const ImportStatementNode& node);
     void collectAllNestedFunctions(
         const std::vector<std::unique_ptr<ASTNode>>& stmts,
         const std::shared_ptr<JTML::Environment>& closureEnv
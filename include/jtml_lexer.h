@@ -1,7 +1,10 @@
 // jtml_lexer.h
 #pragma once
 
+#include <array>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <unordered_map>
 #include <stdexcept>
@@ -94,18 +97,26 @@ struct Token {
 };
 
 // ------------------- Lexer Class -------------------
+// The lexer does not copy its input: the buffer behind `input` (a std::string,
+// a memory-mapped file, ...) must outlive the Lexer. Temporary strings are
+// rejected at compile time; string literals are static and fine.
 class Lexer {
 public:
-    explicit Lexer(const std::string& input);
+    explicit Lexer(std::string_view input);
+    template <typename T, typename = std::enable_if_t<std::is_same_v<T, std::string>>>
+    explicit Lexer(T&& temporary) = delete;  // binds rvalue std::string only
     
     // Tokenize the input string and return a vector of tokens
     std::vector<Token> tokenize();
 
+    // Scan a single token on demand (END_OF_FILE once the input is exhausted)
+    Token nextToken();
+
     // Retrieve any errors encountered during tokenization
     const std::vector<std::string>& getErrors() const;
 
 private:
-    std::string m_input;
+    std::string_view m_input;
     size_t m_pos;
     int m_line;
     int m_column;
@@ -123,3 +134,31 @@ private:
     Token consumeNumber();
     Token consumeIdentifier();
 };
+
+// ------------------- TokenStream Class -------------------
+/**
+ * Token source consumed by the Parser.
+ *
+ * Either wraps a pre-tokenized vector, or pulls tokens from a Lexer on demand.
+ * In the streaming case only a small ring buffer of tokens is resident, which is
+ * enough for the parser's one token of lookbehind and two tokens of lookahead.
+ */
+class TokenStream {
+public:
+    explicit TokenStream(std::vector<Token> tokens);
+    explicit TokenStream(Lexer& lexer);
+
+    // Token at absolute stream index; indices past the end yield END_OF_FILE
+    const Token& operator[](size_t index) const;
+
+private:
+    static constexpr size_t RING_SIZE = 8;  // power of two
+
+    std::vector<Token> m_tokens;  // pre-tokenized mode
+    Lexer* m_lexer;               // streaming mode
+
+    mutable std::array<Token, RING_SIZE> m_ring;
+    mutable size_t m_pulled;      // number of tokens pulled from the lexer so far
+    mutable bool m_reachedEnd;
+    mutable Token m_eofToken;
+};
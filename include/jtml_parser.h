@@ -13,6 +13,8 @@
 class Parser {
 public:
     explicit Parser(std::vector<Token> tokens);
+    // Streaming mode: tokens are pulled from the lexer as parsing proceeds
+    explicit Parser(Lexer& lexer);
 
     // Parses the entire program and returns a vector of AST nodes
     std::vector<std::unique_ptr<ASTNode>> parseProgram();
@@ -23,12 +25,15 @@ public:
 
 
 private:
-    std::vector<Token> m_tokens;
+    TokenStream m_tokens;
     size_t m_pos;
     int m_line;
     int m_column;
 
     std::vector<std::string> m_errors;
+    // Enclosing loops ("while"/"for") of the statement being parsed, so
+    // break and continue outside one are rejected
+    std::vector<std::string> m_loopContextStack;
 
 
     // ------------------- Parsing Helper Functions -------------------
@@ -36,6 +41,9 @@ private:
     // Parses a single statement and returns an AST node
     std::unique_ptr<ASTNode> parseStatement();
 
+    // Optional '.modifier' after an event attribute's name
+    EventPolicy parseEventPolicy(const std::string& attrName);
+
     // Parses an expression and returns an ExpressionStatementNode
     std::unique_ptr<ExpressionStatementNode> parseExpression();
     std::unique_ptr<ASTNode> parseExpressionStatement();
@@ -57,6 +65,9 @@ private:
     // Parses a store statement (e.g., 'store(main) a\\')
     std::unique_ptr<ASTNode> parseStoreStatement();
 
+    // Parses an import statement (e.g., 'import "widgets.jtml" as ui\\')
+    std::unique_ptr<ASTNode> parseImportStatement();
+
     // Parses a show statement (e.g., 'show sum\\')
     std::unique_ptr<ASTNode> parseShowStatement();
 
@@ -123,7 +134,7 @@ private:
     // ------------------- Expression Parser Nested Class -------------------
     class ExpressionParser {
     public:
-        ExpressionParser(const std::vector<Token>& tokens, size_t& posRef, Parser& parentParser)
+        ExpressionParser(const TokenStream& tokens, size_t& posRef, Parser& parentParser)
             : m_tokens(tokens), m_posRef(posRef), m_parentParser(parentParser) {}
 
         // Parses an expression and returns an ExpressionStatementNode
@@ -131,16 +142,12 @@ private:
 
 
     private:
-        const std::vector<Token>& m_tokens;
+        const TokenStream& m_tokens;
         size_t& m_posRef;
         Parser& m_parentParser; 
 
-        std::unique_ptr<ExpressionStatementNode> parseLogicalOr();
-        std::unique_ptr<ExpressionStatementNode> parseLogicalAnd();
-        std::unique_ptr<ExpressionStatementNode> parseEquality();
-        std::unique_ptr<ExpressionStatementNode> parseComparison();
-        std::unique_ptr<ExpressionStatementNode> parseAddition();
-        std::unique_ptr<ExpressionStatementNode> parseMultiplication();
+        // Precedence climbing over the binary operator table
+        std::unique_ptr<ExpressionStatementNode> parseBinary(int minPrecedence);
         std::unique_ptr<ExpressionStatementNode> parseUnary();
         std::unique_ptr<ExpressionStatementNode> parsePrimary();
         std::unique_ptr<ExpressionStatementNode> parseEmbeddedString();
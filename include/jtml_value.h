@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <variant>
 #include <vector>
 #include <unordered_map>
@@ -47,6 +48,7 @@ struct BindingInfo {
     std::string attribute; // The attribute to bind (empty if binding content)
     std::string bindingType; // The binding type
     std::shared_ptr<ExpressionStatementNode> expression;
+    uint32_t bindingId = UINT32_MAX; // slot in the page's binding table (binary framing)
 };
  
 class Environment;
@@ -0,0 +1,169 @@
+// list_diff.h
+#pragma once
+
+#include "jtml_value.h"
+#include "Array.h"
+#include "Dict.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace JTMLInterpreter {
+
+/**
+ * One row of a for-host: a stable key plus the row's display value.
+ * Dict items with an "id" (or "key") field are keyed by it, so editing the
+ * row keeps its identity; anything else is keyed by its value, with a
+ * "#n" suffix on repeats.
+ */
+struct ListEntry {
+    std::string key;
+    std::string value;
+};
+
+// What a row shows for its item (the item's text when not given)
+using RowRenderer = std::function<std::string(const std::shared_ptr<VarValue>&)>;
+
+// Number of rows a for-host iterates over
+inline size_t listLength(const std::shared_ptr<VarValue>& value) {
+    if (!value) return 0;
+    if (value->isArray()) return value->getArray()->getArrayData().size();
+    if (value->isString()) return value->getString().size();
+    return 0;
+}
+
+inline ListEntry listEntryOf(const std::shared_ptr<VarValue>& item, const RowRenderer& rowOf = RowRenderer()) {
+    ListEntry entry;
+    entry.value = item ? item->toString() : "";
+    entry.key = "v:" + entry.value;
+    if (rowOf) {
+        entry.value = rowOf(item);
+    }
+    if (item && item->isDict()) {
+        const auto& fields = item->getDict()->getDictData();
+        auto idIt = fields.find("id");
+        if (idIt == fields.end()) idIt = fields.find("key");
+        if (idIt != fields.end() && idIt->second) {
+            entry.key = "k:" + idIt->second->toString();
+        }
+    }
+    return entry;
+}
+
+// Rows [first, first + count) of a for-host's list, shown through `rowOf`.
+// Only those items are converted, so a windowed host costs what its window
+// holds; repeats are counted from `first`.
+inline std::vector<ListEntry> listEntriesOf(const std::shared_ptr<VarValue>& value, const RowRenderer& rowOf,
+                                            size_t first = 0, size_t count = static_cast<size_t>(-1)) {
+    std::vector<ListEntry> entries;
+    const size_t length = listLength(value);
+    if (first >= length) return entries;
+    const size_t last = length - first < count ? length : first + count;
+    entries.reserve(last - first);
+
+    std::unordered_map<std::string, int> seen;
+    for (size_t i = first; i < last; ++i) {
+        ListEntry entry = value->isArray()
+            ? listEntryOf(value->getArray()->getArrayData()[i], rowOf)
+            : listEntryOf(std::make_shared<VarValue>(std::string(1, value->getString()[i])), rowOf);
+        int repeat = seen[entry.key]++;
+        if (repeat > 0) entry.key += "#" + std::to_string(repeat);
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+inline std::vector<ListEntry> listEntriesOf(const std::shared_ptr<VarValue>& value,
+                                            size_t first = 0, size_t count = static_cast<size_t>(-1)) {
+    return listEntriesOf(value, RowRenderer(), first, count);
+}
+
+/**
+ * A patch step, applied in order to the host's current rows:
+ *   'r' index            remove the row
+ *   'd' index            detach the row, keeping it by its key
+ *   'a' index key        re-attach a detached row at index
+ *   'i' index key value  insert a new row at index
+ *   'u' index value      the row at index keeps its key but shows value
+ */
+struct ListOp {
+    char kind;
+    size_t index;
+    std::string key;
+    std::string value;
+};
+
+/**
+ * Keyed diff of two lists. Rows whose relative order survives (a longest
+ * increasing subsequence of their old positions) stay put; other kept rows
+ * are detached and re-attached, missing ones removed, new ones inserted.
+ * Removes/detaches run from the back, attaches/inserts from the front, so
+ * every index refers to the list as it is at that step.
+ */
+inline std::vector<ListOp> diffLists(const std::vector<ListEntry>& before, const std::vector<ListEntry>& after) {
+    std::unordered_map<std::string, size_t> oldIndex;
+    oldIndex.reserve(before.size());
+    for (size_t i = 0; i < before.size(); ++i) {
+        oldIndex.emplace(before[i].key, i);
+    }
+
+    // Old position of each new row (or npos when it is new)
+    const size_t NONE = static_cast<size_t>(-1);
+    std::vector<size_t> source(after.size(), NONE);
+    std::vector<bool> kept(before.size(), false);
+    for (size_t j = 0; j < after.size(); ++j) {
+        auto it = oldIndex.find(after[j].key);
+        if (it != oldIndex.end()) {
+            source[j] = it->second;
+            kept[it->second] = true;
+        }
+    }
+
+    // Longest increasing run of old positions => rows that need not move
+    std::vector<size_t> tails;        // indices into `after`
+    std::vector<size_t> prev(after.size(), NONE);
+    for (size_t j = 0; j < after.size(); ++j) {
+        if (source[j] == NONE) continue;
+        auto pos = std::lower_bound(tails.begin(), tails.end(), source[j],
+            [&](size_t t, size_t s) { return source[t] < s; });
+        if (pos != tails.begin()) prev[j] = *(pos - 1);
+        if (pos == tails.end()) tails.push_back(j);
+        else *pos = j;
+    }
+    std::vector<bool> stable(after.size(), false);
+    for (size_t j = tails.empty() ? NONE : tails.back(); j != NONE; j = prev[j]) {
+        stable[j] = true;
+    }
+    std::vector<bool> staysInPlace(before.size(), false);
+    for (size_t j = 0; j < after.size(); ++j) {
+        if (stable[j]) staysInPlace[source[j]] = true;
+    }
+
+    std::vector<ListOp> ops;
+    for (size_t i = before.size(); i-- > 0;) {
+        if (!kept[i]) {
+            ops.push_back({'r', i, "", ""});
+        } else if (!staysInPlace[i]) {
+            ops.push_back({'d', i, "", ""});
+        }
+    }
+    for (size_t j = 0; j < after.size(); ++j) {
+        if (source[j] == NONE) {
+            ops.push_back({'i', j, after[j].key, after[j].value});
+            continue;
+        }
+        if (!stable[j]) {
+            ops.push_back({'a', j, after[j].key, ""});
+        }
+        if (before[source[j]].value != after[j].value) {
+            ops.push_back({'u', j, "", after[j].value});
+        }
+    }
+    return ops;
+}
+
+} // namespace JTMLInterpreter
@@ -0,0 +1,74 @@
+// mapped_file.h
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * MappedFile
+ * Read-only view of a source file. On POSIX systems the file is memory-mapped,
+ * so the lexer scans the page cache directly instead of a heap copy of the
+ * whole input. Elsewhere (or if mmap fails) the file is read into memory.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat st {};
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr != MAP_FAILED) {
+                    ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                    m_data = static_cast<const char*>(addr);
+                    m_size = static_cast<size_t>(st.st_size);
+                    m_mapped = true;
+                }
+            }
+            ::close(fd);
+            if (m_mapped) return;
+        }
+#endif
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs.is_open()) {
+            throw std::runtime_error("Cannot open file: " + path);
+        }
+        std::ostringstream oss;
+        oss << ifs.rdbuf();
+        m_buffer = oss.str();
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (m_mapped) {
+            ::munmap(const_cast<char*>(m_data), m_size);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+    size_t size() const { return m_size; }
+    bool isMapped() const { return m_mapped; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    std::string m_buffer;  // fallback storage when the file is not mapped
+};
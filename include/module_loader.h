@@ -0,0 +1,65 @@
+// module_loader.h
+#pragma once
+
+#include "jtml_ast.h"
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A parsed .jtml module, shared read-only between every page (interpreter)
+ * that imports it.
+ */
+struct Module {
+    std::string path;                          // canonical path
+    uint64_t sourceHash = 0;
+    std::vector<std::unique_ptr<ASTNode>> program;
+    std::vector<std::string> imports;          // canonical paths of direct imports
+    std::vector<std::string> errors;           // lexer/parser errors
+};
+
+/**
+ * ModuleLoader
+ * Process-wide cache of compiled modules keyed by canonical path.
+ *
+ * A cached module is reused as long as the file's content hash is unchanged,
+ * so only edited modules are lexed and parsed again. preload() walks the
+ * import graph breadth-first and compiles each level's modules in parallel
+ * on a thread pool.
+ */
+class ModuleLoader {
+public:
+    static ModuleLoader& instance();
+
+    // Optional .jtmlc cache directory for module ASTs (see ProgramCache)
+    void setCacheDirectory(const std::string& dir);
+
+    // Resolve an import path relative to the importing file's directory
+    static std::string resolve(const std::string& importPath, const std::string& baseDir);
+    static std::string directoryOf(const std::string& path);
+
+    // Compile (or reuse) every module reachable from the program's imports
+    void preload(const std::vector<std::unique_ptr<ASTNode>>& program, const std::string& baseDir);
+
+    // Fetch a single module by canonical path, compiling it if stale or missing
+    std::shared_ptr<const Module> load(const std::string& canonicalPath);
+
+private:
+    ModuleLoader() = default;
+
+    std::shared_ptr<const Module> compile(const std::string& canonicalPath, uint64_t sourceHash,
+                                          std::string_view source) const;
+    JTMLInterpreter::ThreadPool& pool();
+
+    mutable std::mutex modulesMutex;
+    std::unordered_map<std::string, std::shared_ptr<const Module>> modules;
+    std::string cacheDir;
+
+    std::once_flag poolOnce;
+    std::unique_ptr<JTMLInterpreter::ThreadPool> workerPool;
+};
@@ -0,0 +1,65 @@
+// mpsc_queue.h
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace JTMLInterpreter {
+
+/**
+ * MpscQueue
+ * Unbounded lock-free FIFO for many producers and one consumer (Vyukov's
+ * node-based queue). push() is one atomic exchange, so I/O threads never
+ * wait on each other or on the consumer.
+ *
+ * A push is visible to pop() once its producer has linked it in: between
+ * the exchange and the link pop() can briefly report empty although a
+ * later push already finished. Callers that count pushes retry.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head(new Node()), tail(head.load(std::memory_order_relaxed)) {}
+
+    ~MpscQueue() {
+        T discarded;
+        while (pop(discarded)) {
+        }
+        delete tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread
+    void push(T value) {
+        Node* node = new Node(std::move(value));
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer thread only
+    bool pop(T& value) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(next->value);
+        delete tail;
+        tail = next;  // `next` is the new stub; its value was moved out
+        return true;
+    }
+
+private:
+    struct Node {
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    std::atomic<Node*> head;  // last pushed node (producers)
+    Node* tail;               // stub before the oldest node (consumer)
+};
+
+} // namespace JTMLInterpreter
@@ -0,0 +1,194 @@
+// outbound_queue.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace JTMLInterpreter {
+
+/**
+ * What a connection's outbound queue does once a slow client lets it fill:
+ *   DropOldest  discard the oldest frames; the client is then told to resync
+ *   Conflate    a frame replaces any queued one with the same key (a newer
+ *               value of the same binding); past the limit, as DropOldest
+ *   Disconnect  close the connection
+ */
+enum class BackpressurePolicy {
+    DropOldest,
+    Conflate,
+    Disconnect
+};
+
+/**
+ * Outbound priority, highest first. A connection's queue sends what waits
+ * in a higher lane before anything in a lower one; within a lane, frames
+ * keep their order.
+ *   Interactive  replies to the connection's own input (its event acks,
+ *                list windows it scrolled to, errors)
+ *   Updates      binding changes
+ *   Bulk         snapshots and injected HTML
+ */
+enum class Lane : uint8_t {
+    Interactive,
+    Updates,
+    Bulk
+};
+
+constexpr size_t LANE_COUNT = 3;
+
+/**
+ * A queued frame. The message is reference counted: a broadcast builds it
+ * once and pushes the same pointer to every connection's queue.
+ */
+template <typename Message>
+struct OutboundFrame {
+    std::shared_ptr<Message> message;
+    size_t bytes = 0;   // payload size, counted against the queue's limit
+    std::string key;    // conflation key; empty for frames that never merge
+    Lane lane = Lane::Updates;
+};
+
+/**
+ * OutboundQueue
+ * Frames waiting for one connection, bounded by count and bytes and popped
+ * by lane. Not synchronized: the server holds the connection's lock around
+ * it.
+ *
+ * Keyed updates carry a binding's whole value and a version the client
+ * orders them by, but a keyless one (a list patch, a batch) applies on top
+ * of what came before it. So an Interactive frame overtakes Updates only
+ * while none of them is keyless, and otherwise queues behind them. Bulk is
+ * overtaken regardless: the client re-applies what passed a snapshot.
+ */
+template <typename Message>
+class OutboundQueue {
+public:
+    typedef OutboundFrame<Message> Frame;
+
+    static constexpr size_t DEFAULT_MAX_FRAMES = 1024;
+    static constexpr size_t DEFAULT_MAX_BYTES = 4 << 20;
+
+    // What the queue spared the connection so far
+    struct Stats {
+        size_t conflated = 0;       // frames replaced by a newer one
+        size_t conflatedBytes = 0;
+        size_t dropped = 0;         // frames discarded past the limit
+        size_t droppedBytes = 0;
+    };
+
+    enum class PushResult {
+        Queued,
+        Conflated,  // replaced a queued frame with the same key
+        Dropped,    // older frames were discarded to make room
+        Overflow    // Disconnect policy: the queue is full, nothing queued
+    };
+
+    explicit OutboundQueue(BackpressurePolicy policy = BackpressurePolicy::Conflate,
+                           size_t maxFrames = DEFAULT_MAX_FRAMES, size_t maxBytes = DEFAULT_MAX_BYTES)
+        : m_policy(policy), m_maxFrames(maxFrames), m_maxBytes(maxBytes) {}
+
+    PushResult push(Frame frame) {
+        PushResult result = PushResult::Queued;
+        if (frame.lane == Lane::Interactive && m_keyless[index(Lane::Updates)] > 0) {
+            frame.lane = Lane::Updates;
+        }
+        std::deque<Frame>& lane = m_lanes[index(frame.lane)];
+        if (m_policy == BackpressurePolicy::Conflate && !frame.key.empty()) {
+            // The replaced frame goes and the new one joins the back, so it
+            // still follows everything that was queued after the old one
+            for (auto it = lane.begin(); it != lane.end(); ++it) {
+                if (it->key == frame.key) {
+                    ++m_stats.conflated;
+                    m_stats.conflatedBytes += it->bytes;
+                    forget(*it);
+                    lane.erase(it);
+                    result = PushResult::Conflated;
+                    break;
+                }
+            }
+        }
+        if (m_policy == BackpressurePolicy::Disconnect &&
+            overLimit(m_count + 1, m_bytes + frame.bytes)) {
+            return PushResult::Overflow;
+        }
+        count(frame);
+        lane.push_back(std::move(frame));
+        // Lowest lane first; the frame just queued stays
+        while (m_count > 1 && overLimit(m_count, m_bytes)) {
+            for (size_t i = LANE_COUNT; i-- > 0;) {
+                std::deque<Frame>& victim = m_lanes[i];
+                if (victim.empty() || (&victim == &lane && victim.size() == 1)) {
+                    continue;
+                }
+                ++m_stats.dropped;
+                m_stats.droppedBytes += victim.front().bytes;
+                forget(victim.front());
+                victim.pop_front();
+                break;
+            }
+            m_resync = true;
+            result = PushResult::Dropped;
+        }
+        return result;
+    }
+
+    // Once frames were dropped the client's state has a gap: the sender
+    // asks it to resync (once) before sending the rest
+    bool takeResync() {
+        bool resync = m_resync;
+        m_resync = false;
+        return resync;
+    }
+
+    // The oldest frame of the highest lane that has one
+    bool pop(Frame& frame) {
+        for (std::deque<Frame>& lane : m_lanes) {
+            if (lane.empty()) continue;
+            forget(lane.front());
+            frame = std::move(lane.front());
+            lane.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    bool empty() const { return m_count == 0 && !m_resync; }
+    size_t size() const { return m_count; }
+    size_t size(Lane lane) const { return m_lanes[index(lane)].size(); }
+    size_t bytes() const { return m_bytes; }
+    const Stats& stats() const { return m_stats; }
+
+private:
+    static size_t index(Lane lane) { return static_cast<size_t>(lane); }
+
+    bool overLimit(size_t frames, size_t bytes) const {
+        return frames > m_maxFrames || bytes > m_maxBytes;
+    }
+
+    void count(const Frame& frame) {
+        ++m_count;
+        m_bytes += frame.bytes;
+        if (frame.key.empty()) ++m_keyless[index(frame.lane)];
+    }
+
+    void forget(const Frame& frame) {
+        --m_count;
+        m_bytes -= frame.bytes;
+        if (frame.key.empty()) --m_keyless[index(frame.lane)];
+    }
+
+    BackpressurePolicy m_policy;
+    size_t m_maxFrames;
+    size_t m_maxBytes;
+    std::deque<Frame> m_lanes[LANE_COUNT];
+    size_t m_keyless[LANE_COUNT] = {};
+    size_t m_count = 0;
+    size_t m_bytes = 0;
+    bool m_resync = false;
+    Stats m_stats;
+};
+
+} // namespace JTMLInterpreter
@@ -0,0 +1,88 @@
+// output_sink.h
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/**
+ * OutputSink
+ * Append-only writer the transpiler streams a page into. Markup goes out
+ * as is; writeText() escapes text and attribute values as escapeHTML does.
+ *
+ * The sink either accumulates into a string (take()) or flushes fixed-size
+ * chunks to a std::ostream (file, socket stream) as they fill.
+ */
+class OutputSink {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    OutputSink() = default;
+    explicit OutputSink(std::ostream& target) : m_target(&target) {}
+
+    ~OutputSink() { flush(); }
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    OutputSink& write(std::string_view markup) {
+        append(markup);
+        return *this;
+    }
+
+    // Text content / attribute value, escaped
+    OutputSink& writeText(std::string_view text) {
+        size_t plainStart = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const char* entity = entityFor(text[i]);
+            if (!entity) continue;
+            append(text.substr(plainStart, i - plainStart));
+            append(entity);
+            plainStart = i + 1;
+        }
+        append(text.substr(plainStart));
+        return *this;
+    }
+
+    OutputSink& operator<<(std::string_view markup) { return write(markup); }
+    OutputSink& operator<<(char c) { return write(std::string_view(&c, 1)); }
+    OutputSink& operator<<(int n) { return write(std::to_string(n)); }
+
+    // Bytes written so far, including chunks already flushed
+    size_t position() const { return m_flushed + m_buffer.size(); }
+
+    void flush() {
+        if (m_target && !m_buffer.empty()) {
+            m_target->write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            m_flushed += m_buffer.size();
+            m_buffer.clear();
+        }
+    }
+
+    // Accumulated output of a string sink
+    std::string take() { return std::move(m_buffer); }
+
+private:
+    static const char* entityFor(char c) {
+        switch (c) {
+            case '<':  return "&lt;";
+            case '>':  return "&gt;";
+            case '&':  return "&amp;";
+            case '"':  return "&quot;";
+            case '\'': return "&#39;";
+            default:   return nullptr;
+        }
+    }
+
+    void append(std::string_view s) {
+        m_buffer.append(s.data(), s.size());
+        if (m_target && m_buffer.size() >= CHUNK_SIZE) {
+            flush();
+        }
+    }
+
+    std::ostream* m_target = nullptr;
+    std::string m_buffer;
+    size_t m_flushed = 0;
+};
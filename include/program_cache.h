@@ -0,0 +1,64 @@
+// program_cache.h
+#pragma once
+
+#include "jtml_ast.h"
+#include "binding_table.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Everything the front end (lexer -> parser -> compiler) produces for one
+ * source file. Stored in a .jtmlc cache entry so a restart can skip the front
+ * end entirely when the source has not changed.
+ */
+struct CompiledProgram {
+    uint64_t sourceHash = 0;
+
+    // Top-level statements from Parser::parseProgram()
+    std::vector<std::unique_ptr<ASTNode>> program;
+
+    // JtmlTranspiler::compile() output; only valid when hasHtml is set
+    bool hasHtml = false;
+    std::string html;
+    BindingTable bindings;
+};
+
+/**
+ * ProgramCache
+ * Reads and writes precompiled programs (.jtmlc). Entries are keyed by a hash
+ * of the source text and live beside the source (foo.jtml -> foo.jtmlc) or,
+ * when a cache directory is given, in <cacheDir>/<hash>.jtmlc.
+ *
+ * The format is a flat little-endian byte stream of the AST plus the
+ * compiler's binding table and HTML. Loading maps the file and rebuilds the
+ * nodes in a single pass; any mismatch (magic, format version, hash) is
+ * treated as a miss.
+ */
+class ProgramCache {
+public:
+    explicit ProgramCache(std::string cacheDir = "");
+
+    // 64-bit FNV-1a over the source text
+    static uint64_t hashSource(std::string_view source);
+
+    // Location of the cache entry for a source file (sourcePath may be empty
+    // when a cache directory is configured, e.g. for in-memory sources)
+    std::string entryPath(const std::string& sourcePath, uint64_t sourceHash) const;
+
+    // Returns true and fills `out` if a valid entry for sourceHash exists
+    bool load(const std::string& sourcePath, uint64_t sourceHash, CompiledProgram& out) const;
+
+    // Writes (or replaces) the entry; failures are logged, never thrown
+    void store(const std::string& sourcePath, const CompiledProgram& compiled) const;
+
+    static std::string serialize(const CompiledProgram& compiled);
+    static void deserialize(std::string_view bytes, CompiledProgram& out);
+
+private:
+    std::string m_cacheDir;
+};
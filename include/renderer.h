@@ -4,48 +4,189 @@
 
 #include <string>
 #include <functional>
+#include <memory>
 #include <unordered_map>
-#include <iostream>
+#include <unordered_set>
 #include <mutex>
+#include <atomic>
+#include <vector>
 #include "jtml_value.h"
+#include "list_diff.h"
+#include "text_delta.h"
+#include "wire_format.h"
+#include "outbound_queue.h"
+#include "state_journal.h"
 
 
 
 
 namespace JTMLInterpreter {
 
-  
     class Renderer {
     public:
-        Renderer() {
-          
+        // Content this long is tracked, and its changes sent as a splice of
+        // the previous value while that is under half the size
+        static constexpr size_t SPLICE_MIN_BYTES = 1024;
+
+        // The journal keeps up to `journalEntries` changes / `journalBytes`
+        // for resuming clients
+        explicit Renderer(size_t journalEntries = StateJournal::DEFAULT_MAX_ENTRIES,
+                          size_t journalBytes = StateJournal::DEFAULT_MAX_BYTES)
+            : stateJournal(journalEntries, journalBytes) {
             }
 
-        // Destructor
-        ~Renderer() {
-            std::cout << "[DEBUG] Renderer destroyed\n";
+        // A message for the frontend: JSON text and, when it has one, a
+        // binary record for connections that negotiated binary framing.
+        // Messages that only carry a binding's latest value have a
+        // conflation `key` (a queued one with the same key is superseded);
+        // others have none. The `lane` is its priority: errors are
+        // Interactive, changes Updates and injected HTML Bulk. A change of a
+        // compiled binding names its slot, so it can go to just the clients
+        // showing that slot. A keyed change also carries its text as it was
+        // before the version stamp: the value a client is compared against,
+        // to skip sending it what it already has.
+        struct Message {
+            std::string text;
+            std::string binary;
+            std::string key;
+            Lane lane = Lane::Updates;
+            uint32_t bindingId = NO_BINDING_ID;
+            std::shared_ptr<const std::string> value;
+        };
+
+        // Set the callback to communicate with the frontend (e.g., WebSocket sender).
+        // It is called in version order, with none of the renderer's locks held.
+        void setFrontendCallback(std::function<void(const Message&)> callback) {
+            frontendCallback = callback;
         }
-        // Set the callback to communicate with the frontend (e.g., WebSocket sender)
-        void setFrontendCallback(std::function<void(const std::string&)> callback) {
-            sendToFrontend = callback;
+
+        // Binary records are only built while some connection reads them
+        // (JSON always is: the state journal keeps it for resuming clients)
+        void setBinaryWanted(bool binary) {
+            binaryWanted = binary;
+        }
+
+        // Versioned log of the changes sent, plus the cached snapshot
+        StateJournal& journal() { return stateJournal; }
+
+        // Changes sent, and the ones that never went out: long content set
+        // to the text it had, or a change superseded within a batch. (Values
+        // a connection already has are skipped per connection, as it is sent.)
+        struct Stats {
+            uint64_t sent = 0;
+            uint64_t unchanged = 0;
+            uint64_t unchangedBytes = 0;
+            uint64_t conflated = 0;
+            uint64_t conflatedBytes = 0;
+            uint64_t spliced = 0;       // sent as a splice of the value before
+            uint64_t splicedBytesSaved = 0;
+        };
+
+        Stats stats() {
+            std::lock_guard<std::mutex> lock(sendMutex);
+            return trafficStats;
         }
 
         // Inject initial HTML into the DOM
         void injectHTML(const std::string& htmlContent) {
             std::string message = "{\"type\": \"injectHTML\", \"content\": \"" + escapeJSON(htmlContent) + "\"}";
-            sendToFrontend(message);
+            sendToFrontend({ message, std::string(), std::string(), Lane::Bulk });
         }
 
         // Update content bindingsMap
-        void sendBindingUpdate(const std::string& elementId, const std::string& newValue) {
+        void sendBindingUpdate(const std::string& elementId, const std::string& newValue,
+                               uint32_t bindingId = NO_BINDING_ID) {
+            if (sendTextDelta(elementId, newValue, bindingId)) {
+                return;
+            }
+            std::string binary = binaryRecord(WireOp::Content, bindingId, newValue);
             std::string message = "{\"type\": \"updateBinding\", \"elementId\": \"" + elementId + "\", \"value\": \"" + escapeJSON(newValue) + "\"}";
-            sendToFrontend(message);
+            sendChange(message, binary, "c:" + elementId, bindingId);
         }
 
         // Update attribute bindingsMap
-        void sendAttributeUpdate(const std::string& elementId, const std::string& attribute, const std::string& newValue) {
+        void sendAttributeUpdate(const std::string& elementId, const std::string& attribute, const std::string& newValue,
+                                 uint32_t bindingId = NO_BINDING_ID) {
+            std::string binary = binaryRecord(WireOp::Attribute, bindingId, newValue);
             std::string message = "{\"type\": \"updateAttribute\", \"elementId\": \"" + elementId + "\", \"attribute\": \"" + attribute + "\", \"value\": \"" + escapeJSON(newValue) + "\"}";
-            sendToFrontend(message);
+            sendChange(message, binary, "a:" + elementId + ":" + attribute, bindingId);
+        }
+
+        // Toggle an if-host between its then/else templates
+        void sendConditionUpdate(const std::string& elementId, const std::string& newValue,
+                                 uint32_t bindingId = NO_BINDING_ID) {
+            std::string binary = binaryRecord(WireOp::If, bindingId, newValue);
+            std::string message = "{\"type\": \"updateIf\", \"elementId\": \"" + elementId + "\", \"value\": \"" + escapeJSON(newValue) + "\"}";
+            sendChange(message, binary, "i:" + elementId, bindingId);
+        }
+
+        // Windowed for-hosts show a different slice on every connection;
+        // their changes go to this callback instead of being broadcast
+        void setWindowedListCallback(std::function<void(const std::string&)> callback) {
+            windowedListChanged = std::move(callback);
+        }
+
+        void markWindowedList(const std::string& elementId) {
+            std::lock_guard<std::mutex> lock(bindingsMutex);
+            windowedLists.insert(elementId);
+        }
+
+        // What each row of a for-host shows of its item (its text unless set)
+        void setRowRenderer(const std::string& elementId, RowRenderer rowOf) {
+            std::lock_guard<std::mutex> lock(bindingsMutex);
+            rowRenderers[elementId] = std::move(rowOf);
+        }
+
+        // Bring a for-host to `list`: a keyed patch against the rows last
+        // sent for it, or the whole list the first time (or when the patch
+        // would not be smaller than the list)
+        void sendListUpdate(const std::string& elementId, const std::shared_ptr<VarValue>& list,
+                            uint32_t bindingId = NO_BINDING_ID) {
+            bool windowed;
+            RowRenderer rowOf;
+            {
+                std::lock_guard<std::mutex> lock(bindingsMutex);
+                windowed = windowedLists.count(elementId) > 0;
+                auto it = rowRenderers.find(elementId);
+                if (it != rowRenderers.end()) rowOf = it->second;
+            }
+            if (windowed) {
+                if (windowedListChanged) windowedListChanged(elementId);
+                return;
+            }
+            const std::vector<ListEntry> entries = listEntriesOf(list, rowOf);
+            std::vector<ListOp> ops;
+            bool full = true;
+            {
+                std::lock_guard<std::mutex> lock(bindingsMutex);
+                auto it = lastLists.find(elementId);
+                if (it != lastLists.end()) {
+                    ops = diffLists(it->second, entries);
+                    full = ops.size() > entries.size() / 2 + 1;
+                }
+                lastLists[elementId] = entries;
+            }
+            if (full) {
+                sendChange("{\"type\": \"updateFor\", \"elementId\": \"" + elementId + "\", \"list\": " + listJSON(entries) + "}",
+                           std::string(), std::string(), bindingId);
+                return;
+            }
+            if (ops.empty()) {
+                return;
+            }
+            std::string message = "{\"type\": \"patchFor\", \"elementId\": \"" + elementId + "\", \"ops\": [";
+            for (size_t i = 0; i < ops.size(); ++i) {
+                const ListOp& op = ops[i];
+                if (i > 0) message += ",";
+                message += "[\"";
+                message += op.kind;
+                message += "\"," + std::to_string(op.index);
+                if (op.kind == 'a' || op.kind == 'i') message += ",\"" + escapeJSON(op.key) + "\"";
+                if (op.kind == 'i' || op.kind == 'u') message += ",\"" + escapeJSON(op.value) + "\"";
+                message += "]";
+            }
+            message += "]}";
+            sendChange(message, std::string(), std::string(), bindingId);
         }
 
         // Send batch updates
@@ -69,26 +210,249 @@ namespace JTMLInterpreter {
             }
             message += "}}";
 
-            sendToFrontend(message);
+            sendChange(message);
         }
 
        
         // Send error messages
         void sendError(const std::string& errorMessage) {
             std::string message = "{\"type\": \"error\", \"message\": \"" + escapeJSON(errorMessage) + "\"}";
-            sendToFrontend(message);
+            sendToFrontend({ message, std::string(), std::string(), Lane::Interactive });
+        }
+
+        // Changes made between beginTransaction() and endTransaction() are
+        // journaled as usual but held back, and handed over by
+        // endTransaction() as one batch: a binding changed several times
+        // is in it once, with its last value
+        struct Batch {
+            std::vector<std::string> updates;  // JSON messages, in order
+            std::string binary;                // their records, unless one had none
+            std::vector<uint32_t> bindingIds;  // the slot of each update
+        };
+
+        void beginTransaction() {
+            std::lock_guard<std::mutex> lock(sendMutex);
+            inTransaction = true;
         }
 
-        // Send acknowledgment messages
-        void sendAcknowledgment(const std::string& messageId) {
-            std::string message = "{\"type\": \"acknowledgment\", \"messageId\": \"" + messageId + "\"}";
-            sendToFrontend(message);
+        Batch endTransaction() {
+            std::vector<Message> changes;
+            {
+                std::lock_guard<std::mutex> lock(sendMutex);
+                inTransaction = false;
+                changes.swap(held);
+            }
+            // Newest first, so the first change seen for a key is its last
+            std::vector<const Message*> kept;
+            std::unordered_set<std::string> seen;
+            uint64_t conflated = 0;
+            uint64_t conflatedBytes = 0;
+            for (auto it = changes.rbegin(); it != changes.rend(); ++it) {
+                if (it->key.empty() || seen.insert(it->key).second) {
+                    kept.push_back(&*it);
+                } else {
+                    ++conflated;
+                    conflatedBytes += it->text.size();
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(sendMutex);
+                trafficStats.sent += kept.size();
+                trafficStats.conflated += conflated;
+                trafficStats.conflatedBytes += conflatedBytes;
+            }
+            Batch batch;
+            bool allBinary = !kept.empty();
+            for (auto it = kept.rbegin(); it != kept.rend(); ++it) {
+                batch.updates.push_back(std::move((*it)->text));
+                batch.bindingIds.push_back((*it)->bindingId);
+                allBinary = allBinary && !(*it)->binary.empty();
+            }
+            if (allBinary) {
+                for (auto it = kept.rbegin(); it != kept.rend(); ++it) {
+                    batch.binary += (*it)->binary;
+                }
+            }
+            return batch;
         }
 
     private:
         // Communication with frontend (e.g., WebSocket client)
         std::mutex bindingsMutex;
-        std::function<void(const std::string&)> sendToFrontend;
+        std::function<void(const Message&)> frontendCallback;
+        std::atomic<bool> binaryWanted{false};
+        std::mutex sendMutex;
+        StateJournal stateJournal;
+
+        // Changes held back by an open transaction (guarded by sendMutex)
+        bool inTransaction = false;
+        std::vector<Message> held;
+
+        Stats trafficStats;  // guarded by sendMutex
+
+        // Messages waiting for the callback, in version order (guarded by
+        // sendMutex). The callback runs without the lock held: the thread
+        // that finds no delivery in progress hands over messages until the
+        // outbox is empty, including any queued meanwhile.
+        std::vector<Message> outbox;
+        bool delivering = false;
+
+        // Caller holds sendMutex; true if the caller must deliver()
+        bool enqueue(Message message) {
+            outbox.push_back(std::move(message));
+            if (delivering) {
+                return false;
+            }
+            delivering = true;
+            return true;
+        }
+
+        // Caller holds no lock
+        void deliver() {
+            std::vector<Message> pending;
+            for (;;) {
+                {
+                    std::lock_guard<std::mutex> lock(sendMutex);
+                    if (outbox.empty()) {
+                        delivering = false;
+                        return;
+                    }
+                    pending.swap(outbox);
+                }
+                for (const Message& message : pending) {
+                    if (frontendCallback) {
+                        frontendCallback(message);
+                    }
+                }
+                pending.clear();
+            }
+        }
+
+        void sendToFrontend(Message message) {
+            bool deliverNow;
+            {
+                std::lock_guard<std::mutex> lock(sendMutex);
+                deliverNow = enqueue(std::move(message));
+            }
+            if (deliverNow) {
+                deliver();
+            }
+        }
+
+        // A state change: stamped with the next journal version and logged
+        // before it goes out, so versions reach clients in order. List
+        // patches never get a `key`: each one builds on the one before.
+        void sendChange(std::string text, std::string binary = std::string(), const std::string& key = std::string(),
+                        uint32_t bindingId = NO_BINDING_ID) {
+            std::shared_ptr<const std::string> value;
+            if (!key.empty()) {
+                value = std::make_shared<const std::string>(text);
+            }
+            std::unique_lock<std::mutex> lock(sendMutex);
+            const uint64_t version = stateJournal.version() + 1;
+            text.insert(text.size() - 1, ", \"version\": " + std::to_string(version));
+            if (!binary.empty()) {
+                std::string framed(1, static_cast<char>(WireOp::Version));
+                appendVarint(framed, version);
+                binary.insert(0, framed);
+            }
+            stateJournal.record(version, text);
+            if (inTransaction) {
+                held.push_back({ std::move(text), std::move(binary), key, Lane::Updates, bindingId, value });
+                return;
+            }
+            ++trafficStats.sent;
+            const bool deliverNow = enqueue({ std::move(text), std::move(binary), key, Lane::Updates, bindingId, std::move(value) });
+            lock.unlock();
+            if (deliverNow) {
+                deliver();
+            }
+        }
+
+        // Content is tracked once it reaches SPLICE_MIN_BYTES (false until
+        // then: the caller sends it as usual). A change of tracked content
+        // is a spliceBinding when the splice is small enough, naming the
+        // hash and UTF-16 length of the text it applies to; otherwise the
+        // whole value. Neither has a conflation key, as a splice builds on
+        // the message before it.
+        bool sendTextDelta(const std::string& elementId, const std::string& newValue, uint32_t bindingId) {
+            std::string before;
+            bool tracked;
+            {
+                std::lock_guard<std::mutex> lock(bindingsMutex);
+                auto it = lastTexts.find(elementId);
+                tracked = it != lastTexts.end();
+                if (!tracked && newValue.size() < SPLICE_MIN_BYTES) {
+                    return false;
+                }
+                if (tracked) {
+                    before = std::move(it->second);
+                    it->second = newValue;
+                } else {
+                    lastTexts.emplace(elementId, newValue);
+                }
+            }
+            if (tracked && before == newValue) {
+                std::lock_guard<std::mutex> lock(sendMutex);
+                ++trafficStats.unchanged;
+                trafficStats.unchangedBytes += newValue.size();
+                return true;
+            }
+            if (tracked) {
+                const TextSplice splice = diffText(before, newValue);
+                if (splice.insert.size() * 2 < newValue.size()) {
+                    std::string message = "{\"type\": \"spliceBinding\", \"elementId\": \"" + elementId +
+                        "\", \"at\": " + std::to_string(splice.at) +
+                        ", \"remove\": " + std::to_string(splice.remove) +
+                        ", \"insert\": \"" + escapeJSON(splice.insert) +
+                        "\", \"length\": " + std::to_string(utf16Length(before, 0, before.size())) +
+                        ", \"base\": " + std::to_string(utf16Hash(before)) + "}";
+                    {
+                        std::lock_guard<std::mutex> lock(sendMutex);
+                        ++trafficStats.spliced;
+                        if (newValue.size() > message.size()) {
+                            trafficStats.splicedBytesSaved += newValue.size() - message.size();
+                        }
+                    }
+                    sendChange(std::move(message), std::string(), std::string(), bindingId);
+                    return true;
+                }
+            }
+            std::string binary = binaryRecord(WireOp::Content, bindingId, newValue);
+            std::string message = "{\"type\": \"updateBinding\", \"elementId\": \"" + elementId + "\", \"value\": \"" + escapeJSON(newValue) + "\"}";
+            sendChange(std::move(message), std::move(binary), std::string(), bindingId);
+            return true;
+        }
+
+        // Binary form of an update, if any connection reads it and the
+        // binding has a slot id the client can resolve
+        std::string binaryRecord(WireOp op, uint32_t bindingId, const std::string& value) const {
+            std::string record;
+            if (binaryWanted && bindingId != NO_BINDING_ID) {
+                appendRecord(record, op, bindingId, value);
+            }
+            return record;
+        }
+        // Rows each for-host was last sent, the base of its next patch
+        std::unordered_map<std::string, std::vector<ListEntry>> lastLists;
+        std::unordered_set<std::string> windowedLists;
+        // For-hosts whose rows show more than their item's text
+        std::unordered_map<std::string, RowRenderer> rowRenderers;
+        // Last value of each tracked (long) content binding, by element
+        std::unordered_map<std::string, std::string> lastTexts;
+        std::function<void(const std::string&)> windowedListChanged;
+
+        // {"keys": [...], "items": [...]} as the client's renderFor expects it
+        std::string listJSON(const std::vector<ListEntry>& entries) {
+            std::string keys = "[";
+            std::string items = "[";
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (i > 0) { keys += ","; items += ","; }
+                keys += "\"" + escapeJSON(entries[i].key) + "\"";
+                items += "\"" + escapeJSON(entries[i].value) + "\"";
+            }
+            return "{\"keys\": " + keys + "], \"items\": " + items + "]}";
+        }
 
 
         // Simple JSON escaping function
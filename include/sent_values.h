@@ -0,0 +1,112 @@
+// sent_values.h
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace JTMLInterpreter {
+
+/**
+ * SentValues
+ * The last value each connection was sent for each binding slot, so a
+ * change that repeats it is not sent to that connection again. Values are
+ * compared in full (after their length); connections sent the same change
+ * share one copy of it.
+ *
+ * What a connection has is only known from what went out through here: a
+ * snapshot, a resume or values sent by other paths make the caller forget
+ * the connection (or the slots) instead.
+ *
+ * Called from the I/O threads (open, drop) and the executor.
+ */
+class SentValues {
+public:
+    typedef uint64_t Source;  // a ConnectionID
+    typedef uint32_t Slot;    // a BindingID
+    typedef std::shared_ptr<const std::string> Value;
+
+    // Changes one connection was spared
+    struct Stats {
+        uint64_t unchanged = 0;
+        uint64_t unchangedBytes = 0;
+    };
+
+    void open(Source source) {
+        std::lock_guard<std::mutex> lock(mutex);
+        connections[source];
+    }
+
+    // The sources in `sources` that do not have `value` for `slot` yet;
+    // they are recorded as having it. Sources not open are let through.
+    std::vector<Source> changed(const std::vector<Source>& sources, Slot slot, const Value& value) {
+        std::vector<Source> out;
+        out.reserve(sources.size());
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Source source : sources) {
+            auto it = connections.find(source);
+            if (it == connections.end()) {
+                out.push_back(source);
+                continue;
+            }
+            Connection& connection = it->second;
+            Value& last = connection.values[slot];
+            if (last && (last == value || (last->size() == value->size() && *last == *value))) {
+                ++connection.stats.unchanged;
+                connection.stats.unchangedBytes += value->size();
+                continue;
+            }
+            last = value;
+            out.push_back(source);
+        }
+        return out;
+    }
+
+    // `sources` were sent something for `slots` that is not a value to
+    // compare against (a patch, a splice, a batch): the next value goes out
+    void forget(const std::vector<Source>& sources, const std::vector<Slot>& slots) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Source source : sources) {
+            auto it = connections.find(source);
+            if (it == connections.end()) continue;
+            for (Slot slot : slots) {
+                it->second.values.erase(slot);
+            }
+        }
+    }
+
+    // The connection took a snapshot or replayed the journal
+    void forget(Source source) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = connections.find(source);
+        if (it != connections.end()) {
+            it->second.values.clear();
+        }
+    }
+
+    // A closed connection; returns what it was spared
+    Stats drop(Source source) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = connections.find(source);
+        if (it == connections.end()) {
+            return Stats();
+        }
+        Stats stats = it->second.stats;
+        connections.erase(it);
+        return stats;
+    }
+
+private:
+    struct Connection {
+        std::unordered_map<Slot, Value> values;
+        Stats stats;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<Source, Connection> connections;
+};
+
+} // namespace JTMLInterpreter
@@ -0,0 +1,108 @@
+// state_journal.h
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace JTMLInterpreter {
+
+/**
+ * StateJournal
+ * Versions every state change the renderer broadcasts and keeps the last
+ * ones (bounded by count and bytes), so a reconnecting client that reports
+ * the version it last saw gets just the changes since. It also caches the
+ * full-state snapshot, valid until the next change.
+ *
+ * Versions restart with the process; `epoch()` names this run so a client
+ * holding a version from an earlier one is sent the snapshot instead.
+ */
+class StateJournal {
+public:
+    static constexpr size_t DEFAULT_MAX_ENTRIES = 4096;
+    static constexpr size_t DEFAULT_MAX_BYTES = 1 << 20;
+
+    explicit StateJournal(size_t maxEntries = DEFAULT_MAX_ENTRIES, size_t maxBytes = DEFAULT_MAX_BYTES)
+        : m_maxEntries(maxEntries), m_maxBytes(maxBytes) {
+        std::random_device random;
+        std::ostringstream epoch;
+        epoch << std::hex << std::chrono::steady_clock::now().time_since_epoch().count() << '-' << random();
+        m_epoch = epoch.str();
+    }
+
+    const std::string& epoch() const { return m_epoch; }
+
+    uint64_t version() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_version;
+    }
+
+    // Log one change, already stamped with `version` (one past the current
+    // version; the single writer holds its own lock across stamp and record)
+    void record(uint64_t version, std::string message) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_version = version;
+        m_snapshot.clear();
+        m_compressedSnapshot.clear();
+        m_bytes += message.size();
+        m_log.push_back({ version, std::move(message) });
+        while (!m_log.empty() && (m_log.size() > m_maxEntries || m_bytes > m_maxBytes)) {
+            m_bytes -= m_log.front().message.size();
+            m_log.pop_front();
+        }
+    }
+
+    // Changes after `since` (in order); false when some were already
+    // dropped, or `since` is not a version of this run
+    bool changesSince(uint64_t since, std::vector<std::string>& out) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (since > m_version) return false;
+        if (since == m_version) return true;
+        if (m_log.empty() || m_log.front().version > since + 1) return false;
+        for (const auto& entry : m_log) {
+            if (entry.version > since) out.push_back(entry.message);
+        }
+        return true;
+    }
+
+    // Snapshot built at `version` (and its precompressed frame, if any);
+    // only kept if nothing changed meanwhile
+    void storeSnapshot(uint64_t version, std::string snapshot, std::string compressed = std::string()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (version == m_version) {
+            m_snapshot = std::move(snapshot);
+            m_compressedSnapshot = std::move(compressed);
+        }
+    }
+
+    bool cachedSnapshot(std::string& out, std::string* compressed = nullptr) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_snapshot.empty()) return false;
+        out = m_snapshot;
+        if (compressed) *compressed = m_compressedSnapshot;
+        return true;
+    }
+
+private:
+    struct Entry {
+        uint64_t version;
+        std::string message;
+    };
+
+    mutable std::mutex m_mutex;
+    std::string m_epoch;
+    uint64_t m_version = 0;
+    std::deque<Entry> m_log;
+    size_t m_bytes = 0;
+    size_t m_maxEntries;
+    size_t m_maxBytes;
+    std::string m_snapshot;
+    std::string m_compressedSnapshot;
+};
+
+} // namespace JTMLInterpreter
@@ -0,0 +1,99 @@
+// text_delta.h
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace JTMLInterpreter {
+
+/**
+ * One edit turning a text into another: replace `remove` characters at
+ * `at` with `insert`. Offsets count UTF-16 code units, as JavaScript
+ * strings do, so the client applies it with slice() or replaceData().
+ */
+struct TextSplice {
+    size_t at = 0;
+    size_t remove = 0;
+    std::string insert;  // UTF-8
+};
+
+// Lead byte of a UTF-8 sequence, or plain ASCII (not a continuation byte)
+inline bool isUtf8Boundary(const std::string& text, size_t pos) {
+    return pos >= text.size() || (static_cast<unsigned char>(text[pos]) & 0xC0) != 0x80;
+}
+
+// UTF-16 code units in the UTF-8 bytes [from, to)
+inline size_t utf16Length(const std::string& text, size_t from, size_t to) {
+    size_t units = 0;
+    for (size_t i = from; i < to; ++i) {
+        const unsigned char byte = static_cast<unsigned char>(text[i]);
+        if ((byte & 0xC0) != 0x80) {
+            units += byte >= 0xF0 ? 2 : 1;  // four-byte sequences are surrogate pairs
+        }
+    }
+    return units;
+}
+
+// FNV-1a over the text's UTF-16 code units; the client hashes the string
+// it shows the same way to check a splice's base
+inline uint32_t utf16Hash(const std::string& text) {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](uint32_t unit) {
+        hash ^= unit;
+        hash *= 16777619u;
+    };
+    for (size_t i = 0; i < text.size();) {
+        const unsigned char byte = static_cast<unsigned char>(text[i]);
+        uint32_t codePoint = byte;
+        size_t length = 1;
+        if (byte >= 0xF0) {
+            codePoint = byte & 0x07;
+            length = 4;
+        } else if (byte >= 0xE0) {
+            codePoint = byte & 0x0F;
+            length = 3;
+        } else if (byte >= 0xC0) {
+            codePoint = byte & 0x1F;
+            length = 2;
+        }
+        for (size_t k = 1; k < length && i + k < text.size(); ++k) {
+            codePoint = (codePoint << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+        }
+        if (codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            mix(0xD800 + (codePoint >> 10));
+            mix(0xDC00 + (codePoint & 0x3FF));
+        } else {
+            mix(codePoint);
+        }
+        i += length;
+    }
+    return hash;
+}
+
+// The single splice between `before` and `after`: what is left once their
+// common prefix and suffix (whole characters) are taken off. Covers
+// appends, prepends and one local edit.
+inline TextSplice diffText(const std::string& before, const std::string& after) {
+    const size_t shorter = std::min(before.size(), after.size());
+    size_t prefix = 0;
+    while (prefix < shorter && before[prefix] == after[prefix]) ++prefix;
+    while (prefix > 0 && !isUtf8Boundary(before, prefix)) --prefix;
+
+    size_t suffix = 0;
+    while (suffix < shorter - prefix &&
+           before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) {
+        ++suffix;
+    }
+    while (suffix > 0 && !isUtf8Boundary(before, before.size() - suffix)) --suffix;
+
+    TextSplice splice;
+    splice.at = utf16Length(before, 0, prefix);
+    splice.remove = utf16Length(before, prefix, before.size() - suffix);
+    splice.insert = after.substr(prefix, after.size() - suffix - prefix);
+    return splice;
+}
+
+} // namespace JTMLInterpreter
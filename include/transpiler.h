@@ -1,10 +1,15 @@
 #ifndef JTML_TRANSPILER_H
 #define JTML_TRANSPILER_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <ostream>
 #include "jtml_ast.h"      // Where ASTNode, JtmlElementNode, etc. are declared
+#include "binding_table.h"
+#include "output_sink.h"
 
 /**
  * A Transpiler that converts a JTML AST into HTML+JS placeholders.
@@ -13,38 +18,107 @@
  *  - Only conditionals/loops/show are allowed in an element node.
  *  - We produce {{varName}} placeholders for expressions,
  *    letting the Interpreter handle the logic.
+ *  - Every reactive hole gets a slot in the BindingTable as it is
+ *    emitted, so one pass yields both the page and the table the
+ *    Interpreter loads (no second walk in lockstep).
+ *  - Output streams into a single OutputSink. if/for/while bodies are
+ *    emitted once as <template id="tpl_N"> elements (hoisted to the end
+ *    of <body>) that the client clones; hosts reference them by id.
  */
+struct CompileResult {
+    std::string html;
+    BindingTable bindings;
+};
+
 class JtmlTranspiler {
 public:
     explicit JtmlTranspiler();
-    std::unordered_map<int, std::unordered_map<std::string, std::string>> nodeDerivedMap;
+
+    /**
+     * Compile a vector of AST nodes into a full HTML page string plus the
+     * binding table for its reactive holes.
+     */
+    CompileResult compile(const std::vector<std::unique_ptr<ASTNode>>& program);
+
+    /**
+     * Same, streaming the page to `target` in chunks instead of holding it.
+     */
+    BindingTable compile(const std::vector<std::unique_ptr<ASTNode>>& program, std::ostream& target);
 
     /**
      * Transpile a vector of AST nodes into a full HTML page string.
      */
     std::string transpile(const std::vector<std::unique_ptr<ASTNode>>& program);
 
+    /**
+     * Server-side rendering: splice current values into a compiled page at
+     * the slots' recorded offsets. valueOf returns false for a slot whose
+     * value is not available; that hole keeps its placeholder.
+     */
+    std::string render(const std::string& html, const BindingTable& table,
+                       const std::function<bool(BindingID, std::string&)>& valueOf);
+
+    /**
+     * A compiled (or rendered) page whose client connects to the WebSocket
+     * server on `port` instead of the default one.
+     */
+    static std::string withWebSocketPort(const std::string& html, uint16_t port);
+
 private:
     int uniqueElemId = 0;
     int uniqueVarId  = 0;
-    int nodeID = 0;
+    int uniqueTemplateId = 0;
+
+    BindingTable bindings;
+    // > 0 while emitting a for/while body: those holes are per-iteration
+    // templates on the client and get no server-side slot
+    int templateDepth = 0;
+
+    // Finished bodies waiting to be written after the page content
+    struct PendingTemplate {
+        std::string id;
+        std::string body;
+        std::vector<BindingID> holes;  // slots with offsets relative to body
+    };
+    std::vector<PendingTemplate> templates;
+    // Holes marked per open sink: [0] = page, then one per body being built
+    std::vector<std::vector<BindingID>> openHoles;
+    // For bodies being built, innermost last: the openHoles depth of the
+    // body and the holes its rows show (ones in templates nested in the
+    // body are not the row's)
+    struct RowBody {
+        size_t depth;
+        std::vector<RowHole> holes;
+    };
+    std::vector<RowBody> rowBodies;
+
+    std::string transpileTemplate(const std::vector<std::unique_ptr<ASTNode>>& body);
+
+    BindingTable compile(const std::vector<std::unique_ptr<ASTNode>>& program, OutputSink& out);
+
+    // Returns the new slot (valid until the next addSlot), or null inside a loop body
+    BindingSlot* addSlot(BindingKind kind, const std::string& name, const std::string& elementId,
+                         const ExpressionStatementNode* expr,
+                         const std::string& attribute = "", const std::string& iteratorName = "");
+    void markHole(BindingSlot* slot, const OutputSink& out, size_t length);
+    // Index of a new hole of the row body being emitted, or -1 outside one
+    int addRowHole(BindingKind kind, const ExpressionStatementNode* expr, const std::string& attribute = "");
 
-   
 
     // Internal dispatch
-    std::string transpileNode(const ASTNode& node, bool insideElement);
-    std::string transpileElement(const JtmlElementNode& elem);
-    std::string transpileIfTopLevel(const IfStatementNode& node);
-    std::string transpileIfInsideElement(const IfStatementNode& node);
-    std::string transpileForTopLevel(const ForStatementNode& node);
-    std::string transpileForInsideElement(const ForStatementNode& node);
-    std::string transpileWhileTopLevel(const WhileStatementNode& node);
-    std::string transpileWhileInsideElement(const WhileStatementNode& node);
-    std::string transpileShow(const ShowStatementNode& node);
+    void transpileNode(const ASTNode& node, bool insideElement, OutputSink& out);
+    void transpileElement(const JtmlElementNode& elem, OutputSink& out);
+    void transpileIfTopLevel(const IfStatementNode& node, OutputSink& out);
+    void transpileIfInsideElement(const IfStatementNode& node, OutputSink& out);
+    void transpileForTopLevel(const ForStatementNode& node, OutputSink& out);
+    void transpileForInsideElement(const ForStatementNode& node, OutputSink& out);
+    void transpileWhileTopLevel(const WhileStatementNode& node, OutputSink& out);
+    void transpileWhileInsideElement(const WhileStatementNode& node, OutputSink& out);
+    void transpileShow(const ShowStatementNode& node, OutputSink& out);
 
 
     // Helper for child nodes
-    std::string transpileChildren(const std::vector<std::unique_ptr<ASTNode>>& children, bool insideElement);
+    void transpileChildren(const std::vector<std::unique_ptr<ASTNode>>& children, bool insideElement, OutputSink& out);
 
     // Insert minimal <script> for placeholders
     std::string generateScriptBlock();
@@ -2,102 +2,585 @@
 
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
+#ifdef JTML_WITH_DEFLATE
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#endif
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <unordered_set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include <iostream>
+#include <algorithm>
+#include "wire_format.h"
+#include "outbound_queue.h"
 
 namespace JTMLInterpreter {
 
-    typedef websocketpp::server<websocketpp::config::asio> server;
-    typedef websocketpp::connection_hdl connection_hdl;
+#ifdef JTML_WITH_DEFLATE
+    // The asio config with permessage-deflate negotiated on every connection
+    struct deflate_config : public websocketpp::config::asio {
+        typedef deflate_config type;
+        typedef websocketpp::config::asio base;
 
-    // Hash function for connection_hdl
-    struct ConnectionHash {
-        std::size_t operator()(const connection_hdl& hdl) const noexcept {
-            return std::hash<void*>()(hdl.lock().get());
-        }
-    };
+        typedef base::concurrency_type concurrency_type;
+        typedef base::request_type request_type;
+        typedef base::response_type response_type;
+        typedef base::message_type message_type;
+        typedef base::con_msg_manager_type con_msg_manager_type;
+        typedef base::endpoint_msg_manager_type endpoint_msg_manager_type;
+        typedef base::alog_type alog_type;
+        typedef base::elog_type elog_type;
+        typedef base::rng_type rng_type;
 
-    // Equality function for connection_hdl
-    struct ConnectionEqual {
-        bool operator()(const connection_hdl& lhs, const connection_hdl& rhs) const noexcept {
-            return !lhs.owner_before(rhs) && !rhs.owner_before(lhs);
-        }
+        struct transport_config : public base::transport_config {
+            typedef type::concurrency_type concurrency_type;
+            typedef type::alog_type alog_type;
+            typedef type::elog_type elog_type;
+            typedef type::request_type request_type;
+            typedef type::response_type response_type;
+            typedef websocketpp::transport::asio::basic_socket::endpoint socket_type;
+        };
+        typedef websocketpp::transport::asio::endpoint<transport_config> transport_type;
+
+        struct permessage_deflate_config {};
+
+        // Built once per connection; without context takeover the server's
+        // compressor is reset after every message (less memory per client,
+        // worse ratio on repetitive updates)
+        struct permessage_deflate_type
+            : public websocketpp::extensions::permessage_deflate::enabled<permessage_deflate_config> {
+            static inline std::atomic<bool> contextTakeover{true};
+
+            permessage_deflate_type() {
+                if (!contextTakeover) {
+                    enable_server_no_context_takeover();
+                }
+            }
+        };
     };
+    typedef websocketpp::server<deflate_config> server;
+#else
+    typedef websocketpp::server<websocketpp::config::asio> server;
+#endif
+    typedef websocketpp::connection_hdl connection_hdl;
 
+    // Assigned when a connection opens, never reused within a run
+    typedef uint64_t ConnectionID;
+
+    /**
+     * WebSocketServer
+     * Runs websocketpp on a pool of I/O threads. Every connection has an id
+     * and a bounded outbound queue: sends only queue the frame, and frames
+     * are handed to the socket while its write buffer is below SEND_WINDOW,
+     * so one slow client never holds up the others (what happens when its
+     * queue fills is the BackpressurePolicy). Each frame has a Lane, and a
+     * payload over CHUNK_BYTES is queued as Chunk frames, so a snapshot on
+     * its way out delays a reply to the client's input by one chunk at most.
+     *
+     * Callbacks run one at a time, whichever I/O thread received the event.
+     */
     class WebSocketServer {
     public:
+        typedef OutboundQueue<server::message_ptr::element_type> FrameQueue;
+
+        // Bytes a connection may have in websocketpp's write buffer before
+        // further frames wait in its queue
+        static constexpr size_t SEND_WINDOW = 256 * 1024;
+        // How soon a connection with waiting frames is looked at again
+        static constexpr long FLUSH_RETRY_MS = 10;
+        // Sent ahead of the rest once a connection's queue dropped frames
+        static constexpr const char* RESYNC_MESSAGE = "{\"type\": \"resync\"}";
+        // Payloads larger than this are sent in Chunk frames
+        static constexpr size_t CHUNK_BYTES = 64 * 1024;
+
         WebSocketServer() {
             // Initialize Asio
             wsServer.init_asio();
 
-            // Register handler callbacks
+            // Register handler callbacks; message and close handlers are set
+            // per connection once it has an id
             wsServer.set_open_handler(std::bind(&WebSocketServer::onOpen, this, std::placeholders::_1));
-            wsServer.set_close_handler(std::bind(&WebSocketServer::onClose, this, std::placeholders::_1));
-            wsServer.set_message_handler(std::bind(&WebSocketServer::onMessage, this, std::placeholders::_1, std::placeholders::_2));
+            wsServer.set_validate_handler(std::bind(&WebSocketServer::onValidate, this, std::placeholders::_1));
         }
 
-        // Start the server on a given port
+        ~WebSocketServer() {
+            stop();
+        }
+
+        // Whether clients asking for binary framing get it (on by default);
+        // those that are refused fall back to JSON text frames
+        void setBinaryFraming(bool enabled) {
+            binaryFraming = enabled;
+        }
+
+        size_t binaryClientCount() const { return binaryClients; }
+
+        // Where connection logs and errors go (std::cout / std::cerr unless
+        // set); set them before run()
+        void setLogStreams(std::ostream& log, std::ostream& errors) {
+            logOut = &log;
+            errorOut = &errors;
+        }
+
+        // Messages shorter than `threshold` bytes are never deflated; keeping
+        // the compression context between messages can be turned off. Both
+        // only matter when built with JTML_WITH_DEFLATE.
+        void setCompression(size_t threshold, bool contextTakeover) {
+            compressionThreshold = threshold;
+#ifdef JTML_WITH_DEFLATE
+            deflate_config::permessage_deflate_type::contextTakeover = contextTakeover;
+#else
+            (void)contextTakeover;
+#endif
+        }
+
+        // Size from which a payload is worth compressing (also used to
+        // decide which snapshots to precompress)
+        size_t getCompressionThreshold() const { return compressionThreshold; }
+
+        // Policy and limits for connections opened from now on
+        void setBackpressure(BackpressurePolicy policy,
+                             size_t maxFrames = FrameQueue::DEFAULT_MAX_FRAMES,
+                             size_t maxBytes = FrameQueue::DEFAULT_MAX_BYTES) {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            backpressure = policy;
+            queueMaxFrames = maxFrames;
+            queueMaxBytes = maxBytes;
+        }
+
+        // A pool size that suits this machine
+        static size_t defaultIoThreads() {
+            return std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+        }
+
+        // Number of threads running the I/O loop (1 until set). The pool
+        // only grows: a running server starts the missing threads at once.
+        void setIoThreads(size_t threads) {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            ioThreads = std::max<size_t>(1, threads);
+            if (running) {
+                growPool();
+            }
+        }
+
+        // Start the server on a given port; the calling thread is one of
+        // the pool's and returns once the server stops
         void run(uint16_t port) {
             try {
                 wsServer.listen(port);
                 wsServer.start_accept();
-                std::cout << "[WebSocket] Server started on port " << port << "\n";
+                {
+                    std::lock_guard<std::mutex> lock(poolMutex);
+                    if (stopped) {
+                        return;  // stop() came first
+                    }
+                    running = true;
+                    growPool();
+                    *logOut << "[WebSocket] Server started on port " << port
+                              << " with " << ioThreads << " I/O threads\n";
+                }
                 wsServer.run();
             } catch (const websocketpp::exception& e) {
-                std::cerr << "[WebSocket] Server error: " << e.what() << "\n";
+                *errorOut << "[WebSocket] Server error: " << e.what() << "\n";
             }
         }
 
+        void stop() {
+            std::vector<std::thread> threads;
+            {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                stopped = true;
+                if (!running) {
+                    return;
+                }
+                running = false;
+                threads.swap(ioPool);
+            }
+            wsServer.stop();
+            for (auto& thread : threads) {
+                if (thread.joinable() && thread.get_id() != std::this_thread::get_id()) {
+                    thread.join();
+                } else if (thread.joinable()) {
+                    thread.detach();
+                }
+            }
+        }
+
+        // Call `callback` on an I/O thread in `ms` milliseconds (never, once
+        // the server has stopped)
+        void setTimer(long ms, std::function<void()> callback) {
+            wsServer.set_timer(ms, [callback](const websocketpp::lib::error_code& ec) {
+                if (!ec) {
+                    callback();
+                }
+            });
+        }
+
         // Set the callback to handle incoming messages
-        void setMessageCallback(std::function<void(const std::string&, connection_hdl)> callback) {
+        void setMessageCallback(std::function<void(const std::string&, ConnectionID)> callback) {
             messageCallback = callback;
         }
 
-        void setOpenCallback(std::function<void(connection_hdl)> callback) {
+        void setOpenCallback(std::function<void(ConnectionID)> callback) {
             openCallback = callback;
         }
 
+        void setCloseCallback(std::function<void(ConnectionID)> callback) {
+            closeCallback = callback;
+        }
+
         // Send a message to a specific connection
-        void sendMessage(connection_hdl hdl, const std::string& message) {
-            try {
-                wsServer.send(hdl, message, websocketpp::frame::opcode::text);
+        void sendMessage(ConnectionID id, const std::string& message, Lane lane = Lane::Updates) {
+            if (auto conn = findConnection(id)) {
+                enqueue(*conn, buildFrames(*conn, message, false, true, std::string(), lane));
             }
-            catch (const websocketpp::exception& e) {
-                std::cerr << "[WebSocket] Send failed: " << e.what() << "\n";
+        }
+
+        // Send a frame that is already compressed (a Deflated snapshot) as is
+        void sendPrecompressed(ConnectionID id, const std::string& frame, Lane lane = Lane::Bulk) {
+            if (auto conn = findConnection(id)) {
+                enqueue(*conn, buildFrames(*conn, frame, true, false, std::string(), lane));
             }
         }
 
+        // Send one connection a message that may also have a binary encoding
+        // (as broadcastFrame does for all of them)
+        void sendFrame(ConnectionID id, const std::string& text, const std::string& binary,
+                       const std::string& key = std::string(), Lane lane = Lane::Updates) {
+            auto conn = findConnection(id);
+            if (!conn) {
+                return;
+            }
+            if (!binary.empty() && conn->binary) {
+                enqueue(*conn, buildFrames(*conn, binary, true, true, key, lane));
+            } else if (!text.empty()) {
+                enqueue(*conn, buildFrames(*conn, text, false, true, key, lane));
+            }
+        }
+
+        // Frames a connection's queue conflated or dropped so far
+        FrameQueue::Stats queueStats(ConnectionID id) {
+            auto conn = findConnection(id);
+            if (!conn) {
+                return FrameQueue::Stats();
+            }
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            return conn->queue.stats();
+        }
+
+        bool isBinaryClient(ConnectionID id) {
+            auto conn = findConnection(id);
+            return conn && conn->binary;
+        }
+
         // Broadcast a message to all connected clients
         void broadcastMessage(const std::string& message) {
-            for (const auto& hdl : connections) {
-                wsServer.send(hdl, message, websocketpp::frame::opcode::text);
+            broadcastFrame(message, std::string());
+        }
+
+        // Broadcast a message that may also have a binary encoding: binary
+        // connections get `binary` when there is one, everyone else `text`.
+        // Queued frames with the same `key` may be conflated with it.
+        // Connection `except` (if any) is left out.
+        void broadcastFrame(const std::string& text, const std::string& binary,
+                            const std::string& key = std::string(), Lane lane = Lane::Updates,
+                            ConnectionID except = 0) {
+            std::vector<std::shared_ptr<Connection>> list = connectionList();
+            list.erase(std::remove_if(list.begin(), list.end(),
+                                      [except](const std::shared_ptr<Connection>& conn) { return conn->id == except; }),
+                       list.end());
+            sendShared(list, text, binary, key, lane);
+        }
+
+        // As broadcastFrame, to the connections in `targets` only
+        void multicastFrame(const std::vector<ConnectionID>& targets, const std::string& text,
+                            const std::string& binary, const std::string& key = std::string(),
+                            Lane lane = Lane::Updates) {
+            std::vector<std::shared_ptr<Connection>> list;
+            list.reserve(targets.size());
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                for (ConnectionID id : targets) {
+                    auto it = connections.find(id);
+                    if (it != connections.end()) list.push_back(it->second);
+                }
             }
+            sendShared(list, text, binary, key, lane);
         }
 
     private:
+
+        struct Connection : std::enable_shared_from_this<Connection> {
+            Connection(ConnectionID id, server::connection_ptr con, bool binary, FrameQueue queue)
+                : id(id), con(std::move(con)), binary(binary), queue(std::move(queue)) {}
+
+            const ConnectionID id;
+            const server::connection_ptr con;
+            const bool binary;
+
+            std::mutex mutex;           // guards everything below
+            FrameQueue queue;
+            bool flushScheduled = false;
+            bool closing = false;
+        };
+
         server wsServer;
-        std::unordered_set<connection_hdl, ConnectionHash, ConnectionEqual> connections;
-        std::function<void(const std::string&, connection_hdl)> messageCallback;
-        std::function<void(connection_hdl)> openCallback;
+        std::unordered_map<ConnectionID, std::shared_ptr<Connection>> connections;
+        std::mutex connectionsMutex;
+        std::atomic<ConnectionID> nextConnectionId{1};
+        std::atomic<uint64_t> nextChunkStream{1};
+        std::atomic<size_t> binaryClients{0};
+        BackpressurePolicy backpressure = BackpressurePolicy::Conflate;
+        size_t queueMaxFrames = FrameQueue::DEFAULT_MAX_FRAMES;
+        size_t queueMaxBytes = FrameQueue::DEFAULT_MAX_BYTES;
+        bool binaryFraming = true;
+        std::atomic<size_t> compressionThreshold{256};
+
+        std::mutex poolMutex;
+        std::vector<std::thread> ioPool;
+        size_t ioThreads = 1;
+        bool running = false;
+        bool stopped = false;
+
+        std::ostream* logOut = &std::cout;
+        std::ostream* errorOut = &std::cerr;
+
+        // Serializes the callbacks below across I/O threads
+        std::mutex callbackMutex;
+        std::function<void(const std::string&, ConnectionID)> messageCallback;
+        std::function<void(ConnectionID)> openCallback;
+        std::function<void(ConnectionID)> closeCallback;
+
+        // The thread calling run() counts as one; caller holds poolMutex
+        void growPool() {
+            while (ioPool.size() + 1 < ioThreads) {
+                ioPool.emplace_back([this]() {
+                    try {
+                        wsServer.run();
+                    } catch (const websocketpp::exception& e) {
+                        *errorOut << "[WebSocket] I/O thread error: " << e.what() << "\n";
+                    }
+                });
+            }
+        }
+
+        // Each encoding is built into frames once, which every queue shares
+        void sendShared(const std::vector<std::shared_ptr<Connection>>& list, const std::string& text,
+                        const std::string& binary, const std::string& key, Lane lane) {
+            std::vector<FrameQueue::Frame> textFrames;
+            std::vector<FrameQueue::Frame> binaryFrames;
+            for (const auto& conn : list) {
+                if (!binary.empty() && conn->binary) {
+                    if (binaryFrames.empty()) binaryFrames = buildFrames(*conn, binary, true, true, key, lane);
+                    enqueue(*conn, binaryFrames);
+                } else if (!text.empty()) {
+                    if (textFrames.empty()) textFrames = buildFrames(*conn, text, false, true, key, lane);
+                    enqueue(*conn, textFrames);
+                }
+            }
+        }
+
+        std::shared_ptr<Connection> findConnection(ConnectionID id) {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            auto it = connections.find(id);
+            return it == connections.end() ? nullptr : it->second;
+        }
+
+        // Copy of the open connections, so a broadcast never holds the map
+        std::vector<std::shared_ptr<Connection>> connectionList() {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            std::vector<std::shared_ptr<Connection>> list;
+            list.reserve(connections.size());
+            for (const auto& entry : connections) {
+                list.push_back(entry.second);
+            }
+            return list;
+        }
+
+        void enqueue(Connection& conn, const std::vector<FrameQueue::Frame>& frames) {
+            std::unique_lock<std::mutex> lock(conn.mutex);
+            if (conn.closing) {
+                return;
+            }
+            for (const auto& frame : frames) {
+                if (conn.queue.push(frame) == FrameQueue::PushResult::Overflow) {
+                    conn.closing = true;
+                    lock.unlock();
+                    *errorOut << "[WebSocket] Client " << conn.id << " is too slow; disconnecting.\n";
+                    websocketpp::lib::error_code ec;
+                    wsServer.close(conn.con->get_handle(), websocketpp::close::status::policy_violation,
+                                   "Client too slow", ec);
+                    return;
+                }
+            }
+            flush(conn);
+        }
+
+        // Hand queued frames to the socket while its buffer has room; what
+        // is left is retried on a timer. Caller holds conn.mutex.
+        void flush(Connection& conn) {
+            if (conn.queue.takeResync()) {
+                write(conn, buildMessage(conn, RESYNC_MESSAGE, false, false));
+            }
+            FrameQueue::Frame frame;
+            while (conn.con->get_buffered_amount() < SEND_WINDOW && conn.queue.pop(frame)) {
+                write(conn, frame.message);
+            }
+            if (conn.queue.empty() || conn.flushScheduled) {
+                return;
+            }
+            conn.flushScheduled = true;
+            std::weak_ptr<Connection> weak = conn.weak_from_this();
+            wsServer.set_timer(FLUSH_RETRY_MS, [this, weak](const websocketpp::lib::error_code& ec) {
+                std::shared_ptr<Connection> conn = weak.lock();
+                if (!conn || ec) {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                conn->flushScheduled = false;
+                if (!conn->closing) {
+                    flush(*conn);
+                }
+            });
+        }
+
+        // A payload as queued frames: one, or past CHUNK_BYTES a run of
+        // Chunk frames (which never conflate) that the connection's higher
+        // lanes can go out between
+        std::vector<FrameQueue::Frame> buildFrames(Connection& conn, const std::string& payload, bool binary,
+                                                   bool compressible, const std::string& key, Lane lane) {
+            std::vector<FrameQueue::Frame> frames;
+            if (payload.size() <= CHUNK_BYTES) {
+                frames.push_back({ buildMessage(conn, payload, binary, compressible), payload.size(), key, lane });
+                return frames;
+            }
+            for (const std::string& chunk : chunkFrames(payload, binary, nextChunkStream++, CHUNK_BYTES)) {
+                frames.push_back({ buildMessage(conn, chunk, true, compressible), chunk.size(), std::string(), lane });
+            }
+            return frames;
+        }
+
+        // A message any number of connections can send. Unless the
+        // extension is to deflate it (per connection, as each has its own
+        // context), the frame header is written here and the message marked
+        // prepared, so websocketpp sends these bytes as they are instead of
+        // framing a copy for every connection.
+        server::message_ptr buildMessage(Connection& conn, const std::string& payload, bool binary,
+                                         bool compressible) {
+            auto opcode = binary ? websocketpp::frame::opcode::binary : websocketpp::frame::opcode::text;
+            server::message_ptr msg = conn.con->get_message(opcode, payload.size());
+            msg->append_payload(payload);
+#ifdef JTML_WITH_DEFLATE
+            if (compressible && payload.size() >= compressionThreshold) {
+                msg->set_compressed(true);
+                return msg;
+            }
+#else
+            (void)compressible;
+#endif
+            websocketpp::frame::basic_header header(opcode, payload.size(), true, false);
+            msg->set_header(websocketpp::frame::prepare_header(
+                header, websocketpp::frame::extended_header(payload.size())));
+            msg->set_prepared(true);
+            return msg;
+        }
+
+        void write(Connection& conn, const server::message_ptr& msg) {
+            try {
+                conn.con->send(msg);
+            } catch (const websocketpp::exception& e) {
+                *errorOut << "[WebSocket] Send failed: " << e.what() << "\n";
+            }
+        }
 
+        // Pick the wire format from the client's subprotocol list. A client
+        // that asks for any subprotocol must be given one of them, so JSON is
+        // selected whenever binary is not.
+        bool onValidate(connection_hdl hdl) {
+            server::connection_ptr con = wsServer.get_con_from_hdl(hdl);
+            if (!con) {
+                return true;
+            }
+            const auto& requested = con->get_requested_subprotocols();
+            auto offered = [&](const char* name) {
+                return std::find(requested.begin(), requested.end(), name) != requested.end();
+            };
+            if (binaryFraming && offered(BINARY_SUBPROTOCOL)) {
+                con->select_subprotocol(BINARY_SUBPROTOCOL);
+            } else if (offered(JSON_SUBPROTOCOL)) {
+                con->select_subprotocol(JSON_SUBPROTOCOL);
+            }
+            return true;
+        }
+
+        // The handle is resolved once, here; from then on the connection
+        // is found by id
         void onOpen(connection_hdl hdl) {
-             connections.insert(hdl);
-            std::cout << "[WebSocket] Client connected.\n";
+            server::connection_ptr con = wsServer.get_con_from_hdl(hdl);
+            if (!con) {
+                return;
+            }
+            const ConnectionID id = nextConnectionId++;
+            const bool binary = con->get_subprotocol() == BINARY_SUBPROTOCOL;
+            con->set_message_handler([this, id](connection_hdl, server::message_ptr msg) {
+                onMessage(id, msg);
+            });
+            con->set_close_handler([this, id](connection_hdl) {
+                onClose(id);
+            });
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                connections.emplace(id, std::make_shared<Connection>(
+                    id, con, binary, FrameQueue(backpressure, queueMaxFrames, queueMaxBytes)));
+            }
+            if (binary) {
+                ++binaryClients;
+            }
+            *logOut << "[WebSocket] Client " << id << " connected.\n";
+            std::lock_guard<std::mutex> lock(callbackMutex);
             if (openCallback) {
-                openCallback(hdl);
+                openCallback(id);
             }
         }
 
-        void onClose(connection_hdl hdl) {
-            connections.erase(hdl);
-            std::cout << "[WebSocket] Client disconnected.\n";
+        void onClose(ConnectionID id) {
+            std::shared_ptr<Connection> conn;
+            {
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                auto it = connections.find(id);
+                if (it == connections.end()) {
+                    return;
+                }
+                conn = it->second;
+                connections.erase(it);
+            }
+            FrameQueue::Stats stats;
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                conn->closing = true;
+                stats = conn->queue.stats();
+            }
+            if (conn->binary) {
+                --binaryClients;
+            }
+            *logOut << "[WebSocket] Client " << id << " disconnected (" << stats.conflated << " frames / "
+                    << stats.conflatedBytes << " bytes conflated, " << stats.dropped << " frames / "
+                    << stats.droppedBytes << " bytes dropped).\n";
+            std::lock_guard<std::mutex> lock(callbackMutex);
+            if (closeCallback) {
+                closeCallback(id);
+            }
         }
 
-        void onMessage(connection_hdl hdl, server::message_ptr msg) {
+        void onMessage(ConnectionID id, server::message_ptr msg) {
+            std::lock_guard<std::mutex> lock(callbackMutex);
             if (messageCallback) {
-                messageCallback(msg->get_payload(), hdl);
+                messageCallback(msg->get_payload(), id);
             }
         }
     };
@@ -0,0 +1,120 @@
+// wire_format.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef JTML_WITH_DEFLATE
+#include <zlib.h>
+#endif
+
+namespace JTMLInterpreter {
+
+/**
+ * Binary framing for high-frequency updates, used on connections that
+ * negotiated the BINARY_SUBPROTOCOL WebSocket subprotocol (everything else,
+ * and every message without an opcode here, stays JSON text).
+ *
+ * A binary frame is a sequence of records:
+ *   u8 opcode, varint bindingId, varint byteLength, UTF-8 value
+ * where bindingId indexes the page's binding table, so the client resolves
+ * the element (and attribute) without any id string on the wire. Every
+ * frame opens with a Version record: u8 opcode, varint journal version, no
+ * value. Varints are unsigned LEB128.
+ *
+ * The reply to a client's eventBatch opens with an Ack record instead
+ * (u8 opcode, varint event sequence number, no value).
+ *
+ * A frame whose first byte is Deflated instead carries one JSON message as
+ * a zlib stream (built with JTML_WITH_DEFLATE only); any client may get it.
+ *
+ * A message too big to go out in one piece is sent as Chunk frames:
+ *   u8 opcode, varint stream, varint index, varint count, u8 kind, bytes
+ * where kind says whether the reassembled bytes are JSON text (0) or a
+ * binary frame (1). Chunks of one stream arrive in order, but frames of
+ * other streams and lanes may come between them. Any client may get them.
+ */
+constexpr const char* BINARY_SUBPROTOCOL = "jtml.bin.v1";
+constexpr const char* JSON_SUBPROTOCOL = "jtml.json";
+
+// BindingInfo::bindingId for bindings that did not come from a slot
+constexpr uint32_t NO_BINDING_ID = UINT32_MAX;
+
+enum class WireOp : uint8_t {
+    Content = 0x01,    // textContent of a show placeholder
+    Attribute = 0x02,  // reactive attribute value
+    If = 0x03,         // if-host condition value
+    Version = 0x04,    // state journal version of the frame's changes
+    Deflated = 0x05,   // zlib-compressed JSON message
+    Ack = 0x06,        // u8 opcode, varint: the client's last event handled
+    Chunk = 0x07       // one piece of a larger message (see above)
+};
+
+inline void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Reads a varint at `pos`, advancing it; false if the bytes run out
+inline bool readVarint(const std::string& in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; pos < in.size() && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+inline void appendRecord(std::string& out, WireOp op, uint32_t bindingId, const std::string& value) {
+    out.push_back(static_cast<char>(op));
+    appendVarint(out, bindingId);
+    appendVarint(out, value.size());
+    out += value;
+}
+
+// Deflated frame for a JSON message, compressed once so it can go to any
+// number of connections as is; false without zlib or if it does not shrink
+inline bool deflateFrame(const std::string& json, std::string& frame) {
+#ifdef JTML_WITH_DEFLATE
+    uLongf size = compressBound(static_cast<uLong>(json.size()));
+    frame.assign(1 + size, '\0');
+    frame[0] = static_cast<char>(WireOp::Deflated);
+    if (compress2(reinterpret_cast<Bytef*>(&frame[1]), &size,
+                  reinterpret_cast<const Bytef*>(json.data()), static_cast<uLong>(json.size()),
+                  Z_BEST_COMPRESSION) != Z_OK || 1 + size >= json.size()) {
+        frame.clear();
+        return false;
+    }
+    frame.resize(1 + size);
+    return true;
+#else
+    (void)json;
+    frame.clear();
+    return false;
+#endif
+}
+
+// The Chunk frames that carry `payload` in pieces of at most `chunkBytes`
+inline std::vector<std::string> chunkFrames(const std::string& payload, bool binary, uint64_t stream,
+                                            size_t chunkBytes) {
+    const size_t count = (payload.size() + chunkBytes - 1) / chunkBytes;
+    std::vector<std::string> frames;
+    frames.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string frame(1, static_cast<char>(WireOp::Chunk));
+        appendVarint(frame, stream);
+        appendVarint(frame, i);
+        appendVarint(frame, count);
+        frame.push_back(binary ? 1 : 0);
+        frame.append(payload, i * chunkBytes, chunkBytes);
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
+
+} // namespace JTMLInterpreter
@@ -0,0 +1,148 @@
+// worker_pool.h
+#pragma once
+
+#include "mpsc_queue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace JTMLInterpreter {
+
+/**
+ * WorkerPool
+ * Worker threads with a task queue each. Work is pinned rather than
+ * shared: an owner (an interpreter serving one page) pins itself to a
+ * worker, and everything it posts runs there in order. Owners need no
+ * locks of their own, and owners on different workers run in parallel.
+ * The destructor finishes queued work and joins the workers.
+ *
+ * Posting is lock-free (an MpscQueue per worker); a poster only takes the
+ * worker's lock to wake it when its queue was empty.
+ */
+class WorkerPool {
+public:
+    typedef size_t WorkerID;
+
+    explicit WorkerPool(size_t threadCount = std::thread::hardware_concurrency()) {
+        if (threadCount == 0) threadCount = 1;
+        workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (auto& worker : workers) {
+            Worker* w = worker.get();
+            w->thread = std::thread([w] { workerLoop(*w); });
+        }
+    }
+
+    ~WorkerPool() {
+        for (auto& worker : workers) {
+            {
+                std::lock_guard<std::mutex> lock(worker->mutex);
+                worker->stopping = true;
+            }
+            worker->cv.notify_one();
+        }
+        for (auto& worker : workers) {
+            if (worker->thread.joinable()) worker->thread.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // The worker with the fewest owners; unpin() when the owner goes
+    WorkerID pin() {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        WorkerID best = 0;
+        for (WorkerID i = 1; i < workers.size(); ++i) {
+            if (workers[i]->owners < workers[best]->owners) best = i;
+        }
+        ++workers[best]->owners;
+        return best;
+    }
+
+    void unpin(WorkerID id) {
+        std::lock_guard<std::mutex> lock(pinMutex);
+        if (workers[id]->owners > 0) --workers[id]->owners;
+    }
+
+    // Queue a task on a worker (from any thread); tasks posted to one
+    // worker run in order
+    void post(WorkerID id, std::function<void()> task) {
+        Worker& worker = *workers[id];
+        worker.tasks.push(std::move(task));
+        if (worker.pending.fetch_add(1, std::memory_order_acq_rel) == 0) {
+            // It may be asleep; notifying under the lock means it either
+            // sees the count before it waits or gets the notification
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.cv.notify_one();
+        }
+    }
+
+    // Wait until everything posted to the worker so far has run (returns
+    // at once on the worker itself, where waiting could never end)
+    void drain(WorkerID id) {
+        if (onWorker(id)) {
+            return;
+        }
+        std::promise<void> done;
+        std::future<void> finished = done.get_future();
+        post(id, [&done] { done.set_value(); });
+        finished.wait();
+    }
+
+    bool onWorker(WorkerID id) const {
+        return std::this_thread::get_id() == workers[id]->thread.get_id();
+    }
+
+    // Tasks posted to the worker that have not finished running
+    size_t pending(WorkerID id) const {
+        return workers[id]->pending.load(std::memory_order_acquire);
+    }
+
+    size_t size() const { return workers.size(); }
+
+private:
+    struct Worker {
+        std::thread thread;
+        MpscQueue<std::function<void()>> tasks;
+        std::atomic<size_t> pending{0};  // posted and not yet run
+        std::mutex mutex;                // guards stopping; parks the worker
+        std::condition_variable cv;
+        bool stopping = false;
+        size_t owners = 0;               // guarded by pinMutex
+    };
+
+    static void workerLoop(Worker& worker) {
+        std::function<void()> task;
+        while (true) {
+            if (worker.pending.load(std::memory_order_acquire) == 0) {
+                std::unique_lock<std::mutex> lock(worker.mutex);
+                worker.cv.wait(lock, [&worker] {
+                    return worker.stopping || worker.pending.load(std::memory_order_acquire) > 0;
+                });
+                if (worker.pending.load(std::memory_order_acquire) == 0) return;  // stopping and drained
+            }
+            // Counted but not linked in yet: its producer is mid-push
+            if (!worker.tasks.pop(task)) {
+                std::this_thread::yield();
+                continue;
+            }
+            task();
+            task = nullptr;
+            worker.pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex pinMutex;
+};
+
+} // namespace JTMLInterpreter
@@ -3,16 +3,46 @@
 #include "include/jtml_parser.h"       
 #include "include/jtml_interpreter.h"  
 #include "include/transpiler.h" 
+#include "include/program_cache.h"
 
 namespace py = pybind11;
 
-void interpret_string(const std::string& code) {
-    JtmlTranspiler transpiler;  
-    Interpreter interp(transpiler);
-    interp.interpret(code);
+void interpret_string(const std::string& code, const std::string& cacheDir) {
+    Interpreter interp;
+    if (cacheDir.empty()) {
+        interp.interpret(code);
+        return;
+    }
+
+    // Reuse the compiled program from <cacheDir>/<hash>.jtmlc when the snippet is unchanged
+    ProgramCache cache(cacheDir);
+    CompiledProgram compiled;
+    const uint64_t sourceHash = ProgramCache::hashSource(code);
+    if (!cache.load("", sourceHash, compiled)) {
+        Lexer lexer(code);
+        Parser parser(lexer);
+        compiled.sourceHash = sourceHash;
+        compiled.program = parser.parseProgram();
+        if (!lexer.getErrors().empty()) {
+            // Let the regular path report lexer errors; don't cache a broken program
+            interp.interpret(code);
+            return;
+        }
+    }
+    if (!compiled.hasHtml) {
+        JtmlTranspiler compiler;
+        CompileResult result = compiler.compile(compiled.program);
+        compiled.hasHtml = true;
+        compiled.html = std::move(result.html);
+        compiled.bindings = std::move(result.bindings);
+        cache.store("", compiled);
+    }
+    interp.interpret(compiled.program);
+    interp.loadBindingTable(compiled.bindings);
 }
 
 PYBIND11_MODULE(jtml_engine, m) {
     m.doc() = "JTML engine Python bindings";
-    m.def("interpret_string", &interpret_string, "Interpret a jtml snippet");
+    m.def("interpret_string", &interpret_string, "Interpret a jtml snippet",
+          py::arg("code"), py::arg("cache_dir") = "");
 }
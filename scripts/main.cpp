@@ -11,6 +11,8 @@
 #include "include/jtml_parser.h"
 #include "include/jtml_interpreter.h"
 #include "include/transpiler.h"
+#include "include/mapped_file.h"
+#include "include/program_cache.h"
 
 // For the HTTP server
 #include "httplib.h"
@@ -19,20 +21,21 @@ static void usage() {
     std::cout << "Usage:\n"
               << "  jtml interpret <input.jtml>\n"
               << "  jtml transpile <input.jtml> -o <output.html>\n"
-              << "  jtml serve <input.jtml> [--port <num>]\n";
+              << "  jtml serve <input.jtml> [--port <num>] [--ws-port <num>]\n"
+              << "Options:\n"
+              << "  --ws-port <num>     port of the WebSocket server pages connect to (default 8080)\n"
+              << "  --cache-dir <dir>   store precompiled .jtmlc entries in <dir> (default: beside the source)\n"
+              << "  --no-cache          always run the full front end\n"
+              << "  --ssr               render current values into the HTML (transpile, serve)\n"
+              << "  --no-binary         send every update as JSON text, even to clients offering binary framing\n"
+              << "  --deflate-threshold <bytes>  smallest message worth compressing (default 256)\n"
+              << "  --no-context-takeover        reset the deflate context after each message\n"
+              << "  --io-threads <num>  WebSocket I/O threads (default: up to 4, one per core)\n"
+              << "  --backpressure <drop-oldest|conflate|disconnect>  what to do when a client falls behind (default conflate)\n"
+              << "  --sessions          give every connection its own copy of the program state\n";
     std::exit(1);
 }
 
-std::string readFile(const std::string& path) {
-    std::ifstream ifs(path);
-    if (!ifs.is_open()) {
-        throw std::runtime_error("Cannot open file: " + path);
-    }
-    std::ostringstream oss;
-    oss << ifs.rdbuf();
-    return oss.str();
-}
-
 int main(int argc, char* argv[]) {
     if (argc < 3) {
         usage();
@@ -43,6 +46,16 @@ int main(int argc, char* argv[]) {
 
     std::string outputFile;
     int port = 8080; // default port
+    uint16_t wsPort = Interpreter::DEFAULT_WEBSOCKET_PORT;
+    std::string cacheDir;
+    bool useCache = true;
+    bool ssr = false;
+    bool binaryFraming = true;
+    size_t deflateThreshold = 256;
+    bool contextTakeover = true;
+    size_t ioThreads = JTML::WebSocketServer::defaultIoThreads();
+    JTML::BackpressurePolicy backpressure = JTML::BackpressurePolicy::Conflate;
+    bool sessions = false;
 
     // Parse additional arguments
     for (int i = 3; i < argc; ++i) {
@@ -50,49 +63,121 @@ int main(int argc, char* argv[]) {
             outputFile = argv[++i];
         } else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
             port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--ws-port") == 0 && i + 1 < argc) {
+            wsPort = static_cast<uint16_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--no-cache") == 0) {
+            useCache = false;
+        } else if (std::strcmp(argv[i], "--ssr") == 0) {
+            ssr = true;
+        } else if (std::strcmp(argv[i], "--no-binary") == 0) {
+            binaryFraming = false;
+        } else if (std::strcmp(argv[i], "--deflate-threshold") == 0 && i + 1 < argc) {
+            deflateThreshold = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--no-context-takeover") == 0) {
+            contextTakeover = false;
+        } else if (std::strcmp(argv[i], "--sessions") == 0) {
+            sessions = true;
+        } else if (std::strcmp(argv[i], "--io-threads") == 0 && i + 1 < argc) {
+            ioThreads = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--backpressure") == 0 && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "drop-oldest") {
+                backpressure = JTML::BackpressurePolicy::DropOldest;
+            } else if (policy == "conflate") {
+                backpressure = JTML::BackpressurePolicy::Conflate;
+            } else if (policy == "disconnect") {
+                backpressure = JTML::BackpressurePolicy::Disconnect;
+            } else {
+                usage();
+            }
         } else {
             usage(); // Unrecognized argument
         }
     }
 
     try {
-        // Step 1: Read the .jtml file
-        std::string inputText = readFile(inputFile);
-
-        // Step 2: Lex + Parse
-        Lexer lexer(inputText);
-        auto tokens = lexer.tokenize();
+        // Step 1: Map the .jtml file
+        MappedFile source(inputFile);
+
+        // Step 2: Load the precompiled program, or Lex + Parse
+        // (the parser pulls tokens from the lexer on demand)
+        ProgramCache cache(cacheDir);
+        CompiledProgram compiled;
+        const uint64_t sourceHash = ProgramCache::hashSource(source.view());
+        const bool cacheHit = useCache && cache.load(inputFile, sourceHash, compiled);
+
+        if (!cacheHit) {
+            Lexer lexer(source.view());
+            Parser parser(lexer);
+            compiled.sourceHash = sourceHash;
+
+            // Tokens are scanned while parsing, so lexer errors are known
+            // once it stops; they come first, as they usually caused the rest
+            auto reportLexerErrors = [&lexer]() {
+                const auto& errors = lexer.getErrors();
+                for (const auto& error : errors) {
+                    std::cerr << "Lexer Error: " << error << std::endl;
+                }
+                return !errors.empty();
+            };
+            try {
+                compiled.program = parser.parseProgram();
+            } catch (const std::exception&) {
+                if (reportLexerErrors()) {
+                    return 1;
+                }
+                throw;
+            }
+            if (reportLexerErrors()) {
+                return 1;
+            }
+        }
 
-        const auto& errors = lexer.getErrors();
-        if (!errors.empty()) {
-            for (const auto& error : errors) {
-                std::cerr << "Lexer Error: " << error << std::endl;
+        // Step 3: One compiler pass => HTML + binding table
+        if (!compiled.hasHtml) {
+            JtmlTranspiler compiler;
+            CompileResult result = compiler.compile(compiled.program);
+            compiled.hasHtml = true;
+            compiled.html = std::move(result.html);
+            compiled.bindings = std::move(result.bindings);
+            if (useCache) {
+                cache.store(inputFile, compiled);
             }
-            return 1;
         }
+        if (useCache && !cacheDir.empty()) {
+            ModuleLoader::instance().setCacheDirectory(cacheDir);
+        }
+        auto& program = compiled.program;
 
-        Parser parser(std::move(tokens));
-        auto root = parser.parseJtmlElement();
-        auto program = parser.parseProgram(); 
+        // Page to send: the compiled HTML, or with --ssr the same page with the
+        // interpreter's current values spliced in at the recorded holes
+        auto renderPage = [&](const Interpreter& interpreter) {
+            if (!ssr) {
+                return compiled.html;
+            }
+            JtmlTranspiler renderer;
+            return renderer.render(compiled.html, compiled.bindings,
+                [&interpreter](BindingID id, std::string& value) {
+                    return interpreter.bindingValue(id, value);
+                });
+        };
 
         if (command == "interpret") {
             // Interpret the parsed JTML server-side
-            JtmlTranspiler transpiler;
-
-        
-            Interpreter interpreter(transpiler);
-            interpreter.interpret(*root); // Interpret to populate variables
+            Interpreter interpreter;
+            interpreter.setModuleBaseDirectory(ModuleLoader::directoryOf(inputFile));
+            interpreter.interpret(program); // Interpret to populate variables
+            interpreter.loadBindingTable(compiled.bindings);
 
         } else if (command == "transpile") {
-            // Transpile JTML to HTML
-            JtmlTranspiler transpiler;
-
-        
-            Interpreter interpreter(transpiler);
-            interpreter.interpret(*root); // Interpret to populate variables
-
-           
-            std::string html = transpiler.transpile(program);
+            // Write the compiled HTML
+            Interpreter interpreter;
+            interpreter.setModuleBaseDirectory(ModuleLoader::directoryOf(inputFile));
+            interpreter.interpret(program); // Interpret to populate variables
+            interpreter.loadBindingTable(compiled.bindings);
+            std::string html = renderPage(interpreter);
 
             if (!outputFile.empty()) {
                 std::ofstream ofs(outputFile);
@@ -107,17 +192,28 @@ int main(int argc, char* argv[]) {
             }
 
         } else if (command == "serve") {
-            // Transpile JTML to HTML and serve via HTTP
-            JtmlTranspiler transpiler;
-
-        
-            Interpreter interpreter(transpiler);
-            interpreter.interpret(*root); // Interpret to populate variables
-            std::string html = transpiler.transpile(program);
+            // Serve the compiled HTML via HTTP
+            Interpreter interpreter;
+            interpreter.setModuleBaseDirectory(ModuleLoader::directoryOf(inputFile));
+            interpreter.setBinaryFraming(binaryFraming);
+            interpreter.setCompression(deflateThreshold, contextTakeover);
+            interpreter.setBackpressure(backpressure);
+            interpreter.setSessions(sessions);
+            interpreter.setIoThreads(ioThreads);
+            interpreter.interpret(program); // Interpret to populate variables
+            interpreter.loadBindingTable(compiled.bindings);
 
             httplib::Server svr;
-            svr.Get("/", [html](const httplib::Request&, httplib::Response& res) {
-                res.set_content(html, "text/html");
+            interpreter.listen(wsPort);
+
+            svr.Get("/", [&renderPage, &interpreter, wsPort](const httplib::Request&, httplib::Response& res) {
+                // Read the state on the interpreter's executor, between events
+                std::string page;
+                interpreter.execute([&]() { page = renderPage(interpreter); });
+                if (wsPort != Interpreter::DEFAULT_WEBSOCKET_PORT) {
+                    page = JtmlTranspiler::withWebSocketPort(page, wsPort);
+                }
+                res.set_content(page, "text/html");
             });
 
             std::cout << "Serving JTML on http://localhost:" << port << "\n";
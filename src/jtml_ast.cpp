@@ -313,6 +313,7 @@ ASTNodeType JtmlElementNode::getType() const {
         for (const auto& attr : attributes) {
             auto clonedValue = attr.value ? attr.value->clone() : nullptr;
             newNode->attributes.push_back({attr.key, std::move(clonedValue)});
+            newNode->attributes.back().policy = attr.policy;
         }
         for (const auto& child : content) {
             newNode->content.push_back(child->clone());
@@ -520,6 +521,23 @@ std::string UnbindStatementNode::toString() const {
     oss << "UnbindStatementNode(identifier=" << identifier << ")";
     return oss.str();
 }
+ASTNodeType ImportStatementNode::getType() const {
+    return ASTNodeType::ImportStatement;
+}
+
+std::unique_ptr<ASTNode> ImportStatementNode::clone() const {
+    auto newNode = std::make_unique<ImportStatementNode>();
+    newNode->modulePath = modulePath;
+    newNode->alias = alias;
+    return newNode;
+}
+
+std::string ImportStatementNode::toString() const {
+    std::ostringstream oss;
+    oss << "ImportStatementNode(path=" << modulePath << ", alias=" << alias << ")";
+    return oss.str();
+}
+
 ASTNodeType StoreStatementNode::getType() const {
     return ASTNodeType::StoreStatement;
 }
@@ -664,6 +682,7 @@ std::unique_ptr<ASTNode> ForStatementNode::clone() const {
     newNode->iteratorName = iteratorName;
     newNode->iterableExpression = iterableExpression ? iterableExpression->clone() : nullptr;
     newNode->rangeEndExpr = rangeEndExpr ? rangeEndExpr->clone() : nullptr;
+    newNode->windowSize = windowSize;
     for (const auto& stmt : body) {
         newNode->body.push_back(stmt->clone());
     }
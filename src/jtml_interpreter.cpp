@@ -2,22 +2,77 @@
 #include "../include/jtml_interpreter.h"
 
 #include <algorithm>
+#include <cmath>
 #include <stdexcept>
 #include <sstream>
 
+namespace {
+
+// A for-host's rows as the client runtime takes them: {"keys": [...], "items": [...]}
+nlohmann::json listJson(const std::vector<JTML::ListEntry>& rows) {
+    nlohmann::json keys = nlohmann::json::array();
+    nlohmann::json items = nlohmann::json::array();
+    for (const auto& entry : rows) {
+        keys.push_back(entry.key);
+        items.push_back(entry.value);
+    }
+    return {{"keys", keys}, {"items", items}};
+}
+
+// Handler an inbound message is an event for (false for other messages
+// and ones that do not parse; the executor reports those)
+bool eventTarget(const std::string& msg, std::string& elementId) {
+    auto parsed = nlohmann::json::parse(msg, nullptr, false);
+    if (!parsed.is_object() || parsed.value("type", std::string()) != "event") {
+        return false;
+    }
+    auto it = parsed.find("elementId");
+    if (it == parsed.end() || !it->is_string()) {
+        return false;
+    }
+    elementId = it->get<std::string>();
+    return true;
+}
+
+// First row of a `size`-row window centred on the rows the client shows
+size_t windowStart(size_t total, size_t size, size_t first, size_t count) {
+    const size_t centre = first + count / 2;
+    size_t start = centre > size / 2 ? centre - size / 2 : 0;
+    if (total <= size) return 0;
+    return std::min(start, total - size);
+}
+
+} // namespace
+
 Interpreter::~Interpreter() {
+    // No more callbacks once the server is down; then let the worker
+    // finish what they already posted
+    wsServer->stop();
     if (wsThread.joinable()) {
         wsThread.join();
          // Ensure the thread is joined before destruction
     }
+    if (workerPool) {
+        workerPool->drain(worker);
+        workerPool->unpin(worker);
+    }
 }
-Interpreter::Interpreter(JtmlTranspiler& transpilerRef)
-    : transpiler(transpilerRef) // Initialize transpiler reference
+Interpreter::Interpreter()
 {
     // Create the Renderer
     renderer = std::make_unique<JTML::Renderer>();
     // Create the WebSocket server
     wsServer = std::make_shared<JTML::WebSocketServer>();
+    eventGate = std::make_unique<JTML::EventGate>(
+        [this](JTML::EventGate::Task task) { dispatch(std::move(task)); },
+        [this](uint32_t ms, JTML::EventGate::Task task) {
+            wsServer->setTimer(ms, [this, task]() { dispatch(task); });
+        },
+        [this](JTML::ConnectionID connection, const std::string& msg) {
+            handleFrontendMessage(msg, connection);
+        });
+    interest = std::make_unique<JTML::InterestIndex>();
+    sentValues = std::make_unique<JTML::SentValues>();
     
     // Initialize the global and current environments
     globalEnv = std::make_shared<JTML::Environment>(nullptr, 0, renderer.get());
@@ -26,110 +81,356 @@ Interpreter::Interpreter(JtmlTranspiler& transpilerRef)
     globalEnv->setRenderer(renderer.get());
     currentEnv->setRenderer(renderer.get());
 
-    // Initialize nodeID
-    nodeID = 0;
-    uniqueVarID  = 0;
     uniqueArrayVarID = 1;
     uniqueDictVarID = 1;
 
-    std::thread wsThread([this]() {
-        wsServer->run(8080);
+    // Clients ask for current values with a 'sync' message; server-rendered
+    // pages already carry them and only listen for updates
+    wsServer->setOpenCallback(
+        [this](JTML::ConnectionID connection) {
+            interest->open(connection);
+            sentValues->open(connection);
+            dispatch([this, connection]() {
+                logStream() << "[DEBUG] New WebSocket connection established.\n";
+                if (sessionsEnabled) {
+                    openSession(connection);
+                } else {
+                    renderer->setBinaryWanted(wsServer->binaryClientCount() > 0);
+                }
+            });
     });
-    wsThread.detach();
 
-    wsServer->setOpenCallback(
-        [this](websocketpp::connection_hdl hdl) {
-            std::cout << "[DEBUG] New WebSocket connection established.\n";
-            populateBindings(hdl);
+    wsServer->setCloseCallback(
+        [this](JTML::ConnectionID connection) {
+            eventGate->drop(connection);
+            interest->drop(connection);
+            const JTML::SentValues::Stats spared = sentValues->drop(connection);
+            dispatch([this, connection, spared]() {
+                logStream() << "[DEBUG] Connection " << connection << " closed: " << spared.unchanged
+                            << " unchanged values (" << spared.unchangedBytes << " bytes) not resent.\n";
+                if (sessionsEnabled) {
+                    auto session = sessions.find(connection);
+                    if (session != sessions.end()) {
+                        const JTML::Renderer::Stats stats = session->second.renderer->stats();
+                        logStream() << "[DEBUG] Closed session " << connection << ": " << stats.sent
+                                    << " changes sent, " << stats.conflated << " superseded ones skipped.\n";
+                        sessions.erase(session);
+                    }
+                } else {
+                    renderer->setBinaryWanted(wsServer->binaryClientCount() > 0);
+                }
+                std::lock_guard<std::mutex> lock(viewportsMutex);
+                viewports.erase(connection);
+            });
+    });
+
+    // A windowed list changed: every connection showing it gets its own slice
+    renderer->setWindowedListCallback([this](const std::string& elementId) {
+        std::lock_guard<std::mutex> lock(viewportsMutex);
+        for (auto& [connection, hosts] : viewports) {
+            auto it = hosts.find(elementId);
+            if (it != hosts.end()) {
+                sendListWindow(connection, elementId, it->second);
+            }
+        }
     });
 
     // Set Renderer callback to send messages via WebSocket
-    renderer->setFrontendCallback([this](const std::string& msg) {
-        wsServer->broadcastMessage(msg);
+    renderer->setFrontendCallback([this](const JTML::Renderer::Message& message) {
+        sendToInterested({ message.bindingId }, message.text, message.binary, message.key, message.lane, 0,
+                         message.value);
     });
 
     // Set WebSocket message handler
     wsServer->setMessageCallback(
-        [this](const std::string& msg, websocketpp::connection_hdl hdl) {
-            handleFrontendMessage(msg, hdl);
+        [this](const std::string& msg, JTML::ConnectionID connection) {
+            std::string admitted = eventGate->empty() ? msg : admitEvents(msg, connection);
+            if (admitted.empty()) {
+                return;
+            }
+            dispatch([this, msg = std::move(admitted), connection]() {
+                handleFrontendMessage(msg, connection);
+            });
         });
 
     // Assign Renderer to the global environment
  
 }
 
-// In jtml_interpreter.cpp
+/**
+ * While a connection's message is handled, globalEnv, currentEnv and
+ * renderer are its session's (nothing changes without sessions). The
+ * swapped-out renderer waits in the session until the scope ends.
+ */
+class Interpreter::SessionScope {
+public:
+    SessionScope(Interpreter& interpreter, JTML::ConnectionID connection) : interp(interpreter) {
+        auto it = interp.sessions.find(connection);
+        if (it == interp.sessions.end()) {
+            return;
+        }
+        session = &it->second;
+        savedCurrentEnv = interp.currentEnv;
+        interp.programEnv = interp.globalEnv;
+        interp.globalEnv = session->env;
+        interp.currentEnv = session->env;
+        std::swap(interp.renderer, session->renderer);
+    }
 
-void Interpreter::populateBindings(websocketpp::connection_hdl hdl) {
-    try {
-        nlohmann::json bindingsJson;
+    ~SessionScope() {
+        if (!session) {
+            return;
+        }
+        std::swap(interp.renderer, session->renderer);
+        interp.globalEnv = interp.programEnv;
+        interp.currentEnv = savedCurrentEnv;
+        interp.programEnv.reset();
+    }
+
+    SessionScope(const SessionScope&) = delete;
+    SessionScope& operator=(const SessionScope&) = delete;
+
+private:
+    Interpreter& interp;
+    Session* session = nullptr;
+    std::shared_ptr<JTML::Environment> savedCurrentEnv;
+};
+
+void Interpreter::listen(uint16_t port) {
+    if (wsThread.joinable()) {
+        return;
+    }
+    if (!workerPool) {
+        setWorkerPool(std::make_shared<JTML::WorkerPool>(1));
+    }
+    wsThread = std::thread([server = wsServer, port]() {
+        server->run(port);
+    });
+}
+
+void Interpreter::setLogStreams(std::ostream& log, std::ostream& errors) {
+    logOut = &log;
+    errorOut = &errors;
+    globalEnv->setLogStreams(log, errors);
+    wsServer->setLogStreams(log, errors);
+}
+
+void Interpreter::setWorkerPool(std::shared_ptr<JTML::WorkerPool> pool) {
+    if (workerPool) {
+        workerPool->unpin(worker);
+    }
+    workerPool = std::move(pool);
+    if (workerPool) {
+        worker = workerPool->pin();
+    }
+}
 
-        // Debug log: Starting the populateBindings process
-        std::cout << "[DEBUG] Starting populateBindings for WebSocket connection.\n";
+void Interpreter::dispatch(std::function<void()> task) {
+    if (workerPool) {
+        workerPool->post(worker, std::move(task));
+    } else {
+        task();
+    }
+}
 
-        // Use the global environment to gather bindings
-        std::shared_ptr<JTML::Environment> env = globalEnv;
-        if (!env) {
-            std::cerr << "[ERROR] Global environment is not initialized.\n";
-            throw std::runtime_error("Global environment is not initialized.");
+void Interpreter::execute(const std::function<void()>& task) {
+    if (!workerPool || !wsThread.joinable() || workerPool->onWorker(worker)) {
+        task();
+        return;
+    }
+    std::exception_ptr error;
+    std::promise<void> done;
+    workerPool->post(worker, [&task, &error, &done]() {
+        try {
+            task();
+        } catch (...) {
+            error = std::current_exception();
         }
+        done.set_value();
+    });
+    done.get_future().wait();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
 
-        // Debug log: Iterate through bindings
-        std::cout << "[DEBUG] Gathering bindings from the global environment.\n";
+void Interpreter::setSessions(bool enabled) {
+    sessionsEnabled = enabled;
+}
 
-        // Iterate through all bindings in the environment
-        for (const auto& [varName, bindingInfos] : env->getBindings()) {
-            std::cout << "[DEBUG] Processing variable: " << varName << " with " << bindingInfos.size() << " bindings.\n";
+size_t Interpreter::sessionCount() const {
+    return sessions.size();
+}
 
-            for (const auto& binding : bindingInfos) {
-                // Retrieve the variable's current value
-                if (binding.bindingType == "attribute_event") {
-                    continue;
-                }
-                std::shared_ptr<JTML::VarValue> varVal = env->getVariable(binding.varName);
-                std::string valueStr = varVal ? varVal->toString() : "undefined";
-
-                // Debug log: Binding details
-                std::cout << "[DEBUG] Binding - ElementID: " << binding.elementId
-                          << ", Attribute: " << binding.attribute
-                          << ", BindingType: " << binding.bindingType
-                          << ", Value: " << valueStr << "\n";
-
-                // Populate the JSON based on the binding type
-                if (binding.bindingType == "content") {
-                    bindingsJson["content"][binding.elementId] = valueStr;
-                } else if (binding.bindingType == "attribute") {
-                    bindingsJson["attributes"][binding.elementId][binding.attribute] = valueStr;
-                } else {
-                    std::cerr << "[WARN] Unknown binding type: " << binding.bindingType << "\n";
+void Interpreter::openSession(JTML::ConnectionID connection) {
+    Session& session = sessions[connection];
+    // No journal to speak of: the session ends with its connection, so
+    // there is nothing to resume
+    session.renderer = std::make_unique<JTML::Renderer>(0, 0);
+    session.renderer->setBinaryWanted(wsServer->isBinaryClient(connection));
+    session.renderer->setFrontendCallback(
+        [this, connection](const JTML::Renderer::Message& message) {
+            if (message.bindingId == JTML::NO_BINDING_ID) {
+                wsServer->sendFrame(connection, message.text, message.binary, message.key, message.lane);
+                return;
+            }
+            if (!interest->wants(connection, message.bindingId)) {
+                return;
+            }
+            if (message.value) {
+                if (sentValues->changed({ connection }, message.bindingId, message.value).empty()) {
+                    return;
                 }
+            } else {
+                sentValues->forget({ connection }, { message.bindingId });
             }
+            wsServer->sendFrame(connection, message.text, message.binary, message.key, message.lane);
+        });
+    session.renderer->setWindowedListCallback([this, connection](const std::string& elementId) {
+        std::lock_guard<std::mutex> lock(viewportsMutex);
+        auto hosts = viewports.find(connection);
+        if (hosts == viewports.end()) {
+            return;
         }
+        auto it = hosts->second.find(elementId);
+        if (it != hosts->second.end()) {
+            sendListWindow(connection, elementId, it->second);
+        }
+    });
+    for (const auto& [elementId, rowOf] : rowRenderers) {
+        session.renderer->setRowRenderer(elementId, rowOf);
+    }
+    for (const auto& [elementId, slotId] : windowedHosts) {
+        session.renderer->markWindowedList(elementId);
+    }
+    session.env = globalEnv->fork(session.renderer.get());
+    logStream() << "[DEBUG] Opened session " << connection << " (" << sessions.size() << " active).\n";
+}
 
-        // Debug log: Constructing the populateBindings message
-        std::cout << "[DEBUG] Constructing the populateBindings message.\n";
-
-        // Construct the populateBindings message
-        nlohmann::json message;
-        message["type"] = "populateBindings";
-        message["bindings"] = bindingsJson;
-
-        // Serialize the message to a string
-        std::string messageStr = message.dump();
+std::shared_ptr<JTML::Environment> Interpreter::closureOf(const JTML::Function& func) const {
+    // Top-level functions close over the program's environment; in a
+    // session they run against its fork
+    if (programEnv && func.closure == programEnv) {
+        return globalEnv;
+    }
+    return func.closure;
+}
 
-        // Debug log: Message serialization
-        std::cout << "[DEBUG] Serialized message: " << messageStr << "\n";
+std::shared_ptr<JTML::VarValue> Interpreter::sessionValueOf(const JTML::CompositeKey& key) const {
+    if (!programEnv || key.instanceID != globalEnv->instanceID) {
+        return nullptr;
+    }
+    return globalEnv->peekVariable(key);
+}
 
-        // Send the message to the client through the WebSocket
-        wsServer->sendMessage(hdl, messageStr);
+void Interpreter::populateBindings(JTML::ConnectionID connection, const std::string& epoch, uint64_t lastVersion) {
+    // Whatever the client had, it now has the current values
+    sentValues->forget(connection);
+    try {
+        JTML::StateJournal& journal = renderer->journal();
+
+        // A client resuming this run gets only the changes it missed, while
+        // the journal still holds them, in one message that tells it the
+        // sync is done; anyone else gets the snapshot
+        std::vector<std::string> missed;
+        if (!epoch.empty() && epoch == journal.epoch() && journal.changesSince(lastVersion, missed)) {
+            logStream() << "[DEBUG] Resuming client at version " << lastVersion << " with " << missed.size() << " changes.\n";
+            std::string message = "{\"type\": \"resume\", \"updates\": [";
+            for (size_t i = 0; i < missed.size(); ++i) {
+                if (i > 0) message += ",";
+                message += missed[i];
+            }
+            message += "]}";
+            wsServer->sendMessage(connection, message);
+        } else {
+            std::string messageStr;
+            std::string compressed;
+            if (!journal.cachedSnapshot(messageStr, &compressed)) {
+                messageStr = buildSnapshot(compressed);
+            }
+            // Compressed once per change, not once per connection
+            if (!compressed.empty()) {
+                wsServer->sendPrecompressed(connection, compressed, JTML::Lane::Bulk);
+            } else {
+                wsServer->sendMessage(connection, messageStr, JTML::Lane::Bulk);
+            }
+            logStream() << "[DEBUG] Sent populateBindings to frontend. Message size: " << messageStr.size() << " bytes\n";
+        }
 
-        // Debug log: Message sent
-        std::cout << "[DEBUG] Sent populateBindings to frontend. Message size: " << messageStr.size() << " bytes\n";
+        // Windowed lists are per connection and never in the snapshot;
+        // they follow it in its lane
+        std::lock_guard<std::mutex> lock(viewportsMutex);
+        for (const auto& [elementId, slotId] : windowedHosts) {
+            ListViewport& viewport = viewports[connection][elementId];
+            viewport.rows.clear();
+            sendListWindow(connection, elementId, viewport, JTML::Lane::Bulk);
+        }
     } catch (const std::exception& e) {
         // Log the error and optionally send an error message to the frontend
-        std::cerr << "[ERROR] Failed to populate bindings: " << e.what() << "\n";
-        wsServer->sendMessage(hdl, R"({"type": "error", "message": "Failed to populate bindings"})");
+        errorStream() << "[ERROR] Failed to populate bindings: " << e.what() << "\n";
+        wsServer->sendMessage(connection, R"({"type": "error", "message": "Failed to populate bindings"})",
+                              JTML::Lane::Interactive);
+    }
+}
+
+std::string Interpreter::buildSnapshot(std::string& compressed) {
+    JTML::StateJournal& journal = renderer->journal();
+    // Read before the values: a change racing the build is then re-sent
+    // to the client rather than missed
+    const uint64_t version = journal.version();
+    nlohmann::json bindingsJson;
+
+    // Debug log: Starting the snapshot build
+    logStream() << "[DEBUG] Building state snapshot at version " << version << ".\n";
+
+    // Use the global environment to gather bindings
+    std::shared_ptr<JTML::Environment> env = globalEnv;
+    if (!env) {
+        errorStream() << "[ERROR] Global environment is not initialized.\n";
+        throw std::runtime_error("Global environment is not initialized.");
+    }
+
+    // Iterate through all bindings in the environment
+    for (const auto& [varName, bindingInfos] : env->getBindings()) {
+        for (const auto& binding : bindingInfos) {
+            // Retrieve the variable's current value
+            if (binding.bindingType == "attribute_event") {
+                continue;
+            }
+            std::shared_ptr<JTML::VarValue> varVal = env->peekVariable(binding.varName);
+            std::string valueStr = varVal ? varVal->toString() : "undefined";
+
+            // Populate the JSON based on the binding type
+            if (binding.bindingType == "content") {
+                bindingsJson["content"][binding.elementId] = valueStr;
+            } else if (binding.bindingType == "attribute") {
+                bindingsJson["attributes"][binding.elementId][binding.attribute] = valueStr;
+            } else if (binding.bindingType == "if") {
+                bindingsJson["if"][binding.elementId] = valueStr;
+            } else if (binding.bindingType == "for" && windowedHosts.count(binding.elementId)) {
+                continue;
+            } else if (binding.bindingType == "for") {
+                bindingsJson["for"][binding.elementId] = listJson(rowsOf(binding.elementId, varVal));
+            } else {
+                errorStream() << "[WARN] Unknown binding type: " << binding.bindingType << "\n";
+            }
+        }
+    }
+
+    // Construct the populateBindings message
+    nlohmann::json message;
+    message["type"] = "populateBindings";
+    message["bindings"] = bindingsJson;
+    message["epoch"] = journal.epoch();
+    message["version"] = version;
+
+    std::string messageStr = message.dump();
+    compressed.clear();
+    if (messageStr.size() >= wsServer->getCompressionThreshold()) {
+        JTML::deflateFrame(messageStr, compressed);
     }
+    journal.storeSnapshot(version, messageStr, compressed);
+    return messageStr;
 }
 
 
@@ -163,7 +464,8 @@ struct ContinueException : public std::exception {
     }
 };
 
-void Interpreter::handleFrontendMessage(const std::string& msg, websocketpp::connection_hdl hdl) {
+void Interpreter::handleFrontendMessage(const std::string& msg, JTML::ConnectionID connection) {
+    SessionScope scope(*this, connection);
     try {
         // Parse the incoming message as JSON
         auto parsedMessage = nlohmann::json::parse(msg);
@@ -175,108 +477,284 @@ void Interpreter::handleFrontendMessage(const std::string& msg, websocketpp::con
 
         std::string type = parsedMessage["type"].get<std::string>();
 
-        if (type == "event") {
-            // Extract event details
-            std::string elementIdStr = parsedMessage["elementId"].get<std::string>();
-            std::string eventType = parsedMessage["eventType"].get<std::string>();
-            std::vector<nlohmann::json> args = parsedMessage.value("args", std::vector<nlohmann::json>());
-
-            std::cout << "[DEBUG] Event received: ElementID=" << elementIdStr 
-                      << ", EventType=" << eventType << "\n";
-
-      
-
-            // Find the binding for the given elementId and attribute (eventType)
-            JTML::CompositeKey elementVarKey = {globalEnv->instanceID, elementIdStr};
-            auto bindingsIt = globalEnv->bindings.find(elementIdStr);
-            if (bindingsIt != globalEnv->bindings.end()) {
-                bool bindingFound = false;
-
-                for (const auto& binding : bindingsIt->second) {
-                    
-                    if (binding.elementId == elementIdStr && binding.bindingType == "attribute_event") {
-                        bindingFound = true;
-
-                        std::cout << "[DEBUG] Found binding: ElementID=" << elementIdStr  
-                                  << ", Attribute=" << eventType << "\n";
-
-                        
-                    if (eventType == "onInput") {
-                        // Special handling for onInput: pass inputValue as the sole argument
-                        std::vector<std::shared_ptr<JTML::VarValue>> args;
-                        std::string inputValue = parsedMessage["args"][2].get<std::string>();
-                        args.push_back(std::make_shared<JTML::VarValue>(inputValue));
-
-                        // Ensure the expression is a function call
-                        if (binding.expression->getExprType() != ExpressionStatementNodeType::FunctionCall) {
-                            std::cerr << "[ERROR] onInput binding expression is not a function call.\n";
-                            renderer->sendError("onInput binding expression is not a function call.");
-                            continue;
-                        }
-
-                        // Cast to FunctionCallExpressionStatementNode to access functionName
-                        auto funcCallExpr = std::static_pointer_cast<FunctionCallExpressionStatementNode>(binding.expression);
-                        std::string functionName = funcCallExpr->functionName;
-
-                        // Retrieve the function from the environment
-                        JTML::CompositeKey funcKey{ globalEnv->instanceID, functionName };
-                        auto func = globalEnv->getFunction(funcKey);
-                        if (!func) {
-                            std::cerr << "[ERROR] Function '" << functionName << "' not found.\n";
-                            renderer->sendError("Function '" + functionName + "' not found.");
-                            continue;
-                        }
+        if (type == "sync") {
+            // A reconnecting client says which run and version it last saw
+            logStream() << "[DEBUG] Sync requested by client.\n";
+            populateBindings(connection, parsedMessage.value("epoch", std::string()),
+                             parsedMessage.value("version", uint64_t{0}));
+        } else if (type == "viewport") {
+            // A windowed for-host scrolled: send this connection its new slice
+            std::string elementId = parsedMessage["elementId"].get<std::string>();
+            if (!windowedHosts.count(elementId)) {
+                throw std::runtime_error("No windowed list with id '" + elementId + "'.");
+            }
+            std::lock_guard<std::mutex> lock(viewportsMutex);
+            ListViewport& viewport = viewports[connection][elementId];
+            viewport.first = parsedMessage.value("first", size_t{0});
+            viewport.count = parsedMessage.value("count", size_t{0});
+            sendListWindow(connection, elementId, viewport, JTML::Lane::Interactive);
+        } else if (type == "event") {
+            handleEvent(parsedMessage);
+            recalcDirty(globalEnv);
+        } else if (type == "eventBatch") {
+            handleEventBatch(parsedMessage, connection);
+        } else if (type == "interest") {
+            handleInterest(parsedMessage, connection);
+        } else {
+            errorStream() << "[WARNING] Unrecognized message type: " << type << "\n";
+            renderer->sendError("Unrecognized message type: " + type);
+        }
+    }
+    catch (const nlohmann::json::exception& e) {
+        errorStream() << "[ERROR] JSON parsing failed: " << e.what() << "\n";
+        renderer->sendError("Invalid JSON message.");
+    }
+    catch (const std::exception& e) {
+        errorStream() << "[ERROR] handleFrontendMessage exception: " << e.what() << "\n";
+        renderer->sendError(e.what());
+    }
+}
 
-                        // Execute the function with args
-                        auto result = executeFunction(func, args, nullptr);
-                        
+// Run the handler of one client event; the caller recalculates
+void Interpreter::handleEvent(const nlohmann::json& event) {
+    // Extract event details
+    std::string elementIdStr = event["elementId"].get<std::string>();
+    std::string eventType = event["eventType"].get<std::string>();
 
-                        std::cout << "[DEBUG] Event handled: ElementID=" << elementIdStr 
-                                    << ", EventType=" << eventType 
-                                    << ", Result=" << (result ? result->toString() : "(null)") << "\n";
+    logStream() << "[DEBUG] Event received: ElementID=" << elementIdStr
+                << ", EventType=" << eventType << "\n";
 
+    // Find the binding for the given elementId and attribute (eventType)
+    auto bindingsIt = globalEnv->getBindings().find(elementIdStr);
+    if (bindingsIt == globalEnv->getBindings().end()) {
+        errorStream() << "[WARNING] No bindings registered for event type: " << eventType << "\n";
+        renderer->sendError("No bindings registered for event type: " + eventType + " and element name: " + elementIdStr);
+        return;
+    }
 
-                        // Break after handling the binding
-                        recalcDirty(globalEnv);
-                        break;
-                    }
-                                   
-                    // Evaluate the derived expression (assumes it's a function call or similar)
-                    auto result = evaluateExpression(binding.expression.get(), globalEnv);
+    for (const auto& binding : bindingsIt->second) {
+        if (binding.elementId != elementIdStr || binding.bindingType != "attribute_event") {
+            continue;
+        }
+        logStream() << "[DEBUG] Found binding: ElementID=" << elementIdStr
+                    << ", Attribute=" << eventType << "\n";
 
-                    std::cout << "[DEBUG] Event handled: ElementID=" << elementIdStr    
-                                << ", EventType=" << eventType 
-                                << ", Result=" << (result ? result->toString() : "(null)") << "\n";
+        std::shared_ptr<JTML::VarValue> result;
+        if (eventType == "onInput") {
+            // Special handling for onInput: pass inputValue (after the
+            // handler's source text) as the sole argument
+            const auto& eventArgs = event.at("args");
+            std::vector<std::shared_ptr<JTML::VarValue>> args;
+            std::string inputValue = eventArgs.at(eventArgs.size() - 1).get<std::string>();
+            args.push_back(std::make_shared<JTML::VarValue>(inputValue));
 
-                    // Break after handling the binding
-                    recalcDirty(globalEnv);
-                    break;
-                }
-                
+            // Ensure the expression is a function call
+            if (binding.expression->getExprType() != ExpressionStatementNodeType::FunctionCall) {
+                errorStream() << "[ERROR] onInput binding expression is not a function call.\n";
+                renderer->sendError("onInput binding expression is not a function call.");
+                continue;
             }
 
-            if (!bindingFound) {
-                std::cerr << "[WARNING] No binding found for ElementID=" << elementIdStr
-                            << ", EventType=" << eventType << "\n";
-                renderer->sendError("No binding found for the triggered event.");
+            // Cast to FunctionCallExpressionStatementNode to access functionName
+            auto funcCallExpr = std::static_pointer_cast<FunctionCallExpressionStatementNode>(binding.expression);
+            std::string functionName = funcCallExpr->functionName;
+
+            // Retrieve the function from the environment
+            JTML::CompositeKey funcKey{ globalEnv->instanceID, functionName };
+            auto func = globalEnv->getFunction(funcKey);
+            if (!func) {
+                errorStream() << "[ERROR] Function '" << functionName << "' not found.\n";
+                renderer->sendError("Function '" + functionName + "' not found.");
+                continue;
             }
+
+            // Execute the function with args
+            result = executeFunction(func, args, nullptr);
         } else {
-            std::cerr << "[WARNING] No bindings registered for event type: " << eventType << "\n";
-            renderer->sendError("No bindings registered for event type: " + eventType + " and element name: " + elementIdStr);
+            // Evaluate the derived expression (assumes it's a function call or similar)
+            result = evaluateExpression(binding.expression.get(), globalEnv);
         }
+
+        logStream() << "[DEBUG] Event handled: ElementID=" << elementIdStr
+                    << ", EventType=" << eventType
+                    << ", Result=" << (result ? result->toString() : "(null)") << "\n";
+        return;
+    }
+
+    errorStream() << "[WARNING] No binding found for ElementID=" << elementIdStr
+                  << ", EventType=" << eventType << "\n";
+    renderer->sendError("No binding found for the triggered event.");
+}
+
+// A client's batched events as one transaction: one recalculation, their
+// updates sent together, and a single reply to the client acking the last
+// event (with the updates it caused)
+void Interpreter::handleEventBatch(const nlohmann::json& message, JTML::ConnectionID connection) {
+    uint64_t ack = message.value("ack", uint64_t{0});
+    renderer->beginTransaction();
+    try {
+        for (const auto& event : message.value("events", nlohmann::json::array())) {
+            ack = std::max(ack, event.value("seq", uint64_t{0}));
+            try {
+                handleEvent(event);
+            } catch (const std::exception& e) {
+                errorStream() << "[ERROR] Event in batch failed: " << e.what() << "\n";
+                renderer->sendError(e.what());
+            }
+        }
+        recalcDirty(globalEnv);
+    } catch (const std::exception& e) {
+        errorStream() << "[ERROR] Event batch failed: " << e.what() << "\n";
+        renderer->sendError(e.what());
+    }
+    JTML::Renderer::Batch batch = renderer->endTransaction();
+
+    std::string updates = "[";
+    for (size_t i = 0; i < batch.updates.size(); ++i) {
+        if (i > 0) updates += ",";
+        updates += batch.updates[i];
+    }
+    updates += "]";
+
+    std::string binaryReply;
+    if (!batch.binary.empty()) {
+        binaryReply.push_back(static_cast<char>(JTML::WireOp::Ack));
+        JTML::appendVarint(binaryReply, ack);
+        binaryReply += batch.binary;
+    }
+    // The sender's reply goes ahead of whatever else waits for it
+    sentValues->forget({ connection }, batch.bindingIds);
+    wsServer->sendFrame(connection,
+                        "{\"type\": \"batch\", \"ack\": " + std::to_string(ack) + ", \"updates\": " + updates + "}",
+                        binaryReply, std::string(), JTML::Lane::Interactive);
+
+    // Everyone else sees the same changes (a session's are its own)
+    if (!sessionsEnabled && !batch.updates.empty()) {
+        sendToInterested(batch.bindingIds, "{\"type\": \"batch\", \"updates\": " + updates + "}", batch.binary,
+                         std::string(), JTML::Lane::Updates, connection);
+    }
+}
+
+void Interpreter::sendToInterested(const std::vector<uint32_t>& slots, const std::string& text,
+                                   const std::string& binary, const std::string& key, JTML::Lane lane,
+                                   JTML::ConnectionID except, const JTML::SentValues::Value& value) {
+    if (std::find(slots.begin(), slots.end(), JTML::NO_BINDING_ID) != slots.end()) {
+        wsServer->broadcastFrame(text, binary, key, lane, except);
+        return;
+    }
+    std::vector<JTML::ConnectionID> targets = interest->audience(slots);
+    targets.erase(std::remove(targets.begin(), targets.end(), except), targets.end());
+    if (value && slots.size() == 1) {
+        targets = sentValues->changed(targets, slots.front(), value);
     } else {
-            std::cerr << "[WARNING] Unrecognized message type: " << type << "\n";
-            renderer->sendError("Unrecognized message type: " + type);
+        sentValues->forget(targets, slots);  // a patch, splice or batch: no value to compare
+    }
+    if (!targets.empty()) {
+        wsServer->multicastFrame(targets, text, binary, key, lane);
+    }
+}
+
+void Interpreter::handleInterest(const nlohmann::json& message, JTML::ConnectionID connection) {
+    auto slotsIn = [&](const char* field) {
+        std::vector<uint32_t> slots;
+        for (const auto& id : message.value(field, nlohmann::json::array())) {
+            if (id.is_number_unsigned() && id.get<uint64_t>() < bindingTable.size()) {
+                slots.push_back(id.get<uint32_t>());
+            }
         }
+        return slots;
+    };
+    const std::vector<uint32_t> added = slotsIn("add");
+    if (interest->update(connection, added, slotsIn("remove"))) {
+        return;  // the first: the page has a snapshot or server-rendered values
+    }
+
+    // Slots that just appeared missed the changes made while they were
+    // hidden: send their current values, as of the journal's version
+    const uint64_t version = renderer->journal().version();
+    nlohmann::json updates = nlohmann::json::array();
+    for (uint32_t id : added) {
+        const BindingSlot& slot = bindingTable[id];
+        JTML::CompositeKey slotKey{ globalEnv->instanceID, slot.name };
+        std::shared_ptr<JTML::VarValue> value = globalEnv->peekVariable(slotKey);
+        const std::string valueStr = value ? value->toString() : "undefined";
+        nlohmann::json update;
+        update["elementId"] = slot.elementId;
+        switch (slot.kind) {
+            case BindingKind::Content:
+                update["type"] = "updateBinding";
+                update["value"] = valueStr;
+                break;
+            case BindingKind::Attribute:
+                update["type"] = "updateAttribute";
+                update["attribute"] = slot.attribute;
+                update["value"] = valueStr;
+                break;
+            case BindingKind::If:
+                update["type"] = "updateIf";
+                update["value"] = valueStr;
+                break;
+            case BindingKind::For:
+                if (windowedHosts.count(slot.elementId)) {
+                    continue;  // its viewport report brings the rows
+                }
+                update["type"] = "updateFor";
+                update["list"] = listJson(rowsOf(slot.elementId, value));
+                break;
+            default:
+                continue;
+        }
+        update["version"] = version;
+        updates.push_back(std::move(update));
     }
-    catch (const nlohmann::json::exception& e) {
-        std::cerr << "[ERROR] JSON parsing failed: " << e.what() << "\n";
-        renderer->sendError("Invalid JSON message.");
+    if (!updates.empty()) {
+        nlohmann::json reply;
+        reply["type"] = "batch";
+        reply["updates"] = std::move(updates);
+        sentValues->forget({ connection }, added);
+        wsServer->sendMessage(connection, reply.dump(), JTML::Lane::Interactive);
     }
-    catch (const std::exception& e) {
-        std::cerr << "[ERROR] handleFrontendMessage exception: " << e.what() << "\n";
-        renderer->sendError(e.what());
+}
+
+std::string Interpreter::admitEvents(const std::string& msg, JTML::ConnectionID connection) {
+    std::string elementId;
+    if (eventTarget(msg, elementId)) {
+        return eventGate->offer(connection, elementId, msg) ? std::string() : msg;
+    }
+    auto parsed = nlohmann::json::parse(msg, nullptr, false);
+    if (!parsed.is_object() || parsed.value("type", std::string()) != "eventBatch" ||
+        !parsed.contains("events") || !parsed["events"].is_array()) {
+        return msg;
+    }
+    // Events with a policy leave the batch for the gate, each as a batch of
+    // its own: the ack of the rest covers only them, and a gated event is
+    // acked (with its updates) once the gate runs it
+    nlohmann::json kept = nlohmann::json::array();
+    bool gated = false;
+    for (auto& event : parsed["events"]) {
+        if (!event.is_object()) {
+            continue;
+        }
+        auto target = event.find("elementId");
+        if (target != event.end() && target->is_string()) {
+            nlohmann::json single;
+            single["type"] = "eventBatch";
+            single["events"] = nlohmann::json::array({ event });
+            if (eventGate->offer(connection, target->get<std::string>(), single.dump())) {
+                gated = true;
+                continue;
+            }
+        }
+        kept.push_back(std::move(event));
+    }
+    if (!gated) {
+        return msg;
     }
+    if (kept.empty()) {
+        return std::string();
+    }
+    parsed["events"] = std::move(kept);
+    return parsed.dump();
 }
 
 
@@ -290,11 +768,11 @@ std::shared_ptr<JTML::Environment> Interpreter::getCurrentEnvironment() const {
 
 void Interpreter::interpret(const JtmlElementNode& root) {
     // Recursively process the JtmlElementNode
-    std::cout << "Interpreting element: " << root.tagName << "\n";
+    logStream() << "Interpreting element: " << root.tagName << "\n";
 
     // Process attributes
     for (const auto& attr : root.attributes) {
-        std::cout << "  Attribute: " << attr.key << " = " << attr.value->toString() << "\n";
+        logStream() << "  Attribute: " << attr.key << " = " << attr.value->toString() << "\n";
     }
 
     // Process child nodes
@@ -310,8 +788,11 @@ void Interpreter::interpret(const ASTNode& node) {
 
 // Interpret a vector of AST nodes (e.g., the entire program)
 void Interpreter::interpret(const std::vector<std::unique_ptr<ASTNode>>& program) {
+    // Compile the whole import graph up front (in parallel) so import statements only instantiate
+    ModuleLoader::instance().preload(program, moduleBaseDir);
+
     for (const auto& node : program) {
-            std::cout << " " << node->toString() << "\n";
+            logStream() << " " << node->toString() << "\n";
             interpretNode(*node);
         
     }
@@ -339,7 +820,12 @@ void Interpreter::interpret(const std::string& code) {
 
         // Optionally, check for parser errors if your Parser provides such functionality
 
+        // One compiler pass yields the binding table for any elements in the code
+        JtmlTranspiler compiler;
+        CompileResult compiled = compiler.compile(program);
+
         interpret(program);
+        loadBindingTable(compiled.bindings);
     }
     catch (const std::exception& e) {
         handleError(std::string("Interpretation error: ") + e.what());
@@ -348,7 +834,7 @@ void Interpreter::interpret(const std::string& code) {
 
 // Interpret a single AST node by delegating to specific methods
 void Interpreter::interpretNode(const ASTNode& node) {
-    std::cout << "Interpreting node " << node.toString() << "\n";
+    logStream() << "Interpreting node " << node.toString() << "\n";
     try {
         switch (node.getType()) {
             case ASTNodeType::JtmlElement:
@@ -411,8 +897,11 @@ void Interpreter::interpretNode(const ASTNode& node) {
             case ASTNodeType::ClassDeclaration:
                 interpretClassDeclaration(static_cast<const ClassDeclarationNode&>(node));
                 break;
+            case ASTNodeType::ImportStatement:
+                interpretImport(static_cast<const ImportStatementNode&>(node));
+                break;
             case ASTNodeType::ReturnStatement:
-                std::cout << "ReturnStatement node" << node.toString();
+                logStream() << "ReturnStatement node" << node.toString();
                 interpretReturn(static_cast<const ReturnStatementNode&>(node));
                 break;
             case ASTNodeType::NoOp:
@@ -435,104 +924,213 @@ void Interpreter::interpretNode(const ASTNode& node) {
 // ------------------- Interpretation Methods -------------------
 
 void Interpreter::interpretElement(const JtmlElementNode& elem) {
-    std::cout << "[DEBUG] Interpreting Element: <" << elem.tagName << ">\n";
-    nodeID++;
-    // Create a new environment for this element
-  
+    // Elements are compiled, not executed: their attributes and show/if/for/while
+    // holes arrive as slots through loadBindingTable()
+    logStream() << "[DEBUG] Skipping compiled Element: <" << elem.tagName << ">\n";
+}
 
-    // Evaluate attributes or do any binding registrations (transpile-time binding approach)
+// ------------------- Binding Table -------------------
 
-    interpretElementAttributes(elem);
+void Interpreter::setBinaryFraming(bool enabled) {
+    wsServer->setBinaryFraming(enabled);
+}
 
-    // Now interpret child statements: only show, if, for, while, or nested element
-    for (auto& child : elem.content) {
-        switch(child->getType()) {
-            case ASTNodeType::ShowStatement:
-                interpretShowElement(static_cast<const ShowStatementNode&>(*child));
-                break;
-            case ASTNodeType::IfStatement:
-                interpretIfElement(static_cast<const IfStatementNode&>(*child));
-                break;
-            case ASTNodeType::ForStatement:
-                interpretForElement(static_cast<const ForStatementNode&>(*child));
-                break;
-            case ASTNodeType::WhileStatement:
-                interpretWhileElement(static_cast<const WhileStatementNode&>(*child));
-                break;
-            case ASTNodeType::JtmlElement:
-                interpretElement(static_cast<const JtmlElementNode&>(*child));
-                break;
-            default:
-                // not allowed inside an element
-                std::cerr << "[ERROR] Disallowed statement '"
-                          << child->toString()
-                          << "' inside <" << elem.tagName << ">\n";
-                break;
+void Interpreter::setCompression(size_t threshold, bool contextTakeover) {
+    wsServer->setCompression(threshold, contextTakeover);
+}
+
+void Interpreter::setIoThreads(size_t threads) {
+    wsServer->setIoThreads(threads);
+}
+
+void Interpreter::setBackpressure(JTML::BackpressurePolicy policy) {
+    wsServer->setBackpressure(policy);
+}
+
+void Interpreter::loadBindingTable(const BindingTable& table) {
+    if (table.empty()) {
+        return;  // statements only: the page already loaded stays as it is
+    }
+    if (!bindingTable.empty()) {
+        // Every table numbers its slots from 0 (expr_0, ...): clients of the
+        // loaded page would read the new bindings under their old ids
+        throw std::runtime_error("A binding table is already loaded; use a new Interpreter for another page.");
+    }
+    bindingTable = table;
+    logStream() << "[DEBUG] Loading binding table with " << bindingTable.size() << " slots.\n";
+
+    for (size_t id = 0; id < bindingTable.size(); ++id) {
+        const BindingSlot& slot = bindingTable[id];
+        try {
+            if (slot.kind == BindingKind::For && slot.windowSize > 0) {
+                windowedHosts[slot.elementId] = static_cast<BindingID>(id);
+                renderer->markWindowedList(slot.elementId);
+            }
+            if (slot.kind == BindingKind::For) {
+                JTML::RowRenderer rowOf = [this, id](const std::shared_ptr<JTML::VarValue>& item) {
+                    return renderRow(bindingTable[id], item);
+                };
+                rowRenderers[slot.elementId] = rowOf;
+                renderer->setRowRenderer(slot.elementId, rowOf);
+            }
+            if (slot.kind == BindingKind::Event) {
+                eventGate->setPolicy(slot.elementId, slot.eventPolicy);
+            }
+            bindSlot(static_cast<BindingID>(id));
+        } catch (const std::exception& e) {
+            handleError("Binding '" + slot.name + "' failed: " + std::string(e.what()));
         }
     }
+    recalcDirty(globalEnv);
+}
 
-   
-    std::cout << "[DEBUG] Exiting Element <" << elem.tagName << ">\n";
+bool Interpreter::bindingValue(BindingID id, std::string& out) const {
+    if (id >= bindingTable.size()) {
+        return false;
+    }
+    JTML::CompositeKey slotKey{ globalEnv->instanceID, bindingTable[id].name };
+    auto value = globalEnv->peekVariable(slotKey);
+    if (!value) {
+        return false;
+    }
+    // for-hosts take the item list the client clones their body for;
+    // a windowed one renders its first window
+    if (bindingTable[id].kind == BindingKind::For && bindingTable[id].windowSize > 0) {
+        ListViewport viewport;
+        out = listWindow(bindingTable[id].elementId, value, viewport).dump();
+    } else if (bindingTable[id].kind == BindingKind::For) {
+        out = listJson(rowsOf(bindingTable[id].elementId, value)).dump();
+    } else {
+        out = value->toString();
+    }
+    return true;
 }
-// In jtml_interpreter.cpp
 
-void Interpreter::interpretElementAttributes(const JtmlElementNode& elem) {
-    // Iterate through all attributes of the element
-    for (const auto& attr : elem.attributes) {
-        
-        const std::string& attrName = attr.key;
-        if (attrName  == "onClick" || attrName == "onInput" || attrName == "onMouseOver") {
-            uniqueVarID++;
-            const std::unique_ptr<ExpressionStatementNode>& attrValue = attr.value;
-            std::string derivedVarName = "attr_" + std::to_string(uniqueVarID);
-        
-            JTML::CompositeKey attrKey{ globalEnv->instanceID, derivedVarName };
-                    // Create a BindingInfo for the attribute
-            JTML::BindingInfo binding;
-            binding.varName = attrKey;
-            binding.elementId = "attr_" + std::to_string(uniqueVarID);
-            binding.bindingType = "attribute_event";
-            binding.attribute = attrName;
-            binding.expression = attrValue->clone();
-
-            // Register the binding
-            globalEnv->registerBinding(binding); 
+std::shared_ptr<JTML::Environment> Interpreter::rowScope(const BindingSlot& slot,
+                                                        const std::shared_ptr<JTML::VarValue>& item) const {
+    // The row's own scope: a global of the iterator's name is shadowed,
+    // not assigned, and the item keeps its key in the list
+    auto scope = std::make_shared<JTML::Environment>(globalEnv);
+    scope->defineLocal({ scope->instanceID, slot.iteratorName }, item);
+    return scope;
+}
 
-        } else {
-            uniqueVarID++;
-            const std::unique_ptr<ExpressionStatementNode>& attrValue = attr.value;
-            // Register attribute bindings similar to content bindings
-            std::string derivedVarName = "attr_" + std::to_string(uniqueVarID);
-            
-            JTML::CompositeKey attrKey{ globalEnv->instanceID, derivedVarName };
+std::string Interpreter::renderRow(const BindingSlot& slot, const std::shared_ptr<JTML::VarValue>& item) {
+    nlohmann::json holes = nlohmann::json::array();
+    if (slot.rowHoles.empty()) {
+        return holes.dump();
+    }
+    auto scope = rowScope(slot, item);
+    for (const RowHole& hole : slot.rowHoles) {
+        try {
+            auto value = evaluateExpression(hole.expression.get(), scope);
+            holes.push_back(value ? value->toString() : "undefined");
+        } catch (const std::exception& e) {
+            handleError("Row of '" + slot.name + "' failed: " + std::string(e.what()));
+            holes.push_back("");
+        }
+    }
+    return holes.dump();
+}
 
-            // Gather dependencies
-            std::vector<JTML::CompositeKey> deps;
-            gatherDeps(attrValue.get(), deps, globalEnv);
+std::vector<JTML::ListEntry> Interpreter::rowsOf(const std::string& elementId, const std::shared_ptr<JTML::VarValue>& list,
+                                                 size_t first, size_t count) const {
+    auto it = rowRenderers.find(elementId);
+    return JTML::listEntriesOf(list, it != rowRenderers.end() ? it->second : JTML::RowRenderer(), first, count);
+}
 
-            // Clone the expression
-            std::unique_ptr<ExpressionStatementNode> clonedExpr = attrValue->clone();
+nlohmann::json Interpreter::listWindow(const std::string& elementId, const std::shared_ptr<JTML::VarValue>& list,
+                                       ListViewport& viewport) const {
+    const BindingSlot& slot = bindingTable[windowedHosts.at(elementId)];
+    // Never more than a few windows, whatever the client claims to show
+    const size_t size = std::max(slot.windowSize, std::min(viewport.count, slot.windowSize * 4));
 
-            // Define an evaluator lambda
-            auto evaluator = [this](const ExpressionStatementNode* expr) -> std::shared_ptr<JTML::VarValue> {
-                return evaluateExpression(expr, this->globalEnv);
-            };
+    viewport.total = JTML::listLength(list);
+    viewport.start = windowStart(viewport.total, size, viewport.first, viewport.count);
+    viewport.rows = rowsOf(elementId, list, viewport.start, size);
 
-            // Derive the variable
-            globalEnv->deriveVariable(attrKey, std::move(clonedExpr), deps, evaluator);
+    nlohmann::json json = listJson(viewport.rows);
+    json["start"] = viewport.start;
+    json["total"] = viewport.total;
+    return json;
+}
 
-            // Create a BindingInfo for the attribute
-            JTML::BindingInfo binding;
-            binding.varName = attrKey;
-            binding.elementId = "attr_" + std::to_string(uniqueVarID);
-            binding.bindingType = "attribute";
-            binding.attribute = attrName;
-            binding.expression = attrValue->clone();
+void Interpreter::sendListWindow(JTML::ConnectionID connection, const std::string& elementId, ListViewport& viewport,
+                                 JTML::Lane lane) {
+    JTML::CompositeKey slotKey{ globalEnv->instanceID, bindingTable[windowedHosts.at(elementId)].name };
+    auto list = globalEnv->peekVariable(slotKey);
+
+    const std::vector<JTML::ListEntry> previous = std::move(viewport.rows);
+    const size_t previousStart = viewport.start;
+    const size_t previousTotal = viewport.total;
+    nlohmann::json window = listWindow(elementId, list, viewport);
+
+    nlohmann::json message;
+    message["elementId"] = elementId;
+    if (previous.empty()) {
+        message["type"] = "updateFor";
+        message["list"] = std::move(window);
+    } else {
+        // Rows are keyed, so a scroll of a few rows is a few ops
+        nlohmann::json ops = nlohmann::json::array();
+        for (const auto& op : JTML::diffLists(previous, viewport.rows)) {
+            nlohmann::json step = nlohmann::json::array({ std::string(1, op.kind), op.index });
+            if (op.kind == 'a' || op.kind == 'i') step.push_back(op.key);
+            if (op.kind == 'i' || op.kind == 'u') step.push_back(op.value);
+            ops.push_back(std::move(step));
+        }
+        if (ops.empty() && viewport.start == previousStart && viewport.total == previousTotal) {
+            return;
+        }
+        message["type"] = "patchFor";
+        message["ops"] = std::move(ops);
+        message["start"] = viewport.start;
+        message["total"] = viewport.total;
+    }
+    wsServer->sendMessage(connection, message.dump(), lane);
+}
 
-            // Register the binding
-            globalEnv->registerBinding(binding);  
+void Interpreter::bindSlot(BindingID id) {
+    const BindingSlot& slot = bindingTable[id];
+    if (!slot.expression) {
+        throw std::runtime_error("Binding slot has no expression.");
+    }
+    JTML::CompositeKey slotKey{ globalEnv->instanceID, slot.name };
+
+    // Event handlers are evaluated when the client fires them; every other
+    // slot is a derived variable that pushes updates through its binding
+    if (slot.kind != BindingKind::Event) {
+        std::vector<JTML::CompositeKey> deps;
+        gatherDeps(slot.expression.get(), deps, globalEnv);
+        if (!slot.rowHoles.empty()) {
+            // Rows re-render when what their holes read besides the item changes
+            auto scope = rowScope(slot, std::make_shared<JTML::VarValue>(std::string()));
+            std::vector<JTML::CompositeKey> rowDeps;
+            for (const RowHole& hole : slot.rowHoles) {
+                gatherDeps(hole.expression.get(), rowDeps, scope);
+            }
+            for (const auto& dep : rowDeps) {
+                const std::string& name = dep.varName;
+                if (name != slot.iteratorName && name.rfind(slot.iteratorName + "[", 0) != 0) {
+                    deps.push_back({ globalEnv->instanceID, name });
+                }
+            }
         }
+
+        auto evaluator = [this](const ExpressionStatementNode* expr) {
+            return evaluateExpression(expr, globalEnv);
+        };
+        globalEnv->deriveVariable(slotKey, slot.expression->clone(), deps, evaluator);
     }
+
+    JTML::BindingInfo binding;
+    binding.varName = slotKey;
+    binding.elementId = slot.elementId;
+    binding.attribute = slot.attribute;
+    binding.bindingType = bindingKindName(slot.kind);
+    binding.expression = slot.expression;
+    binding.bindingId = id;
+    globalEnv->registerBinding(binding);
 }
 
 // Helper function to determine if an attribute is an event handler
@@ -567,292 +1165,8 @@ bool Interpreter::containsExpression(const ExpressionStatementNode* exprNode) co
 }
 
 
-void Interpreter::interpretShowElement(const ShowStatementNode& node) {
-    nodeID++;
-    uniqueVarID++;
-    auto itNode = transpiler.nodeDerivedMap.find(nodeID);
-    if (itNode == transpiler.nodeDerivedMap.end()) {
-        std::cerr << "[WARN] No derived var for Show nodeID=" 
-                  << nodeID << "\n";
-        return;
-    }
-    auto itVar = itNode->second.find("show");
-    if (itVar == itNode->second.end()) {
-        // fallback ephemeral
-        std::cerr << "[WARN] Misplaced var for Show nodeID=" 
-                  << nodeID << "\n";
-        return;
-    }
-    std::string derivedName = itVar->second;
-    std::vector<JTML::CompositeKey> deps;
-    gatherDeps(node.expr.get(), deps, globalEnv);
-
-    auto cloned = node.expr->clone();
-    auto eval   = [this](const ExpressionStatementNode* expr){
-        return evaluateExpression(expr, globalEnv);
-    };
-
-    JTML::CompositeKey showKey{ globalEnv->instanceID, derivedName };
-    globalEnv->deriveVariable(showKey, std::move(cloned), deps, eval);
-
-    // binding
-    JTML::BindingInfo b;
-    b.varName     = showKey;
-    b.elementId = "expr_" + std::to_string(uniqueVarID);
-    b.bindingType = "content"; // e.g. content or "show"
-    b.expression = node.expr->clone();
-    globalEnv->registerBinding(b);
-
-    // interpret once => log or similar
-    auto val = globalEnv->getVariable(showKey);
-    std::cout << "[SHOW] " << derivedName << " => "
-              << (val ? val->toString() : "(null)") << "\n";
-}
-
-
-void Interpreter::interpretWhileElement(const WhileStatementNode& node) {
-    nodeID++;
-    uniqueVarID++;
-    auto itNode = transpiler.nodeDerivedMap.find(nodeID);
-    if (itNode == transpiler.nodeDerivedMap.end()) {
-        std::cerr << "[WARN] No entry in transpiler.nodeDerivedMap for While nodeID=" 
-                  << nodeID << "\n";
-        return;
-    }
-    auto itVar = itNode->second.find("while");
-    if (itVar == itNode->second.end()) {
-        // fallback ephemeral
-        std::cerr << "[WARN] Misplaced var for While nodeID=" 
-                << nodeID << "\n";
-        return;
-    }
-    std::string derivedName = itVar->second;
-    // gather deps, define variable
-    std::vector<JTML::CompositeKey> deps;
-    gatherDeps(node.condition.get(), deps, globalEnv);
-
-    auto cloned = node.condition->clone();
-    auto eval = [this](const ExpressionStatementNode* expr){
-        return evaluateExpression(expr, globalEnv);
-    };
-
-    JTML::CompositeKey condKey{ globalEnv->instanceID, derivedName };
-    globalEnv->deriveVariable(condKey, std::move(cloned), deps, eval);
-
-    // binding
-    JTML::BindingInfo b;
-    b.varName     = condKey;
-    b.elementId = "cond_" + std::to_string(uniqueVarID);
-    b.bindingType = "while";
-    b.expression = node.condition->clone();
-    globalEnv->registerBinding(b);
-
-    // server side while loop if you want
-    while(true) {
-        bool condVal = isTruthy(globalEnv->getVariable(condKey)->toString());
-        if(!condVal) break;
-
-        try {
-            for (auto& stmt : node.body) {
-                interpretNode(*stmt);
-            }
-        } catch (const BreakException&) {
-            break;
-        } catch (const ContinueException&) {
-            continue;
-        }
-        recalcDirty(globalEnv);
-    }
-}
-
-void Interpreter::interpretIfElement(const IfStatementNode& node) {
-    nodeID++;
-    uniqueVarID++;
-    auto itNode = transpiler.nodeDerivedMap.find(nodeID);
-    if (itNode == transpiler.nodeDerivedMap.end()) {
-        std::cerr << "[WARN] No entry in transpiler.nodeDerivedMap for If nodeID=" 
-                  << nodeID << "\n";
-        return;
-    }
-    auto itVar = itNode->second.find("if");
-    if (itVar == itNode->second.end()) {
-        // fallback ephemeral
-        std::cerr << "[WARN] Misplaced var for If nodeID=" 
-                << nodeID << "\n";
-        return;
-    }
-    std::string derivedName = itVar->second;
-    std::vector<JTML::CompositeKey> deps;
-    gatherDeps(node.condition.get(), deps, globalEnv);
-
-    // define the derived variable
-    auto clonedExpr = node.condition->clone();
-    auto evaluator  = [this](const ExpressionStatementNode* expr){
-        return evaluateExpression(expr, globalEnv);
-    };
-
-    JTML::CompositeKey condKey{ globalEnv->instanceID, derivedName };
-    globalEnv->deriveVariable(condKey, std::move(clonedExpr), deps, evaluator);
-
-    // register an "if" binding
-    JTML::BindingInfo bind;
-    bind.varName = condKey;
-    bind.elementId = "cond_" + std::to_string(uniqueVarID);
-    bind.bindingType = "if";
-    bind.expression = node.condition->clone();
-    globalEnv->registerBinding(bind);
-
-    // interpret THEN/ELSE once if you want
-    bool condResult = isTruthy(globalEnv->getVariable(condKey)->toString());
-    if (condResult) {
-        for (auto& stmt : node.thenStatements) {
-            interpretNode(*stmt);
-        }
-    } else {
-        for (auto& stmt : node.elseStatements) {
-            interpretNode(*stmt);
-        }
-    }
-}
-
-
-void Interpreter::interpretForElement(const ForStatementNode& node) {
-    nodeID++;
-    uniqueVarID++;
-    auto forNode = transpiler.nodeDerivedMap.find(nodeID);
-    if (forNode == transpiler.nodeDerivedMap.end()) {
-        std::cerr << "[WARN] No entry in transpiler.nodeDerivedMap for For nodeID=" 
-                  << nodeID << "\n";
-        return;
-    }
-    auto forVar = forNode->second.find("for");
-    if (forVar == forNode->second.end()) {
-        // fallback ephemeral
-        std::cerr << "[WARN] Misplaced var for For nodeID=" 
-                << nodeID << "\n";
-        return;
-    }
-    std::string derivedName = forVar->second;
-    std::vector<JTML::CompositeKey> deps;
-    gatherDeps(node.iterableExpression.get(), deps, globalEnv);
-
-    // define the derived variable
-    auto clonedExpr = node.iterableExpression->clone();
-    auto evaluator  = [this](const ExpressionStatementNode* expr){
-        return evaluateExpression(expr, globalEnv);
-    };
-
-    JTML::CompositeKey condKey{ globalEnv->instanceID, derivedName };
-    globalEnv->deriveVariable(condKey, std::move(clonedExpr), deps, evaluator);
-
-    // register an "if" binding
-    JTML::BindingInfo bind;
-    bind.varName = condKey;
-    bind.bindingType = "for";
-    bind.elementId = "range_" + std::to_string(uniqueVarID);
-    bind.expression = node.iterableExpression->clone();
-    globalEnv->registerBinding(bind);
-
-        // 7) (Optional) Actually interpret the loop on the server side
-    //    For example:
-    try {
-        // Evaluate the iterable expression => array, string, or numeric range
-        auto iterableVal = evaluateExpression(node.iterableExpression.get(), globalEnv);
-
-        if (!node.rangeEndExpr) {
-            // “for (i in array_or_string)”
-            if (iterableVal->isArray()) {
-                const auto& arr = iterableVal->getArray();
-                for (size_t idx = 0; idx < arr->size(); ++idx) {
-                    // Bind the iterator variable
-                    JTML::CompositeKey iterKey = { globalEnv->instanceID, node.iteratorName };
-                    globalEnv->setVariable(iterKey, (*arr)[idx]);
-
-                    try {
-                        // interpret each statement in the loop body
-                        for (const auto& stmt : node.body) {
-                            interpretNode(*stmt);
-                        }
-                    }
-                    catch (const BreakException&) {
-                        break;
-                    }
-                    catch (const ContinueException&) {
-                        continue;
-                    }
-                    recalcDirty(globalEnv);
-                }
-            }
-            else if (iterableVal->isString()) {
-                const std::string& s = iterableVal->getString();
-                for (char c : s) {
-                    auto cVal = std::make_shared<JTML::VarValue>(std::string(1, c));
-                    JTML::CompositeKey iterKey = { globalEnv->instanceID, node.iteratorName };
-                    globalEnv->setVariable(iterKey, cVal);
-
-                    try {
-                        for (const auto& stmt : node.body) {
-                            interpretNode(*stmt);
-                        }
-                    }
-                    catch (const BreakException&) {
-                        break;
-                    }
-                    catch (const ContinueException&) {
-                        continue;
-                    }
-                    recalcDirty(globalEnv);
-                }
-            }
-            else {
-                throw std::runtime_error("For loop: not array, not string, no rangeEndExpr => invalid iterable.");
-            }
-        }
-        else {
-            // “for (i in X..Y)”
-            std::shared_ptr<JTML::VarValue> endVal =
-                evaluateExpression(node.rangeEndExpr.get(), globalEnv);
-
-            double startNum = getNumericValue(iterableVal);
-            double endNum   = getNumericValue(endVal);
-
-            int startI = static_cast<int>(startNum);
-            int endI   = static_cast<int>(endNum);
-
-            for (int i = startI; i <= endI; i++) {
-                auto iVal = std::make_shared<JTML::VarValue>(static_cast<double>(i));
-                JTML::CompositeKey iterKey = { globalEnv->instanceID, node.iteratorName };
-                globalEnv->setVariable(iterKey, iVal);
-
-                try {
-                    for (const auto& stmt : node.body) {
-                        interpretNode(*stmt);
-                    }
-                }
-                catch (const BreakException&) {
-                    break;
-                }
-                catch (const ContinueException&) {
-                    continue;
-                }
-                recalcDirty(globalEnv);
-            }
-        }
-    }
-    catch (const ReturnException&) {
-        // Let ReturnException bubble up for function returns
-        throw;
-    }
-    catch (const std::exception& e) {
-        handleError("For Loop Interpretation Error (server side iteration): " + std::string(e.what()));
-    }
-
-}
-
-
-
 void Interpreter::interpretBlockStatement(const BlockStatementNode& block) {
-    std::cout << "[DEBUG] Entering BlockStatement with " 
+    logStream() << "[DEBUG] Entering BlockStatement with " 
               << block.statements.size() << " statements.\n";
     
     auto previousEnv = currentEnv;
@@ -860,7 +1174,7 @@ void Interpreter::interpretBlockStatement(const BlockStatementNode& block) {
 
     try {
         for (const auto& stmt : block.statements) {
-            std::cout << "Interpreting node " << stmt->toString() << "\n";
+            logStream() << "Interpreting node " << stmt->toString() << "\n";
             interpretNode(*stmt);
         }
     } catch (...) {
@@ -871,12 +1185,12 @@ void Interpreter::interpretBlockStatement(const BlockStatementNode& block) {
 
     currentEnv = previousEnv;
 
-    std::cout << "[DEBUG] Exiting BlockStatement.\n";
+    logStream() << "[DEBUG] Exiting BlockStatement.\n";
 }
 
 void Interpreter::interpretShow(const ShowStatementNode& stmt) {
     if (!stmt.expr) {
-        std::cout << "[SHOW] (empty?)\n";
+        logStream() << "[SHOW] (empty?)\n";
         return;
     }
     // Evaluate the expression => store it in a new server var like expr_X
@@ -884,7 +1198,7 @@ void Interpreter::interpretShow(const ShowStatementNode& stmt) {
     // Evaluate
     auto val = evaluateExpression(stmt.expr.get(), currentEnv);
 
-    std::cout << "[SHOW] " <<  val->toString() << "\n";
+    logStream() << "[SHOW] " <<  val->toString() << "\n";
     // Whenever val changes, the environment can push updateBinding messages
 }
 
@@ -893,7 +1207,7 @@ void Interpreter::interpretExpression(const ExpressionNode& node) {
     auto result = evaluateExpression(node.expression.get(), currentEnv);
 
     // Optionally, handle side effects or log the result
-    std::cout << "[DEBUG] Evaluated expression: " << result->toString() << "\n";
+    logStream() << "[DEBUG] Evaluated expression: " << result->toString() << "\n";
 }
 
 void Interpreter::interpretDefine(const DefineStatementNode& stmt) {
@@ -912,23 +1226,23 @@ void Interpreter::interpretDefine(const DefineStatementNode& stmt) {
         }
 
         // Enhanced Logging: Separate value and type information
-        std::cout << "[DEFINE] " << currentEnv->getCompositeName(varKey) << " = " << valPtr->toString();
+        logStream() << "[DEFINE] " << currentEnv->getCompositeName(varKey) << " = " << valPtr->toString();
         if (valPtr->isNumber()) {
-            std::cout << " (Number)";
+            logStream() << " (Number)";
         }
         else if (valPtr->isString()) {
-            std::cout << " (String)";
+            logStream() << " (String)";
         }
         else if (valPtr->isBool()) {
-            std::cout << " (Boolean)";
+            logStream() << " (Boolean)";
         }
         else if (valPtr->isArray()) {
-            std::cout << " (Array)";
+            logStream() << " (Array)";
         }
         else if (valPtr->isDict()) {
-            std::cout << " (Dictionary)";
+            logStream() << " (Dictionary)";
         }
-        std::cout << "\n";
+        logStream() << "\n";
     } catch (const ReturnException&) {
         // Allow ReturnException to propagate
         throw;
@@ -941,7 +1255,7 @@ void Interpreter::interpretDefine(const DefineStatementNode& stmt) {
 void Interpreter::interpretAssignment(const AssignmentStatementNode& stmt) {
     // 1) Evaluate the RHS
     auto newVal = evaluateExpression(stmt.rhs.get(), currentEnv);
-    std::cout << " (Assignment RHS: " << newVal->toString() << "\n";
+    logStream() << " (Assignment RHS: " << newVal->toString() << "\n";
 
     // 2) Evaluate the LHS (determine its type and handle accordingly)
     switch (stmt.lhs->getExprType()) {
@@ -1003,30 +1317,30 @@ void Interpreter::interpretAssignment(const AssignmentStatementNode& stmt) {
     }
 
     // 3) Recalculate dirty variables, log the assignment, etc.
-    std::cout << "[ASSIGN] LHS=";
+    logStream() << "[ASSIGN] LHS=";
     switch (stmt.lhs->getExprType()) {
         case ExpressionStatementNodeType::Variable: {
             const auto& varNode = static_cast<const VariableExpressionStatementNode&>(*stmt.lhs);
             JTML::CompositeKey varKey = { currentEnv->instanceID, varNode.name };
-            std::cout << varKey.varName << " (InstanceID: " << varKey.instanceID << ")";
+            logStream() << varKey.varName << " (InstanceID: " << varKey.instanceID << ")";
             break;
         }
         case ExpressionStatementNodeType::ObjectPropertyAccess: {
             const auto& propNode = static_cast<const ObjectPropertyAccessExpressionNode&>(*stmt.lhs);
             JTML::CompositeKey propKey = { currentEnv->instanceID, propNode.propertyName };
-            std::cout << propKey.varName << " (InstanceID: " << propKey.instanceID << ")";
+            logStream() << propKey.varName << " (InstanceID: " << propKey.instanceID << ")";
             break;
         }
         case ExpressionStatementNodeType::Subscript: {
             const auto& subNode = static_cast<const SubscriptExpressionStatementNode&>(*stmt.lhs);
-            std::cout << subNode.toString();
+            logStream() << subNode.toString();
             break;
         }
         default:
-            std::cout << "Unknown LHS";
+            logStream() << "Unknown LHS";
             break;
     }
-    std::cout << " => RHS=" << newVal->toString() << "\n";
+    logStream() << " => RHS=" << newVal->toString() << "\n";
     currentEnv->recalcDirty([this](JTML::VarID varID) { 
                         updateVariable(varID, currentEnv); 
                     });
@@ -1035,11 +1349,15 @@ void Interpreter::interpretAssignment(const AssignmentStatementNode& stmt) {
 
 
 void Interpreter::interpretClassDeclaration(const ClassDeclarationNode& node) {
-    if (classDeclarations.find(node.name) != classDeclarations.end()) {
+    // Classes declared while a module executes live in that module's namespace
+    auto moduleIt = moduleClassDeclarations.find(currentEnv->instanceID);
+    auto& classTable = (moduleIt != moduleClassDeclarations.end()) ? moduleIt->second : classDeclarations;
+
+    if (classTable.find(node.name) != classTable.end()) {
         throw std::runtime_error("Class already defined: " + node.name);
     }
 
-    std::cout << "[DEBUG] Interpreting ClassDeclarationNode: " << node.toString() << "\n";
+    logStream() << "[DEBUG] Interpreting ClassDeclarationNode: " << node.toString() << "\n";
 
     // Move the members to the new class declaration
     auto membersCopy = std::vector<std::unique_ptr<ASTNode>>{};
@@ -1047,11 +1365,81 @@ void Interpreter::interpretClassDeclaration(const ClassDeclarationNode& node) {
         membersCopy.push_back(member->clone()); // Assuming `ASTNode` has a `clone` method
     }
 
-    classDeclarations[node.name] = std::make_shared<ClassDeclarationNode>(
+    classTable[node.name] = std::make_shared<ClassDeclarationNode>(
         node.name, node.parentName, std::move(membersCopy)
     );
 
-    std::cout << "Class '" << node.name << "' defined.\n";
+    logStream() << "Class '" << node.name << "' defined.\n";
+}
+
+// Look up a class visible from `env`: enclosing module namespaces first, then the page's classes
+std::shared_ptr<ClassDeclarationNode> Interpreter::findClassDeclaration(
+    const std::string& name, std::shared_ptr<JTML::Environment> env) const {
+    for (auto scope = env; scope; scope = scope->parent) {
+        auto moduleIt = moduleClassDeclarations.find(scope->instanceID);
+        if (moduleIt != moduleClassDeclarations.end()) {
+            auto classIt = moduleIt->second.find(name);
+            if (classIt != moduleIt->second.end()) {
+                return classIt->second;
+            }
+        }
+    }
+    auto classIt = classDeclarations.find(name);
+    return classIt != classDeclarations.end() ? classIt->second : nullptr;
+}
+
+void Interpreter::setModuleBaseDirectory(const std::string& dir) {
+    moduleBaseDir = dir.empty() ? "." : dir;
+}
+
+// import "path.jtml" as alias
+// Runs the module once per interpreter in its own environment and binds that
+// environment to `alias`, so members are reached as alias.fn(), alias.Class(), alias.var.
+void Interpreter::interpretImport(const ImportStatementNode& node) {
+    const std::string& baseDir = importStack.empty() ? moduleBaseDir : ModuleLoader::directoryOf(importStack.back());
+    const std::string path = ModuleLoader::resolve(node.modulePath, baseDir);
+
+    if (std::find(importStack.begin(), importStack.end(), path) != importStack.end()) {
+        throw std::runtime_error("Circular import of module '" + path + "'");
+    }
+
+    auto loadedIt = loadedModules.find(path);
+    if (loadedIt == loadedModules.end()) {
+        auto module = ModuleLoader::instance().load(path);
+        if (!module->errors.empty()) {
+            for (const auto& err : module->errors) {
+                handleError("In module '" + path + "': " + err);
+            }
+            throw std::runtime_error("Failed to compile module '" + path + "'");
+        }
+
+        auto moduleEnv = std::make_shared<JTML::Environment>(
+            globalEnv, JTML::InstanceIDGenerator::getNextID(), renderer.get());
+        moduleClassDeclarations[moduleEnv->instanceID];  // mark as a module namespace
+
+        logStream() << "[IMPORT] Executing module '" << path << "' (InstanceID: " << moduleEnv->instanceID << ")\n";
+        auto savedEnv = currentEnv;
+        currentEnv = moduleEnv;
+        importStack.push_back(path);
+        try {
+            for (const auto& stmt : module->program) {
+                interpretNode(*stmt);
+            }
+        } catch (...) {
+            importStack.pop_back();
+            currentEnv = savedEnv;
+            throw;
+        }
+        importStack.pop_back();
+        currentEnv = savedEnv;
+
+        loadedIt = loadedModules.emplace(path, LoadedModule{module, moduleEnv}).first;
+    }
+
+    JTML::ObjectHandle handle{loadedIt->second.env};
+    JTML::CompositeKey aliasKey = { currentEnv->instanceID, node.alias };
+    currentEnv->setVariable(aliasKey, std::make_shared<JTML::VarValue>(handle));
+    logStream() << "[IMPORT] " << node.alias << " => " << path << "\n";
 }
  void Interpreter::interpretDerive(const DeriveStatementNode& stmt) { 
         try {
@@ -1078,20 +1466,20 @@ void Interpreter::interpretClassDeclaration(const ClassDeclarationNode& node) {
             // Create JTML::CompositeKey for the variable
             JTML::CompositeKey key = { currentID, stmt.identifier };
 
-            std::cout << "[DEBUG] About to rum derive on " << currentEnv->getCompositeName(key) << " derived from dependencies: ";
+            logStream() << "[DEBUG] About to rum derive on " << currentEnv->getCompositeName(key) << " derived from dependencies: ";
             for (const auto& dep : deps) {
-                std::cout << currentEnv->getCompositeName(dep) << " ";
+                logStream() << currentEnv->getCompositeName(dep) << " ";
             }
-            std::cout << "\n";
+            logStream() << "\n";
 
             // Define or update the derived variable by calling Environment's method
             currentEnv->deriveVariable(key, std::move(newExpr), std::move(deps), evaluator);
 
-            std::cout << "[DERIVE] " << currentEnv->getCompositeName(key) << " derived from dependencies: ";
+            logStream() << "[DERIVE] " << currentEnv->getCompositeName(key) << " derived from dependencies: ";
             for (const auto& dep : deps) {
-                std::cout << dep.varName << " ";
+                logStream() << dep.varName << " ";
             }
-            std::cout << "\n";
+            logStream() << "\n";
 
         } catch (const std::exception& e) {
             handleError("Derive Statement Error: " + std::string(e.what()));
@@ -1116,7 +1504,7 @@ void Interpreter::interpretUnbind(const UnbindStatementNode& stmt) {
         currentEnv->unbindVariable(key);
 
         // Logging
-        std::cout << "[UNBIND] " << key.varName << " has been unbound from environment.\n";
+        logStream() << "[UNBIND] " << key.varName << " has been unbound from environment.\n";
     } catch (const std::exception& e) {
         handleError("Unbind Statement Error: " + std::string(e.what()));
     }
@@ -1125,7 +1513,7 @@ void Interpreter::interpretUnbind(const UnbindStatementNode& stmt) {
 void Interpreter::interpretStore(const StoreStatementNode& stmt) {
     try {
         storeVariable(stmt.targetScope, stmt.variableName);
-        std::cout << "[STORE] " << stmt.variableName << " => Scope: " << stmt.targetScope << "\n";
+        logStream() << "[STORE] " << stmt.variableName << " => Scope: " << stmt.targetScope << "\n";
     } catch (const ReturnException&) {
         // Allow ReturnException to propagate
         throw;
@@ -1137,7 +1525,7 @@ void Interpreter::interpretStore(const StoreStatementNode& stmt) {
 void Interpreter::interpretIf(const IfStatementNode& node) {
     try {
         bool conditionResult = evaluateCondition(node.condition.get(), currentEnv);
-        std::cout << "[IF] Condition evaluated to: " << (conditionResult ? "true" : "false") << "\n";
+        logStream() << "[IF] Condition evaluated to: " << (conditionResult ? "true" : "false") << "\n";
         if (conditionResult) {
             // "Truthy" condition
             for (const auto& stmt : node.thenStatements) {
@@ -1381,7 +1769,7 @@ void Interpreter::interpretThrow(const ThrowStatementNode& node) {
 }
 
 void Interpreter::interpretReturn(const ReturnStatementNode& node) {
-    std::cout << "[DEBUG] Interpreting ReturnStatementNode: " << node.toString() << "\n";
+    logStream() << "[DEBUG] Interpreting ReturnStatementNode: " << node.toString() << "\n";
 
     if (!inFunctionContext) {
         handleError("Return statement outside function context");
@@ -1394,7 +1782,7 @@ void Interpreter::interpretReturn(const ReturnStatementNode& node) {
 
         // Evaluate the return expression if it exists
         if (node.expr) {
-            std::cout << "[DEBUG] node.expr: " << node.expr->toString() << "\n";
+            logStream() << "[DEBUG] node.expr: " << node.expr->toString() << "\n";
             returnValue = evaluateExpression(node.expr.get(), currentEnv);
         } else {
             // Default return value: an empty string
@@ -1404,7 +1792,7 @@ void Interpreter::interpretReturn(const ReturnStatementNode& node) {
         }
 
         // Log the return value
-        std::cout << "[RETURN] " << (returnValue ? returnValue->toString() : "void") << "\n";
+        logStream() << "[RETURN] " << (returnValue ? returnValue->toString() : "void") << "\n";
         
         // Propagate the return value through a ReturnException
         throw ReturnException(returnValue);
@@ -1413,7 +1801,7 @@ void Interpreter::interpretReturn(const ReturnStatementNode& node) {
         // Explicitly allow ReturnException to propagate
         throw;
     } catch (const std::exception& e) {
-        std::cout << "[DEBUG] Function is not following ReturnException path! "<< "\n";
+        logStream() << "[DEBUG] Function is not following ReturnException path! "<< "\n";
         handleError("Return Statement Error: " + std::string(e.what()));
     }
 }
@@ -1447,14 +1835,16 @@ void Interpreter::interpretSubscribe(const SubscribeStatementNode& node) {
             auto reactiveArray = varValue->getArray();
             callback = [this, reactiveArray, func, key]() {
                 try {
+                    auto current = sessionValueOf(key);
+                    auto array = current && current->isArray() ? current->getArray() : reactiveArray;
                     // Iterate over the array and pass elements as arguments
                     std::vector<std::shared_ptr<JTML::VarValue>> args;
-                    for (const auto& elem : reactiveArray->getArrayData()) {
+                    for (const auto& elem : array->getArrayData()) {
                         args.push_back(elem);
                     }
                     executeFunction(func, args, nullptr);
                 } catch (const std::exception& e) {
-                    std::cerr << "[ERROR] Callback execution failed for function '"
+                    errorStream() << "[ERROR] Callback execution failed for function '"
                               << func->name << "': " << e.what() << "\n";
                 }
             };
@@ -1463,16 +1853,18 @@ void Interpreter::interpretSubscribe(const SubscribeStatementNode& node) {
             auto reactiveDict = varValue->getDict();
             callback = [this, reactiveDict, func, key]() {
                 try {
+                    auto current = sessionValueOf(key);
+                    auto dict = current && current->isDict() ? current->getDict() : reactiveDict;
                     // Iterate over the dict and pass key-value pairs as arguments
                     std::vector<std::shared_ptr<JTML::VarValue>> args;
-                    for (const auto& [k, v] : reactiveDict->getDictData()) {
+                    for (const auto& [k, v] : dict->getDictData()) {
                         // Optionally, create a struct or tuple to hold key-value
                         // For simplicity, we'll pass the value
                         args.push_back(v);
                     }
                     executeFunction(func, args, nullptr);
                 } catch (const std::exception& e) {
-                    std::cerr << "[ERROR] Callback execution failed for function '"
+                    errorStream() << "[ERROR] Callback execution failed for function '"
                               << func->name << "': " << e.what() << "\n";
                 }
             };
@@ -1485,7 +1877,7 @@ void Interpreter::interpretSubscribe(const SubscribeStatementNode& node) {
         // Subscribe the callback to the variable
         JTML::SubscriptionID subID = currentEnv->subscribeFunctionToVariable(key, node.functionName, callback);
 
-        std::cout << "[SUBSCRIBE] Function '" << node.functionName
+        logStream() << "[SUBSCRIBE] Function '" << node.functionName
                   << "' subscribed to variable '" << key.varName << "'\n";
     } catch (const std::exception& e) {
         handleError("Subscribe Statement Error: " + std::string(e.what()));
@@ -1504,7 +1896,7 @@ void Interpreter::interpretUnsubscribe(const UnsubscribeStatementNode& node) {
         // Unsubscribe the function from the variable
         currentEnv->unsubscribeFunctionFromVariable(key, funcName);
 
-        std::cout << "[UNSUBSCRIBE] Function '" << funcName
+        logStream() << "[UNSUBSCRIBE] Function '" << funcName
                   << "' unsubscribed from variable '" << node.variableName << "'\n";
     } catch (const std::exception& e) {
         handleError("Unsubscribe Statement Error: " + std::string(e.what()));
@@ -1513,7 +1905,7 @@ void Interpreter::interpretUnsubscribe(const UnsubscribeStatementNode& node) {
 
 void Interpreter::interpretFunctionDeclaration(const FunctionDeclarationNode& decl)
 {   
-    std::cout << "[DEBUG] Interpreting FunctionDeclarationNode: " << decl.toString() << "\n";
+    logStream() << "[DEBUG] Interpreting FunctionDeclarationNode: " << decl.toString() << "\n";
     // 1) Clone body for safe storage in the new function
     std::vector<std::unique_ptr<ASTNode>> clonedBody;
     clonedBody.reserve(decl.body.size());
@@ -1534,12 +1926,12 @@ void Interpreter::interpretFunctionDeclaration(const FunctionDeclarationNode& de
     JTML::CompositeKey funcKey = { currentEnv->instanceID, decl.name };
     currentEnv->defineFunction(funcKey, newFunc);
 
-    std::cout << "[DEBUG] Defined function '" << decl.name << "' with ";
-    std::cout << decl.parameters.size() << " parameters:\n"; 
+    logStream() << "[DEBUG] Defined function '" << decl.name << "' with ";
+    logStream() << decl.parameters.size() << " parameters:\n"; 
     for (const auto& stmt :newFunc->body) {
-        std::cout << stmt->toString() << ", ";
+        logStream() << stmt->toString() << ", ";
     }
-    std::cout << "returning " << (decl.returnType) << "\n";
+    logStream() << "returning " << (decl.returnType) << "\n";
               
 
     // 4) For *nested* function declarations in the body, define them too
@@ -1636,18 +2028,22 @@ std::shared_ptr<JTML::VarValue> Interpreter::executeFunction(
     bool previousContext = inFunctionContext;
     inFunctionContext = true;
 
-    // Limit Recursion Depth
-    static std::mutex recursionMutex;
-    std::lock_guard<std::mutex> lock(recursionMutex);
-    static int recursionDepth = 0;
+    // Limit Recursion Depth (per interpreter; the guard unwinds it however
+    // the call ends)
     const int MAX_RECURSION_DEPTH = 1000;
-    if (++recursionDepth > MAX_RECURSION_DEPTH) {
+    if (callDepth >= MAX_RECURSION_DEPTH) {
+        inFunctionContext = previousContext;
         throw std::runtime_error("Maximum recursion depth exceeded in function '" + func->name + "'");
     }
+    struct CallDepthGuard {
+        int& depth;
+        explicit CallDepthGuard(int& d) : depth(++d) {}
+        ~CallDepthGuard() { --depth; }
+    } depthGuard(callDepth);
 
     // Create a new environment for the function execution
     auto funcEnv = std::make_shared<JTML::Environment>(
-        func->closure, // Parent environment (closure)
+        closureOf(*func), // Parent environment (closure)
         JTML::InstanceIDGenerator::getNextID(),
         currentEnv->renderer
     ); // Closure for accessing outer variables
@@ -1668,10 +2064,10 @@ std::shared_ptr<JTML::VarValue> Interpreter::executeFunction(
     }
     
     // Debug: Print function environment variables
-    std::cout << "[DEBUG] Function '" << func->name << "' environment (InstanceID: " 
+    logStream() << "[DEBUG] Function '" << func->name << "' environment (InstanceID: " 
               << funcEnv->instanceID << ") variables:\n";
     for (const auto& [key, varInfo] : funcEnv->variables) {
-        std::cout << "  " << funcEnv->getCompositeName(key) << " = " 
+        logStream() << "  " << funcEnv->getCompositeName(key) << " = " 
                   << (varInfo->currentValue ? varInfo->currentValue->toString() : "undefined") 
                   << "\n";
     }
@@ -1682,12 +2078,12 @@ std::shared_ptr<JTML::VarValue> Interpreter::executeFunction(
     try {
         // Interpret each statement in the function body
         for (const auto& stmt : func->body) {
-            std::cout << "[DEBUG] Executing statement in function '" << func->name << "': " 
+            logStream() << "[DEBUG] Executing statement in function '" << func->name << "': " 
                       << stmt->toString() << "\n";
             interpretNode(*stmt);
         }
     } catch (const ReturnException& re) {
-        std::cout << "[DEBUG] Function '" << func->name << "' returned with value: " 
+        logStream() << "[DEBUG] Function '" << func->name << "' returned with value: " 
                   << re.value->toString() << "\n";
         returnValue = re.value;
     } catch (const std::exception& e) {
@@ -1702,15 +2098,13 @@ std::shared_ptr<JTML::VarValue> Interpreter::executeFunction(
     inFunctionContext = previousContext;
 
     // Debug: Print parent environment variables
-    std::cout << "[DEBUG] Parent environment variables after function execution:\n";
+    logStream() << "[DEBUG] Parent environment variables after function execution:\n";
     for (const auto& [key, varInfo] : currentEnv->variables) {
-        std::cout << "  " << currentEnv->getCompositeName(key) << " = " 
+        logStream() << "  " << currentEnv->getCompositeName(key) << " = " 
                   << (varInfo->currentValue ? varInfo->currentValue->toString() : "undefined") 
                   << "\n";
     }
 
-    --recursionDepth;
-
     // If no return statement, return a default value
     if (!returnValue) {
         return std::make_shared<JTML::VarValue>(JTML::ValueVariant{""});
@@ -1723,7 +2117,7 @@ std::shared_ptr<JTML::VarValue> Interpreter::executeFunction(
 void Interpreter::storeVariable(const std::string& scope, const std::string& varName) {
     // Placeholder implementation
     // Depending on your scope management, implement storing logic here
-    std::cout << "[STORE] Variable '" << varName << "' stored to scope '" << scope << "'.\n";
+    logStream() << "[STORE] Variable '" << varName << "' stored to scope '" << scope << "'.\n";
 }
 
 std::shared_ptr<JTML::VarValue> Interpreter::instantiateClass(
@@ -1883,7 +2277,7 @@ std::shared_ptr<JTML::VarValue> Interpreter::evaluateExpression(const Expression
                     // For demonstration, let's coerce to string:
                     std::string ls = leftVal->toString();
                     std::string rs = rightVal->toString();
-                    std::cout << "Comparing variables of different types!"<< ls << " "<< rs << "\n";
+                    logStream() << "Comparing variables of different types!"<< ls << " "<< rs << "\n";
                     return std::make_shared<JTML::VarValue>(JTML::ValueVariant{ performStringCompare(op, ls, rs)} );
                 }
             }
@@ -1929,6 +2323,13 @@ std::shared_ptr<JTML::VarValue> Interpreter::evaluateExpression(const Expression
 
                 return std::make_shared<JTML::VarValue>(result);
             }
+            // (C) Exponentiation
+            else if (op == "^") {
+                if (!leftVal->isNumber() || !rightVal->isNumber()) {
+                    throw std::runtime_error("Arithmetic operators require numeric types");
+                }
+                return std::make_shared<JTML::VarValue>(std::pow(leftVal->getNumber(), rightVal->getNumber()));
+            }
             // If we get here => unrecognized op
             throw std::runtime_error("Unsupported binary operator: " + op);
         }
@@ -1946,7 +2347,7 @@ std::shared_ptr<JTML::VarValue> Interpreter::evaluateExpression(const Expression
             else if (op == "-") {
                 // numeric negation => warn or try convert
                 if (!operandVal->isNumber()) {
-                    std::cerr << "[Warning] Using unary '-' on a non-numeric value.\n";
+                    errorStream() << "[Warning] Using unary '-' on a non-numeric value.\n";
                 }
                 double num = 0.0;
                 try {
@@ -1968,7 +2369,7 @@ std::shared_ptr<JTML::VarValue> Interpreter::evaluateExpression(const Expression
             JTML::CompositeKey varKey = { env->instanceID, varExpr->name };
             auto varVal = env->getVariable(varKey);
        
-            std::cout << "[EVAL] Variable " << env->getCompositeName(varKey) << " (InstanceID: " << varKey.instanceID 
+            logStream() << "[EVAL] Variable " << env->getCompositeName(varKey) << " (InstanceID: " << varKey.instanceID 
                       << ") = " << varVal->toString() << "\n";
 
             // Check if the variable is dirty and needs to be updated
@@ -2086,13 +2487,12 @@ std::shared_ptr<JTML::VarValue> Interpreter::evaluateExpression(const Expression
             const auto* callExpr = static_cast<const FunctionCallExpressionStatementNode*>(exprNode);
 
             // Check if the function name corresponds to a class for instantiation
-            auto classIt = classDeclarations.find(callExpr->functionName);
-            if (classIt != classDeclarations.end()) {
+            if (auto classDecl = findClassDeclaration(callExpr->functionName, env)) {
                 // Instantiate the class
-                return instantiateClass(*classIt->second, callExpr->arguments, env);
+                return instantiateClass(*classDecl, callExpr->arguments, env);
             }
 
-            std::cout << "Function call: " << callExpr->toString() << "\n";
+            logStream() << "Function call: " << callExpr->toString() << "\n";
 
             if (!callExpr) {
                 throw std::runtime_error("FunctionCallExpressionStatementNode is null.");
@@ -2116,28 +2516,28 @@ std::shared_ptr<JTML::VarValue> Interpreter::evaluateExpression(const Expression
             }
 
             // Debug logging
-            std::cout << "[DEBUG] Calling function: " << func->name << "\n";
+            logStream() << "[DEBUG] Calling function: " << func->name << "\n";
             for (const auto& arg : args) {
-                std::cout << "[DEBUG] Argument value: " << (arg ? arg->toString() : "null") << "\n";
+                logStream() << "[DEBUG] Argument value: " << (arg ? arg->toString() : "null") << "\n";
             }
 
             // Display function body for debugging
             for (const auto& stmt : func->body) {
-                std::cout << "[DEBUG] Body of function " << func->name << " value: " << stmt->toString() << "\n";
+                logStream() << "[DEBUG] Body of function " << func->name << " value: " << stmt->toString() << "\n";
             }
 
             // Display current environment variables
-            std::cout << "[DEBUG] Current environment before function call:\n";
+            logStream() << "[DEBUG] Current environment before function call:\n";
             for (const auto& [key, varInfo] : env->variables) {
-                std::cout << "  " << env->getCompositeName(key) << " = " 
+                logStream() << "  " << env->getCompositeName(key) << " = " 
                           << (varInfo->currentValue ? varInfo->currentValue->toString() : "undefined") 
                           << "\n";
             }
 
             // Display closure environment variables
-            std::cout << "[DEBUG] Closure for function " << func->name << ":\n";
+            logStream() << "[DEBUG] Closure for function " << func->name << ":\n";
             for (const auto& [key, varInfo] : func->closure->variables) {
-                std::cout << "  " << env->getCompositeName(key) << " = " 
+                logStream() << "  " << env->getCompositeName(key) << " = " 
                           << (varInfo->currentValue ? varInfo->currentValue->toString() : "undefined") 
                           << "\n";
             }
@@ -2169,7 +2569,7 @@ std::shared_ptr<JTML::VarValue> Interpreter::evaluateExpression(const Expression
                 throw std::runtime_error("Property '" + propAccess->propertyName + "' not found in object.");
             }
 
-            std::cout << "[EVAL] Accessing property '" << propKey.varName << "' (InstanceID: " << propKey.instanceID 
+            logStream() << "[EVAL] Accessing property '" << propKey.varName << "' (InstanceID: " << propKey.instanceID 
                       << ") = " << propertyVal->toString() << "\n";
 
             return propertyVal;
@@ -2224,6 +2624,16 @@ std::shared_ptr<JTML::VarValue> Interpreter::evaluateExpression(const Expression
 
             // Retrieve the method from the object's environment
             auto objHandle = baseVal->getObjectHandle();
+
+            // module.Class(...) instantiates a class from an imported module's namespace
+            auto moduleIt = moduleClassDeclarations.find(objHandle.instanceEnv->instanceID);
+            if (moduleIt != moduleClassDeclarations.end()) {
+                auto classIt = moduleIt->second.find(methodCall->methodName);
+                if (classIt != moduleIt->second.end()) {
+                    return instantiateClass(*classIt->second, methodCall->arguments, env);
+                }
+            }
+
             JTML::CompositeKey methodKey = { objHandle.instanceEnv->instanceID, methodCall->methodName };
             auto methodFunc = objHandle.instanceEnv->getFunction(methodKey);
 
@@ -2240,7 +2650,7 @@ std::shared_ptr<JTML::VarValue> Interpreter::evaluateExpression(const Expression
             // Execute the method with 'this' bound to the object
             std::shared_ptr<JTML::VarValue> returnValue = executeFunction(methodFunc, args, baseVal);
 
-            std::cout << "[EVAL] Executed method '" << methodCall->methodName << "' on object (InstanceID: " 
+            logStream() << "[EVAL] Executed method '" << methodCall->methodName << "' on object (InstanceID: " 
                       << objHandle.instanceEnv->instanceID << ")\n";
 
             return returnValue;
@@ -2297,7 +2707,7 @@ void Interpreter::gatherDeps(
 ) {
     if (!exprNode) return;
 
-    std::cout << "[DEBUG 0] gatherDeps Element: <" << exprNode->toString() << ">\n";
+    logStream() << "[DEBUG 0] gatherDeps Element: <" << exprNode->toString() << ">\n";
 
     switch (exprNode->getExprType()) {
         case ExpressionStatementNodeType::Variable: {
@@ -2312,7 +2722,7 @@ void Interpreter::gatherDeps(
 
                 // Add the variable itself as a dependency
                 out.push_back(varKey);
-                std::cout << "[GATHER_DEPS] Dependency found: " 
+                logStream() << "[GATHER_DEPS] Dependency found: " 
                           << env->getCompositeName(varKey) << "\n";
 
                 // Determine the VarKind and gather additional dependencies accordingly
@@ -2398,7 +2808,7 @@ void Interpreter::gatherDeps(
                 const auto* varNode = static_cast<const VariableExpressionStatementNode*>(sub->base.get());
                 JTML::CompositeKey fullArrayKey = { env->instanceID, varNode->name };
                 out.emplace_back(fullArrayKey);
-                std::cout << "[GATHER_DEPS] Dependency found: " 
+                logStream() << "[GATHER_DEPS] Dependency found: " 
                           << env->getCompositeName(fullArrayKey) << "\n";
 
                 // Specific element dependency
@@ -2416,7 +2826,7 @@ void Interpreter::gatherDeps(
                 }
                 JTML::CompositeKey specificKey = { env->instanceID, specificName };
                 out.emplace_back(specificKey);
-                std::cout << "[GATHER_DEPS] Specific Subscript Dependency added: " 
+                logStream() << "[GATHER_DEPS] Specific Subscript Dependency added: " 
                           << env->getCompositeName(specificKey) << "\n";
             }
             break;
@@ -2444,27 +2854,28 @@ void Interpreter::recalcDirty(std::shared_ptr<JTML::Environment> env) {
 
 void Interpreter::updateVariable(JTML::VarID varID, std::shared_ptr<JTML::Environment> env) {
    
-    JTML::CompositeKey key = env->idToKey[varID];
-    auto it = env->variables.find(key);
-    if (it == env->variables.end()) {
+    JTML::CompositeKey key = env->graph().idToKey[varID];
+    auto info = env->findVariable(key);
+    if (!info) {
         handleError("Attempted to update undefined variable '" + env->getCompositeName(key) + 
             "' in InstanceID " + std::to_string(env->instanceID));
         return;
     }
 
-    if (it->second->kind == JTML::VarKind::Derived && it->second->expression) {
+    if (info->kind == JTML::VarKind::Derived && info->expression) {
         try {
-            std::shared_ptr<JTML::VarValue> newValue = evaluateExpression(it->second->expression.get(), env);
-            std::cout << "[UPDATE] Evaluated " << key.varName << " = " << newValue->toString() << "\n";
-            if (getStringValue(newValue) != getStringValue(it->second->currentValue)) {
-                it->second->currentValue = newValue;
-                std::cout << "[UPDATE] " << key.varName << " updated to " << newValue->toString() << "\n";
+            std::shared_ptr<JTML::VarValue> newValue = evaluateExpression(info->expression.get(), env);
+            logStream() << "[UPDATE] Evaluated " << key.varName << " = " << newValue->toString() << "\n";
+            if (getStringValue(newValue) != getStringValue(info->currentValue)) {
+                // A session keeps the new value to itself
+                env->ownVariable(key, false)->currentValue = newValue;
+                logStream() << "[UPDATE] " << key.varName << " updated to " << newValue->toString() << "\n";
                 // Emit events
                 env->emitEvents(varID);
                 // Notify dependents by marking them dirty
-                for (const auto& dependentVarID : env->adjacency[varID]) {
-                    std::cout << "[UPDATE] marking dirty variable dependent on" << key.varName << " name " << dependentVarID << "\n";
-                    JTML::CompositeKey dependentKey = env->idToKey[dependentVarID];
+                for (const auto& dependentVarID : env->graph().adjacency[varID]) {
+                    logStream() << "[UPDATE] marking dirty variable dependent on" << key.varName << " name " << dependentVarID << "\n";
+                    JTML::CompositeKey dependentKey = env->graph().idToKey[dependentVarID];
                     env->markDirty(dependentKey);
                 }
             }
@@ -2474,7 +2885,7 @@ void Interpreter::updateVariable(JTML::VarID varID, std::shared_ptr<JTML::Enviro
         }
     }
     else {
-        std::cout << "[SKIP] Normal variable '" << key.varName << "' does not require updates.\n";
+        logStream() << "[SKIP] Normal variable '" << key.varName << "' does not require updates.\n";
     }
     // Normal variables do not require updates
 }
@@ -2548,7 +2959,7 @@ std::string Interpreter::getStringValue(const std::shared_ptr<JTML::VarValue>& v
 
 // Handle and report errors
 void Interpreter::handleError(const std::string& message) {
-    std::cerr << "Interpreter Error: " << message << "\n";
+    errorStream() << "Interpreter Error: " << message << "\n";
     // Depending on requirements, you might throw exceptions or handle errors differently
 }
 
@@ -2565,6 +2976,7 @@ std::string toString(ASTNodeType nodeType) {
         case ASTNodeType::ExpressionStatement: return "ExpressionStatement";
         case ASTNodeType::FunctionDeclaration: return "FunctionDeclaration";
         case ASTNodeType::ClassDeclaration: return "ClassDeclaration";
+        case ASTNodeType::ImportStatement: return "ImportStatement";
         case ASTNodeType::ReturnStatement: return "ReturnStatement";
         case ASTNodeType::BreakStatement: return "BreakStatement";
         case ASTNodeType::ContinueStatement: return "ContinueStatement";
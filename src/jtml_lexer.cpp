@@ -192,13 +192,20 @@ std::string tokenTypeToString(TokenType type) {
 
 // ------------------- Lexer Class Implementations -------------------
 
-Lexer::Lexer(const std::string& input)
+Lexer::Lexer(std::string_view input)
     : m_input(input), m_pos(0), m_line(1), m_column(1) {}
 
 // Tokenize the input string and return a vector of tokens
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
-    
+    do {
+        tokens.push_back(nextToken());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
+    return tokens;
+}
+
+// Scan and return the next token; END_OF_FILE is returned once input is exhausted
+Token Lexer::nextToken() {
     while (!isEOF()) {
         
         char c = peek();
@@ -208,171 +215,190 @@ std::vector<Token> Lexer::tokenize() {
         }
 
         if (matchSequence("\\\\")) {
-            tokens.push_back(makeToken(TokenType::STMT_TERMINATOR, "\\\\"));
+            Token tk = makeToken(TokenType::STMT_TERMINATOR, "\\\\");
             m_pos += 2;
-            continue;
+            return tk;
         }
       
         if (matchSequence("\\#")) {
-            tokens.push_back(makeToken(TokenType::BACKSLASH_HASH, "\\#"));
+            Token tk = makeToken(TokenType::BACKSLASH_HASH, "\\#");
             m_pos += 2;
-            continue;
+            return tk;
         }
 
         // Multi-character operators
         if (matchSequence("-=")) {
-            tokens.push_back(makeToken(TokenType::MINUSEQ, "-="));
+            Token tk = makeToken(TokenType::MINUSEQ, "-=");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("+=")) {
-            tokens.push_back(makeToken(TokenType::PLUSEQ, "+="));
+            Token tk = makeToken(TokenType::PLUSEQ, "+=");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("*=")) {
-            tokens.push_back(makeToken(TokenType::MULTIPLYEQ, "*="));
+            Token tk = makeToken(TokenType::MULTIPLYEQ, "*=");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("/=")) {
-            tokens.push_back(makeToken(TokenType::DIVIDEEQ, "/="));
+            Token tk = makeToken(TokenType::DIVIDEEQ, "/=");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("%=")) {
-            tokens.push_back(makeToken(TokenType::MODULUSEQ, "%="));
+            Token tk = makeToken(TokenType::MODULUSEQ, "%=");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("^=")) {
-            tokens.push_back(makeToken(TokenType::POWEREQ, "^="));
+            Token tk = makeToken(TokenType::POWEREQ, "^=");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("==")) {
-            tokens.push_back(makeToken(TokenType::EQ, "=="));
+            Token tk = makeToken(TokenType::EQ, "==");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("<=")) {
-            tokens.push_back(makeToken(TokenType::LTEQ, "<="));
+            Token tk = makeToken(TokenType::LTEQ, "<=");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence(">=")) {
-            tokens.push_back(makeToken(TokenType::GTEQ, ">="));
+            Token tk = makeToken(TokenType::GTEQ, ">=");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("!=")) {
-            tokens.push_back(makeToken(TokenType::NEQ, "!="));
+            Token tk = makeToken(TokenType::NEQ, "!=");
             m_pos += 2;
-            continue;
+            return tk;
         }
 
         if (matchSequence("&&")) {
-            tokens.push_back(makeToken(TokenType::AND, "&&"));
+            Token tk = makeToken(TokenType::AND, "&&");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("||")) {
-            tokens.push_back(makeToken(TokenType::OR, "||"));
+            Token tk = makeToken(TokenType::OR, "||");
             m_pos += 2;
-            continue;
+            return tk;
         }
         if (matchSequence("..")) {
-            tokens.push_back(makeToken(TokenType::DOTS, ".."));
+            Token tk = makeToken(TokenType::DOTS, "..");
             m_pos += 2;
-            continue;
+            return tk;
         }
   
         // Single-character tokens
         switch (c) {
-            case '#':
-                tokens.push_back(makeToken(TokenType::HASH, "#"));
+            case '#': {
+                Token tk = makeToken(TokenType::HASH, "#");
                 advance();
-                break;
-            case '(':
-                tokens.push_back(makeToken(TokenType::LPAREN, "("));
+                return tk;
+            }
+            case '(': {
+                Token tk = makeToken(TokenType::LPAREN, "(");
                 advance();
-                break;
-            case ')':
-                tokens.push_back(makeToken(TokenType::RPAREN, ")"));
+                return tk;
+            }
+            case ')': {
+                Token tk = makeToken(TokenType::RPAREN, ")");
                 advance();
-                break;
-            case '[':
-                tokens.push_back(makeToken(TokenType::LBRACKET, "["));
+                return tk;
+            }
+            case '[': {
+                Token tk = makeToken(TokenType::LBRACKET, "[");
                 advance();
-                break;
-            case ']':
-                tokens.push_back(makeToken(TokenType::RBRACKET, "]"));
+                return tk;
+            }
+            case ']': {
+                Token tk = makeToken(TokenType::RBRACKET, "]");
                 advance();
-                break;
-            case '{':
-                tokens.push_back(makeToken(TokenType::LBRACE, "{"));
+                return tk;
+            }
+            case '{': {
+                Token tk = makeToken(TokenType::LBRACE, "{");
                 advance();
-                break;
-            case '}':
-                tokens.push_back(makeToken(TokenType::RBRACE, "}"));
+                return tk;
+            }
+            case '}': {
+                Token tk = makeToken(TokenType::RBRACE, "}");
                 advance();
-                break;
-            case '+':
-                tokens.push_back(makeToken(TokenType::PLUS, "+"));
+                return tk;
+            }
+            case '+': {
+                Token tk = makeToken(TokenType::PLUS, "+");
                 advance();
-                break;
-            case '*':
-                tokens.push_back(makeToken(TokenType::MULTIPLY, "*"));
+                return tk;
+            }
+            case '*': {
+                Token tk = makeToken(TokenType::MULTIPLY, "*");
                 advance();
-                break;
-            case '-':
-                tokens.push_back(makeToken(TokenType::MINUS, "-"));
+                return tk;
+            }
+            case '-': {
+                Token tk = makeToken(TokenType::MINUS, "-");
                 advance();
-                break;
-            case '/':
-                tokens.push_back(makeToken(TokenType::DIVIDE, "/"));
+                return tk;
+            }
+            case '/': {
+                Token tk = makeToken(TokenType::DIVIDE, "/");
                 advance();
-                break;
-            case '%':
-                tokens.push_back(makeToken(TokenType::MODULUS, "%"));
+                return tk;
+            }
+            case '%': {
+                Token tk = makeToken(TokenType::MODULUS, "%");
                 advance();
-                break;
-            case '^':
-                tokens.push_back(makeToken(TokenType::POWER, "^"));
+                return tk;
+            }
+            case '^': {
+                Token tk = makeToken(TokenType::POWER, "^");
                 advance();
-                break;
-            case '<':
-                tokens.push_back(makeToken(TokenType::LT, "<"));
+                return tk;
+            }
+            case '<': {
+                Token tk = makeToken(TokenType::LT, "<");
                 advance();
-                break;
-            case '>':
-                tokens.push_back(makeToken(TokenType::GT, ">"));
+                return tk;
+            }
+            case '>': {
+                Token tk = makeToken(TokenType::GT, ">");
                 advance();
-                break;
-            case '!':
-                tokens.push_back(makeToken(TokenType::NOT, "!"));
+                return tk;
+            }
+            case '!': {
+                Token tk = makeToken(TokenType::NOT, "!");
                 advance();
-                break;
-            case ',':
-                tokens.push_back(makeToken(TokenType::COMMA, ","));
+                return tk;
+            }
+            case ',': {
+                Token tk = makeToken(TokenType::COMMA, ",");
                 advance();
-                break;
-            case ':':
-                tokens.push_back(makeToken(TokenType::COLON, ":"));
+                return tk;
+            }
+            case ':': {
+                Token tk = makeToken(TokenType::COLON, ":");
                 advance();
-                break;
-            case '.':
-                tokens.push_back(makeToken(TokenType::DOT, "."));
+                return tk;
+            }
+            case '.': {
+                Token tk = makeToken(TokenType::DOT, ".");
                 advance();
-                break;
-            case '=':
-                tokens.push_back(makeToken(TokenType::ASSIGN, "="));
+                return tk;
+            }
+            case '=': {
+                Token tk = makeToken(TokenType::ASSIGN, "=");
                 advance();
-                break;
+                return tk;
+            }
             case '"':
             case '\'':
-                tokens.push_back(consumeStringLiteral(c));
-                break;
+                return consumeStringLiteral(c);
             default:
                 if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
                     Token tk = consumeIdentifier();
@@ -408,11 +434,9 @@ std::vector<Token> Lexer::tokenize() {
                     if (tk.text == "async") tk.type = TokenType::ASYNC;
                     if (tk.text == "import") tk.type = TokenType::IMPORT;
                     if (tk.text == "main") tk.type = TokenType::MAIN;
-                    tokens.push_back(tk);
+                    return tk;
                 } else if (std::isdigit(static_cast<unsigned char>(c))) {
-                    Token tk = consumeNumber();
-                    tokens.push_back(tk);
-                    continue;
+                    return consumeNumber();
                 }
                 else {
                     errors.emplace_back("Error at line " + 
@@ -422,8 +446,7 @@ std::vector<Token> Lexer::tokenize() {
                 }
         }
     }
-    tokens.push_back(Token{TokenType::END_OF_FILE, "<EOF>", static_cast<int>(m_pos), m_line, m_column});
-    return tokens;
+    return Token{TokenType::END_OF_FILE, "<EOF>", static_cast<int>(m_pos), m_line, m_column};
 }
 
 // Retrieve any errors encountered during tokenization
@@ -542,7 +565,7 @@ Token Lexer::consumeNumber() {
     }
 
     size_t length = m_pos - startPos;
-    std::string value = m_input.substr(startPos, length);
+    std::string value(m_input.substr(startPos, length));
 
     // Return the token for the number literal
     return Token{
@@ -563,7 +586,7 @@ Token Lexer::consumeIdentifier() {
     while (std::isalnum(static_cast<unsigned char>(peek())) || peek() == '_') {
         advance();
     }
-    std::string value = m_input.substr(start, m_pos - start);
+    std::string value(m_input.substr(start, m_pos - start));
 
     if (value == "true" || value == "false") {
         return Token{TokenType::BOOLEAN_LITERAL, value, static_cast<int>(start), startLine, startColumn};
@@ -571,3 +594,42 @@ Token Lexer::consumeIdentifier() {
 
     return Token{TokenType::IDENTIFIER, value, static_cast<int>(start), startLine, startColumn};
 }
+
+// ------------------- TokenStream Implementations -------------------
+
+TokenStream::TokenStream(std::vector<Token> tokens)
+    : m_tokens(std::move(tokens)), m_lexer(nullptr), m_pulled(0), m_reachedEnd(true),
+      m_eofToken{TokenType::END_OF_FILE, "<EOF>", 0, 1, 1} {
+    if (!m_tokens.empty() && m_tokens.back().type == TokenType::END_OF_FILE) {
+        m_eofToken = m_tokens.back();
+    }
+}
+
+TokenStream::TokenStream(Lexer& lexer)
+    : m_lexer(&lexer), m_pulled(0), m_reachedEnd(false),
+      m_eofToken{TokenType::END_OF_FILE, "<EOF>", 0, 1, 1} {}
+
+const Token& TokenStream::operator[](size_t index) const {
+    if (!m_lexer) {
+        return index < m_tokens.size() ? m_tokens[index] : m_eofToken;
+    }
+
+    // Pull from the lexer until the requested token is buffered
+    while (index >= m_pulled && !m_reachedEnd) {
+        Token tk = m_lexer->nextToken();
+        if (tk.type == TokenType::END_OF_FILE) {
+            m_eofToken = tk;
+            m_reachedEnd = true;
+        }
+        m_ring[m_pulled & (RING_SIZE - 1)] = std::move(tk);
+        ++m_pulled;
+    }
+    if (index >= m_pulled) {
+        return m_eofToken;
+    }
+    if (index + RING_SIZE < m_pulled) {
+        throw std::runtime_error("Token " + std::to_string(index) +
+            " is no longer buffered (parser lookbehind exceeds token window)");
+    }
+    return m_ring[index & (RING_SIZE - 1)];
+}
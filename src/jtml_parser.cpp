@@ -1,11 +1,15 @@
 // jtml_parser.cpp
 #include "../include/jtml_parser.h"
 
+#include <array>
+
 // ------------------- Parser Class Implementations -------------------
-std::vector<std::string> loopContextStack; 
 Parser::Parser(std::vector<Token> tokens)
     : m_tokens(std::move(tokens)), m_pos(0), m_line(1), m_column(1) {}
 
+Parser::Parser(Lexer& lexer)
+    : m_tokens(lexer), m_pos(0), m_line(1), m_column(1) {}
+
 // Parses the entire program and returns a vector of AST nodes
 std::vector<std::unique_ptr<ASTNode>> Parser::parseProgram() {
     std::vector<std::unique_ptr<ASTNode>> nodes;
@@ -24,6 +28,8 @@ std::vector<std::unique_ptr<ASTNode>> Parser::parseProgram() {
         } catch (const std::runtime_error& e) {
             std::cout << "[ERROR] " << e.what() << " at token position: " << m_pos << "\n";
             recordError(e.what());
+            // A loop the error cut short never popped its entry
+            m_loopContextStack.clear();
             synchronize();
         }
     }
@@ -55,6 +61,10 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
         std::cout << "[DEBUG] Found 'store' statement.\n";
         return parseStoreStatement();
     }
+    if (check(TokenType::IMPORT)) {
+        std::cout << "[DEBUG] Found 'import' statement.\n";
+        return parseImportStatement();
+    }
     if (check(TokenType::IF)) {
         std::cout << "[DEBUG] Found 'if' statement.\n";
         return parseIfElseStatement();
@@ -306,6 +316,32 @@ std::unique_ptr<ASTNode> Parser::parseUnbindStatement() {
     return node;
 }
 
+// Parses an import statement (e.g., 'import "widgets.jtml" as ui\\')
+std::unique_ptr<ASTNode> Parser::parseImportStatement() {
+    consume(TokenType::IMPORT, "Expected 'import'");
+    Token pathTok = consume(TokenType::STRING_LITERAL, "Expected module path string after 'import'");
+
+    auto node = std::make_unique<ImportStatementNode>();
+    node->modulePath = pathTok.text;
+
+    // Optional 'as <alias>' ('as' is not a reserved word)
+    if (check(TokenType::IDENTIFIER) && peek().text == "as") {
+        advance();
+        Token aliasTok = consume(TokenType::IDENTIFIER, "Expected module alias after 'as'");
+        node->alias = aliasTok.text;
+    } else {
+        // Default alias: file stem ("ui/widgets.jtml" -> "widgets")
+        std::string stem = node->modulePath;
+        auto slash = stem.find_last_of("/\\");
+        if (slash != std::string::npos) stem = stem.substr(slash + 1);
+        auto dot = stem.find('.');
+        if (dot != std::string::npos) stem = stem.substr(0, dot);
+        node->alias = stem;
+    }
+    consume(TokenType::STMT_TERMINATOR, "Expected '\\\\' after import statement");
+    return node;
+}
+
 // Parses a store statement (e.g., 'store(main) a\\')
 std::unique_ptr<ASTNode> Parser::parseStoreStatement() {
     consume(TokenType::STORE, "Expected 'store' keyword");
@@ -376,10 +412,12 @@ std::unique_ptr<JtmlElementNode> Parser::parseJtmlElement() {
         std::vector<JtmlAttribute> attributes;      
         while (check(TokenType::IDENTIFIER)) {
             Token attrName = consume(TokenType::IDENTIFIER, "Expected attribute name.");
+            EventPolicy policy = parseEventPolicy(attrName.text);
 
             consume(TokenType::ASSIGN, "Expected '=' after attribute name.");
             auto exprNode = parseExpression();
             attributes.push_back({attrName.text, std::move(exprNode)});
+            attributes.back().policy = policy;
                   
             // Handle optional commas between attributes
             if (!check(TokenType::COMMA)) {
@@ -414,6 +452,41 @@ std::unique_ptr<JtmlElementNode> Parser::parseJtmlElement() {
     
 }
 
+// Parses an optional event modifier after an attribute name:
+// '.coalesce', '.throttle(<per second>)' or '.debounce(<ms>)'
+EventPolicy Parser::parseEventPolicy(const std::string& attrName) {
+    EventPolicy policy;
+    if (!check(TokenType::DOT)) {
+        return policy;
+    }
+    advance(); // Consume '.'
+    Token modifier = consume(TokenType::IDENTIFIER, "Expected event modifier after '.'");
+    if (attrName.rfind("on", 0) != 0) {
+        throw std::runtime_error("Modifier '" + modifier.text + "' on '" + attrName + "', which is not an event attribute");
+    }
+
+    if (modifier.text == "coalesce") {
+        policy.kind = EventPolicy::Kind::Coalesce;
+        return policy;
+    }
+    if (modifier.text == "throttle") {
+        policy.kind = EventPolicy::Kind::Throttle;
+    } else if (modifier.text == "debounce") {
+        policy.kind = EventPolicy::Kind::Debounce;
+    } else {
+        throw std::runtime_error("Unknown event modifier '" + modifier.text + "'");
+    }
+    consume(TokenType::LPAREN, "Expected '(' after '" + modifier.text + "'");
+    Token amount = consume(TokenType::NUMBER_LITERAL, "Expected a number for '" + modifier.text + "'");
+    consume(TokenType::RPAREN, "Expected ')' after " + modifier.text + " amount");
+    double value = std::stod(amount.text);
+    if (value < 1 || value > 60000) {
+        throw std::runtime_error("'" + modifier.text + "' needs a value from 1 to 60000");
+    }
+    policy.value = static_cast<uint32_t>(value);
+    return policy;
+}
+
 // Parses an if-else statement
 std::unique_ptr<ASTNode> Parser::parseIfElseStatement() {
     consume(TokenType::IF, "Expected 'if'");
@@ -437,7 +510,7 @@ std::unique_ptr<ASTNode> Parser::parseIfElseStatement() {
 
 // Parses a while statement 
 std::unique_ptr<ASTNode> Parser::parseWhileStatement() {
-    loopContextStack.push_back("while");
+    m_loopContextStack.push_back("while");
     consume(TokenType::WHILE, "Expected 'while'");
     consume(TokenType::LPAREN, "Expected '(' after 'while'");
     auto conditionExpr = parseExpression();
@@ -449,14 +522,14 @@ std::unique_ptr<ASTNode> Parser::parseWhileStatement() {
     // Parse the body (a block of statements delimited by '\' lines)
     parseBlockStatementList(whileNode->body);
 
-    loopContextStack.pop_back();
+    m_loopContextStack.pop_back();
 
     return whileNode;
 }
 
 // Parses a break statement 
 std::unique_ptr<ASTNode> Parser::parseBreakStatement() {
-    if (loopContextStack.empty()) {
+    if (m_loopContextStack.empty()) {
         throw std::runtime_error("Error: 'break' used outside of a loop at line " + std::to_string(m_line));
     }
     consume(TokenType::BREAK, "Expected 'break'");
@@ -470,7 +543,7 @@ std::unique_ptr<ASTNode> Parser::parseBreakStatement() {
 
 // Parses a continue statement 
 std::unique_ptr<ASTNode> Parser::parseContinueStatement() {
-    if (loopContextStack.empty()) {
+    if (m_loopContextStack.empty()) {
         throw std::runtime_error("Error: 'break' used outside of a loop at line " + std::to_string(m_line));
     }
     consume(TokenType::CONTINUE, "Expected 'continue'");
@@ -484,7 +557,7 @@ std::unique_ptr<ASTNode> Parser::parseContinueStatement() {
 
 // Parses a for statement 
 std::unique_ptr<ASTNode> Parser::parseForStatement() {
-    loopContextStack.push_back("for");
+    m_loopContextStack.push_back("for");
 
     consume(TokenType::FOR, "Expected 'for'");
     
@@ -509,9 +582,22 @@ std::unique_ptr<ASTNode> Parser::parseForStatement() {
 
     consume(TokenType::RPAREN, "Expected ')' after for(...) expression(s)");
 
+    // Optional 'window N' (virtualized list)
+    size_t windowSize = 0;
+    if (check(TokenType::IDENTIFIER) && peek().text == "window") {
+        advance();
+        Token sizeTok = consume(TokenType::NUMBER_LITERAL, "Expected row count after 'window'");
+        windowSize = static_cast<size_t>(std::stoul(sizeTok.text));
+        if (windowSize == 0) {
+            throw std::runtime_error("'window' needs a row count greater than zero");
+        }
+    }
+
     // Parse the body (a block of statements)
     std::vector<std::unique_ptr<ASTNode>> body;
-    std::cout << "[DEBUG FOR statement] Parsed range end expression: " << rangeEndExpr->toString() << "\n";
+    if (rangeEndExpr) {
+        std::cout << "[DEBUG FOR statement] Parsed range end expression: " << rangeEndExpr->toString() << "\n";
+    }
     parseBlockStatementList(body);
     std::cout << "[DEBUG FOR statement] Parsed body " << "\n";
     // Build the ForStatementNode
@@ -519,9 +605,10 @@ std::unique_ptr<ASTNode> Parser::parseForStatement() {
     forNode->iteratorName = iteratorTok.text;
     forNode->iterableExpression = std::move(iterableExpr);
     forNode->rangeEndExpr = std::move(rangeEndExpr);
+    forNode->windowSize = windowSize;
     forNode->body = std::move(body);
 
-    loopContextStack.pop_back();
+    m_loopContextStack.pop_back();
 
     return forNode;
 }
@@ -744,12 +831,10 @@ bool Parser::check(TokenType type) const {
 }
 
 bool Parser::checkNext(TokenType type) const {
-    if (m_pos + 1 >= m_tokens.size()) return false;
     return m_tokens[m_pos + 1].type == type;
 }
 
 bool Parser::checkNextNext(TokenType type) const {
-    if (m_pos + 2 >= m_tokens.size()) return false;
     return m_tokens[m_pos + 2].type == type;
 }
 
@@ -833,86 +918,65 @@ void Parser::synchronize() {
 
 // ------------------- ExpressionParser Nested Class Implementations -------------------
 
-// Parses an expression and returns an ExpressionStatementNode
-std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseExpression() {
-    return parseLogicalOr();
+namespace {
+
+// Binding power (higher binds tighter) and associativity of a binary operator.
+// A precedence of 0 means the token is not a binary operator.
+struct BinaryOperatorInfo {
+    int precedence;
+    bool rightAssociative;
+};
+
+// Operand of a prefix '-' / '!' binds tighter than everything except '^',
+// so '-a * b' is '(-a) * b' while '-a ^ b' is '-(a ^ b)'.
+constexpr int UNARY_OPERAND_PRECEDENCE = 7;
+
+// Single operator table driving the precedence-climbing loop
+const BinaryOperatorInfo& binaryOperatorInfo(TokenType type) {
+    static const auto table = [] {
+        std::array<BinaryOperatorInfo, static_cast<size_t>(TokenType::ERROR) + 1> t{};
+        auto set = [&t](TokenType op, int precedence, bool rightAssociative) {
+            t[static_cast<size_t>(op)] = BinaryOperatorInfo{precedence, rightAssociative};
+        };
+        set(TokenType::OR,       1, false);
+        set(TokenType::AND,      2, false);
+        set(TokenType::EQ,       3, false);
+        set(TokenType::NEQ,      3, false);
+        set(TokenType::LT,       4, false);
+        set(TokenType::LTEQ,     4, false);
+        set(TokenType::GT,       4, false);
+        set(TokenType::GTEQ,     4, false);
+        set(TokenType::PLUS,     5, false);
+        set(TokenType::MINUS,    5, false);
+        set(TokenType::MULTIPLY, 6, false);
+        set(TokenType::DIVIDE,   6, false);
+        set(TokenType::MODULUS,  6, false);
+        set(TokenType::POWER,    7, true);
+        return t;
+    }();
+    return table[static_cast<size_t>(type)];
 }
 
-std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseLogicalOr() {
-    auto left = parseLogicalAnd();
-    while (match(TokenType::OR)) {
-        Token opTok = previous();
-        auto right = parseLogicalAnd();
-        left = std::make_unique<BinaryExpressionStatementNode>(
-            opTok, std::move(left), std::move(right));
-    }
-    return left;
-}
+} // namespace
 
-std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseLogicalAnd() {
-    auto left = parseEquality();
-    while (match(TokenType::AND)) {
-        Token opTok = previous();
-        auto right = parseEquality();
-        left = std::make_unique<BinaryExpressionStatementNode>(
-            opTok, std::move(left), std::move(right));
-    }
-    return left;
-}
-
-std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseEquality() {
-    auto left = parseComparison();
-    while (check(TokenType::EQ) || check(TokenType::NEQ)) {
-        Token opTok = advance();
-        auto right = parseComparison();
-        left = std::make_unique<BinaryExpressionStatementNode>(
-            opTok, std::move(left), std::move(right));
-    }
-    return left;
-}
-
-std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseComparison() {
-    auto left = parseAddition();
-    while (true) {
-        if (match(TokenType::LT) || match(TokenType::LTEQ) ||
-            match(TokenType::GT) || match(TokenType::GTEQ)) {
-            Token opTok = previous();
-            auto right = parseAddition();
-            left = std::make_unique<BinaryExpressionStatementNode>(
-                opTok, std::move(left), std::move(right));
-        } else {
-            break;
-        }
-    }
-    return left;
-}
-
-std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseAddition() {
-    auto left = parseMultiplication();
-        while (true) {
-        if (match(TokenType::PLUS) || match(TokenType::MINUS)) {
-            Token opTok = previous();
-            auto right = parseMultiplication();
-            left = std::make_unique<BinaryExpressionStatementNode>(
-                opTok, std::move(left), std::move(right));
-        } else {
-            break;
-        }
-    }
-    return left;
+// Parses an expression and returns an ExpressionStatementNode
+std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseExpression() {
+    return parseBinary(1);
 }
 
-std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseMultiplication() {
+// Precedence climbing: folds every binary operator whose binding power is at
+// least minPrecedence into the left operand.
+std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseBinary(int minPrecedence) {
     auto left = parseUnary();
     while (true) {
-        if (match(TokenType::MULTIPLY) || match(TokenType::DIVIDE) || match(TokenType::MODULUS)) {
-            Token opTok = previous();
-            auto right = parseUnary();
-            left = std::make_unique<BinaryExpressionStatementNode>(
-                opTok, std::move(left), std::move(right));
-        } else {
+        const BinaryOperatorInfo& info = binaryOperatorInfo(peek().type);
+        if (info.precedence == 0 || info.precedence < minPrecedence) {
             break;
         }
+        Token opTok = advance();
+        auto right = parseBinary(info.rightAssociative ? info.precedence : info.precedence + 1);
+        left = std::make_unique<BinaryExpressionStatementNode>(
+            opTok, std::move(left), std::move(right));
     }
     return left;
 }
@@ -920,7 +984,7 @@ std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseMultipli
 std::unique_ptr<ExpressionStatementNode> Parser::ExpressionParser::parseUnary() {
     if (match(TokenType::NOT) || match(TokenType::MINUS)) {
         Token opTok = previous();
-        auto right = parseUnary();
+        auto right = parseBinary(UNARY_OPERAND_PRECEDENCE);
         return std::make_unique<UnaryExpressionStatementNode>(
             opTok, std::move(right));
     }
@@ -0,0 +1,139 @@
+// module_loader.cpp
+#include "../include/module_loader.h"
+#include "../include/jtml_parser.h"
+#include "../include/mapped_file.h"
+#include "../include/program_cache.h"
+
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <unordered_set>
+
+namespace {
+
+// Canonical paths of the top-level imports in a program
+std::vector<std::string> collectImports(const std::vector<std::unique_ptr<ASTNode>>& program,
+                                        const std::string& baseDir) {
+    std::vector<std::string> imports;
+    for (const auto& node : program) {
+        if (node && node->getType() == ASTNodeType::ImportStatement) {
+            const auto& importNode = static_cast<const ImportStatementNode&>(*node);
+            imports.push_back(ModuleLoader::resolve(importNode.modulePath, baseDir));
+        }
+    }
+    return imports;
+}
+
+} // namespace
+
+ModuleLoader& ModuleLoader::instance() {
+    static ModuleLoader loader;
+    return loader;
+}
+
+void ModuleLoader::setCacheDirectory(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(modulesMutex);
+    cacheDir = dir;
+}
+
+std::string ModuleLoader::resolve(const std::string& importPath, const std::string& baseDir) {
+    namespace fs = std::filesystem;
+    fs::path p(importPath);
+    if (p.is_relative()) {
+        p = fs::path(baseDir.empty() ? "." : baseDir) / p;
+    }
+    std::error_code ec;
+    fs::path canonical = fs::weakly_canonical(p, ec);
+    return (ec ? p.lexically_normal() : canonical).string();
+}
+
+std::string ModuleLoader::directoryOf(const std::string& path) {
+    return std::filesystem::path(path).parent_path().string();
+}
+
+JTMLInterpreter::ThreadPool& ModuleLoader::pool() {
+    std::call_once(poolOnce, [this] {
+        workerPool = std::make_unique<JTMLInterpreter::ThreadPool>();
+    });
+    return *workerPool;
+}
+
+std::shared_ptr<const Module> ModuleLoader::load(const std::string& canonicalPath) {
+    MappedFile source(canonicalPath);
+    const uint64_t sourceHash = ProgramCache::hashSource(source.view());
+
+    {
+        std::lock_guard<std::mutex> lock(modulesMutex);
+        auto it = modules.find(canonicalPath);
+        if (it != modules.end() && it->second->sourceHash == sourceHash) {
+            return it->second;  // unchanged since last compile
+        }
+    }
+
+    auto module = compile(canonicalPath, sourceHash, source.view());
+
+    std::lock_guard<std::mutex> lock(modulesMutex);
+    modules[canonicalPath] = module;
+    return module;
+}
+
+std::shared_ptr<const Module> ModuleLoader::compile(const std::string& canonicalPath, uint64_t sourceHash,
+                                                    std::string_view source) const {
+    auto module = std::make_shared<Module>();
+    module->path = canonicalPath;
+    module->sourceHash = sourceHash;
+
+    std::string dir;
+    {
+        std::lock_guard<std::mutex> lock(modulesMutex);
+        dir = cacheDir;
+    }
+    CompiledProgram compiled;
+    ProgramCache cache(dir);
+    if (!dir.empty() && cache.load(canonicalPath, sourceHash, compiled)) {
+        module->program = std::move(compiled.program);
+    } else {
+        Lexer lexer(source);
+        Parser parser(lexer);
+        module->program = parser.parseProgram();
+        module->errors = lexer.getErrors();
+        module->errors.insert(module->errors.end(), parser.getErrors().begin(), parser.getErrors().end());
+        if (!dir.empty() && module->errors.empty()) {
+            compiled.sourceHash = sourceHash;
+            compiled.program = std::move(module->program);
+            cache.store(canonicalPath, compiled);
+            module->program = std::move(compiled.program);
+        }
+    }
+
+    module->imports = collectImports(module->program, directoryOf(canonicalPath));
+    return module;
+}
+
+void ModuleLoader::preload(const std::vector<std::unique_ptr<ASTNode>>& program, const std::string& baseDir) {
+    std::vector<std::string> frontier = collectImports(program, baseDir);
+    std::unordered_set<std::string> seen(frontier.begin(), frontier.end());
+
+    // Breadth-first over the import graph; modules on the same level are independent
+    while (!frontier.empty()) {
+        std::vector<std::future<std::shared_ptr<const Module>>> pending;
+        pending.reserve(frontier.size());
+        for (const auto& path : frontier) {
+            pending.push_back(pool().submit([this, path] { return load(path); }));
+        }
+
+        std::vector<std::string> next;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            try {
+                auto module = pending[i].get();
+                for (const auto& dep : module->imports) {
+                    if (seen.insert(dep).second) next.push_back(dep);
+                }
+            } catch (const std::exception& e) {
+                // Reported again (with context) when the import statement executes
+                std::cerr << "Module preload failed for " << frontier[i] << ": " << e.what() << "\n";
+            }
+        }
+        frontier = std::move(next);
+    }
+}
@@ -0,0 +1,769 @@
+// program_cache.cpp
+#include "../include/program_cache.h"
+#include "../include/mapped_file.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char CACHE_MAGIC[8] = {'J', 'T', 'M', 'L', 'C', '\0', '\r', '\n'};
+constexpr uint32_t CACHE_FORMAT_VERSION = 7;
+constexpr uint8_t NULL_NODE = 0xFF;
+
+// ------------------- Writer -------------------
+
+class Writer {
+public:
+    void u8(uint8_t v) { m_out.push_back(static_cast<char>(v)); }
+    void u32(uint32_t v) { raw(&v, sizeof v); }
+    void i32(int32_t v) { raw(&v, sizeof v); }
+    void u64(uint64_t v) { raw(&v, sizeof v); }
+    void f64(double v) { raw(&v, sizeof v); }
+    void str(const std::string& s) {
+        u32(static_cast<uint32_t>(s.size()));
+        m_out.append(s);
+    }
+    void bytes(const char* data, size_t len) { m_out.append(data, len); }
+    void eventPolicy(const EventPolicy& policy) {
+        u8(static_cast<uint8_t>(policy.kind));
+        u32(policy.value);
+    }
+
+    void expr(const ExpressionStatementNode* node);
+    void exprList(const std::vector<std::unique_ptr<ExpressionStatementNode>>& list);
+    void node(const ASTNode* node);
+    void nodeList(const std::vector<std::unique_ptr<ASTNode>>& list);
+
+    std::string take() { return std::move(m_out); }
+
+private:
+    void raw(const void* p, size_t n) { m_out.append(static_cast<const char*>(p), n); }
+    std::string m_out;
+};
+
+void Writer::exprList(const std::vector<std::unique_ptr<ExpressionStatementNode>>& list) {
+    u32(static_cast<uint32_t>(list.size()));
+    for (const auto& e : list) expr(e.get());
+}
+
+void Writer::nodeList(const std::vector<std::unique_ptr<ASTNode>>& list) {
+    u32(static_cast<uint32_t>(list.size()));
+    for (const auto& n : list) node(n.get());
+}
+
+void Writer::expr(const ExpressionStatementNode* e) {
+    if (!e) {
+        u8(NULL_NODE);
+        return;
+    }
+    u8(static_cast<uint8_t>(e->getExprType()));
+    switch (e->getExprType()) {
+        case ExpressionStatementNodeType::Binary: {
+            auto& n = static_cast<const BinaryExpressionStatementNode&>(*e);
+            str(n.op);
+            expr(n.left.get());
+            expr(n.right.get());
+            break;
+        }
+        case ExpressionStatementNodeType::Unary: {
+            auto& n = static_cast<const UnaryExpressionStatementNode&>(*e);
+            str(n.op);
+            expr(n.right.get());
+            break;
+        }
+        case ExpressionStatementNodeType::Variable:
+            str(static_cast<const VariableExpressionStatementNode&>(*e).name);
+            break;
+        case ExpressionStatementNodeType::StringLiteral:
+            str(static_cast<const StringLiteralExpressionStatementNode&>(*e).value);
+            break;
+        case ExpressionStatementNodeType::NumberLiteral:
+            f64(static_cast<const NumberLiteralExpressionStatementNode&>(*e).value);
+            break;
+        case ExpressionStatementNodeType::BooleanLiteral:
+            u8(static_cast<const BooleanLiteralExpressionStatementNode&>(*e).value ? 1 : 0);
+            break;
+        case ExpressionStatementNodeType::EmbeddedVariable:
+            expr(static_cast<const EmbeddedVariableExpressionStatementNode&>(*e).embeddedExpression.get());
+            break;
+        case ExpressionStatementNodeType::CompositeString:
+            exprList(static_cast<const CompositeStringExpressionStatementNode&>(*e).parts);
+            break;
+        case ExpressionStatementNodeType::ArrayLiteral:
+            exprList(static_cast<const ArrayLiteralExpressionStatementNode&>(*e).elements);
+            break;
+        case ExpressionStatementNodeType::DictionaryLiteral: {
+            auto& n = static_cast<const DictionaryLiteralExpressionStatementNode&>(*e);
+            u32(static_cast<uint32_t>(n.entries.size()));
+            for (const auto& entry : n.entries) {
+                u8(static_cast<uint8_t>(entry.key.type));
+                str(entry.key.text);
+                expr(entry.value.get());
+            }
+            break;
+        }
+        case ExpressionStatementNodeType::Subscript: {
+            auto& n = static_cast<const SubscriptExpressionStatementNode&>(*e);
+            expr(n.base.get());
+            expr(n.index.get());
+            u8(n.isSlice ? 1 : 0);
+            break;
+        }
+        case ExpressionStatementNodeType::FunctionCall: {
+            auto& n = static_cast<const FunctionCallExpressionStatementNode&>(*e);
+            str(n.functionName);
+            exprList(n.arguments);
+            break;
+        }
+        case ExpressionStatementNodeType::ObjectPropertyAccess: {
+            auto& n = static_cast<const ObjectPropertyAccessExpressionNode&>(*e);
+            expr(n.base.get());
+            str(n.propertyName);
+            break;
+        }
+        case ExpressionStatementNodeType::ObjectMethodCall: {
+            auto& n = static_cast<const ObjectMethodCallExpressionNode&>(*e);
+            expr(n.base.get());
+            str(n.methodName);
+            exprList(n.arguments);
+            break;
+        }
+        default:
+            throw std::runtime_error("ProgramCache: unsupported expression type");
+    }
+}
+
+void Writer::node(const ASTNode* n) {
+    if (!n) {
+        u8(NULL_NODE);
+        return;
+    }
+    u8(static_cast<uint8_t>(n->getType()));
+    switch (n->getType()) {
+        case ASTNodeType::JtmlElement: {
+            auto& elem = static_cast<const JtmlElementNode&>(*n);
+            str(elem.tagName);
+            u32(static_cast<uint32_t>(elem.attributes.size()));
+            for (const auto& attr : elem.attributes) {
+                str(attr.key);
+                expr(attr.value.get());
+                eventPolicy(attr.policy);
+            }
+            nodeList(elem.content);
+            break;
+        }
+        case ASTNodeType::BlockStatement:
+            nodeList(static_cast<const BlockStatementNode&>(*n).statements);
+            break;
+        case ASTNodeType::ShowStatement:
+            expr(static_cast<const ShowStatementNode&>(*n).expr.get());
+            break;
+        case ASTNodeType::DefineStatement: {
+            auto& d = static_cast<const DefineStatementNode&>(*n);
+            str(d.identifier);
+            expr(d.expression.get());
+            break;
+        }
+        case ASTNodeType::DeriveStatement: {
+            auto& d = static_cast<const DeriveStatementNode&>(*n);
+            str(d.identifier);
+            str(d.declaredType);
+            expr(d.expression.get());
+            break;
+        }
+        case ASTNodeType::UnbindStatement:
+            str(static_cast<const UnbindStatementNode&>(*n).identifier);
+            break;
+        case ASTNodeType::StoreStatement: {
+            auto& st = static_cast<const StoreStatementNode&>(*n);
+            str(st.targetScope);
+            str(st.variableName);
+            break;
+        }
+        case ASTNodeType::AssignmentStatement: {
+            auto& a = static_cast<const AssignmentStatementNode&>(*n);
+            expr(a.lhs.get());
+            expr(a.rhs.get());
+            break;
+        }
+        case ASTNodeType::ExpressionStatement:
+            expr(static_cast<const ExpressionNode&>(*n).expression.get());
+            break;
+        case ASTNodeType::ReturnStatement:
+            expr(static_cast<const ReturnStatementNode&>(*n).expr.get());
+            break;
+        case ASTNodeType::ThrowStatement:
+            expr(static_cast<const ThrowStatementNode&>(*n).expression.get());
+            break;
+        case ASTNodeType::IfStatement: {
+            auto& i = static_cast<const IfStatementNode&>(*n);
+            expr(i.condition.get());
+            nodeList(i.thenStatements);
+            nodeList(i.elseStatements);
+            break;
+        }
+        case ASTNodeType::WhileStatement: {
+            auto& w = static_cast<const WhileStatementNode&>(*n);
+            expr(w.condition.get());
+            nodeList(w.body);
+            break;
+        }
+        case ASTNodeType::ForStatement: {
+            auto& f = static_cast<const ForStatementNode&>(*n);
+            str(f.iteratorName);
+            expr(f.iterableExpression.get());
+            expr(f.rangeEndExpr.get());
+            u64(static_cast<uint64_t>(f.windowSize));
+            nodeList(f.body);
+            break;
+        }
+        case ASTNodeType::TryExceptThen: {
+            auto& t = static_cast<const TryExceptThenNode&>(*n);
+            nodeList(t.tryBlock);
+            u8(t.hasCatch ? 1 : 0);
+            str(t.catchIdentifier);
+            nodeList(t.catchBlock);
+            u8(t.hasFinally ? 1 : 0);
+            nodeList(t.finallyBlock);
+            break;
+        }
+        case ASTNodeType::BreakStatement:
+        case ASTNodeType::ContinueStatement:
+        case ASTNodeType::NoOp:
+            break;
+        case ASTNodeType::FunctionDeclaration: {
+            auto& f = static_cast<const FunctionDeclarationNode&>(*n);
+            str(f.name);
+            u32(static_cast<uint32_t>(f.parameters.size()));
+            for (const auto& p : f.parameters) {
+                str(p.name);
+                str(p.type);
+            }
+            str(f.returnType);
+            nodeList(f.body);
+            break;
+        }
+        case ASTNodeType::SubscribeStatement: {
+            auto& s = static_cast<const SubscribeStatementNode&>(*n);
+            str(s.functionName);
+            str(s.variableName);
+            break;
+        }
+        case ASTNodeType::UnsubscribeStatement: {
+            auto& s = static_cast<const UnsubscribeStatementNode&>(*n);
+            str(s.functionName);
+            str(s.variableName);
+            break;
+        }
+        case ASTNodeType::ClassDeclaration: {
+            auto& c = static_cast<const ClassDeclarationNode&>(*n);
+            str(c.name);
+            str(c.parentName);
+            nodeList(c.members);
+            break;
+        }
+        case ASTNodeType::ImportStatement: {
+            auto& imp = static_cast<const ImportStatementNode&>(*n);
+            str(imp.modulePath);
+            str(imp.alias);
+            break;
+        }
+        default:
+            throw std::runtime_error("ProgramCache: unsupported node type");
+    }
+}
+
+// ------------------- Reader -------------------
+
+class Reader {
+public:
+    explicit Reader(std::string_view bytes) : m_data(bytes), m_pos(0) {}
+
+    uint8_t u8() { uint8_t v; raw(&v, sizeof v); return v; }
+    uint32_t u32() { uint32_t v; raw(&v, sizeof v); return v; }
+    int32_t i32() { int32_t v; raw(&v, sizeof v); return v; }
+    uint64_t u64() { uint64_t v; raw(&v, sizeof v); return v; }
+    double f64() { double v; raw(&v, sizeof v); return v; }
+    std::string str() {
+        uint32_t len = u32();
+        need(len);
+        std::string s(m_data.substr(m_pos, len));
+        m_pos += len;
+        return s;
+    }
+    EventPolicy eventPolicy() {
+        EventPolicy policy;
+        uint8_t kind = u8();
+        if (kind > static_cast<uint8_t>(EventPolicy::Kind::Debounce)) {
+            throw std::runtime_error("ProgramCache: unknown event policy " + std::to_string(kind));
+        }
+        policy.kind = static_cast<EventPolicy::Kind>(kind);
+        policy.value = u32();
+        return policy;
+    }
+    std::string_view bytes(size_t len) {
+        need(len);
+        auto v = m_data.substr(m_pos, len);
+        m_pos += len;
+        return v;
+    }
+    bool atEnd() const { return m_pos == m_data.size(); }
+
+    std::unique_ptr<ExpressionStatementNode> expr();
+    std::vector<std::unique_ptr<ExpressionStatementNode>> exprList();
+    std::unique_ptr<ASTNode> node();
+    std::vector<std::unique_ptr<ASTNode>> nodeList();
+
+private:
+    void need(size_t n) const {
+        if (m_pos + n > m_data.size()) {
+            throw std::runtime_error("ProgramCache: truncated cache entry");
+        }
+    }
+    void raw(void* p, size_t n) {
+        need(n);
+        std::memcpy(p, m_data.data() + m_pos, n);
+        m_pos += n;
+    }
+
+    std::string_view m_data;
+    size_t m_pos;
+};
+
+// Synthetic token for node constructors that only read the token text
+Token textToken(TokenType type, std::string text) {
+    return Token{type, std::move(text), 0, 0, 0};
+}
+
+std::vector<std::unique_ptr<ExpressionStatementNode>> Reader::exprList() {
+    uint32_t count = u32();
+    std::vector<std::unique_ptr<ExpressionStatementNode>> list;
+    list.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) list.push_back(expr());
+    return list;
+}
+
+std::vector<std::unique_ptr<ASTNode>> Reader::nodeList() {
+    uint32_t count = u32();
+    std::vector<std::unique_ptr<ASTNode>> list;
+    list.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) list.push_back(node());
+    return list;
+}
+
+std::unique_ptr<ExpressionStatementNode> Reader::expr() {
+    uint8_t tag = u8();
+    if (tag == NULL_NODE) return nullptr;
+
+    switch (static_cast<ExpressionStatementNodeType>(tag)) {
+        case ExpressionStatementNodeType::Binary: {
+            auto op = str();
+            auto left = expr();
+            auto right = expr();
+            return std::make_unique<BinaryExpressionStatementNode>(
+                textToken(TokenType::ERROR, std::move(op)), std::move(left), std::move(right));
+        }
+        case ExpressionStatementNodeType::Unary: {
+            auto op = str();
+            auto right = expr();
+            return std::make_unique<UnaryExpressionStatementNode>(
+                textToken(TokenType::ERROR, std::move(op)), std::move(right));
+        }
+        case ExpressionStatementNodeType::Variable:
+            return std::make_unique<VariableExpressionStatementNode>(textToken(TokenType::IDENTIFIER, str()));
+        case ExpressionStatementNodeType::StringLiteral:
+            return std::make_unique<StringLiteralExpressionStatementNode>(textToken(TokenType::STRING_LITERAL, str()));
+        case ExpressionStatementNodeType::NumberLiteral: {
+            auto num = std::make_unique<NumberLiteralExpressionStatementNode>(textToken(TokenType::NUMBER_LITERAL, "0"));
+            num->value = f64();
+            return num;
+        }
+        case ExpressionStatementNodeType::BooleanLiteral:
+            return std::make_unique<BooleanLiteralExpressionStatementNode>(u8() != 0);
+        case ExpressionStatementNodeType::EmbeddedVariable:
+            return std::make_unique<EmbeddedVariableExpressionStatementNode>(expr());
+        case ExpressionStatementNodeType::CompositeString:
+            return std::make_unique<CompositeStringExpressionStatementNode>(exprList());
+        case ExpressionStatementNodeType::ArrayLiteral:
+            return std::make_unique<ArrayLiteralExpressionStatementNode>(exprList());
+        case ExpressionStatementNodeType::DictionaryLiteral: {
+            uint32_t count = u32();
+            std::vector<DictionaryEntry> entries;
+            entries.reserve(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                auto keyType = static_cast<TokenType>(u8());
+                auto keyText = str();
+                entries.push_back(DictionaryEntry{textToken(keyType, std::move(keyText)), expr()});
+            }
+            return std::make_unique<DictionaryLiteralExpressionStatementNode>(std::move(entries));
+        }
+        case ExpressionStatementNodeType::Subscript: {
+            auto base = expr();
+            auto index = expr();
+            bool slice = u8() != 0;
+            return std::make_unique<SubscriptExpressionStatementNode>(std::move(base), std::move(index), slice);
+        }
+        case ExpressionStatementNodeType::FunctionCall: {
+            auto name = str();
+            return std::make_unique<FunctionCallExpressionStatementNode>(name, exprList());
+        }
+        case ExpressionStatementNodeType::ObjectPropertyAccess: {
+            auto base = expr();
+            auto prop = str();
+            return std::make_unique<ObjectPropertyAccessExpressionNode>(std::move(base), prop);
+        }
+        case ExpressionStatementNodeType::ObjectMethodCall: {
+            auto base = expr();
+            auto method = str();
+            return std::make_unique<ObjectMethodCallExpressionNode>(std::move(base), method, exprList());
+        }
+    }
+    throw std::runtime_error("ProgramCache: unknown expression tag " + std::to_string(tag));
+}
+
+std::unique_ptr<ASTNode> Reader::node() {
+    uint8_t tag = u8();
+    if (tag == NULL_NODE) return nullptr;
+
+    switch (static_cast<ASTNodeType>(tag)) {
+        case ASTNodeType::JtmlElement: {
+            auto elem = std::make_unique<JtmlElementNode>();
+            elem->tagName = str();
+            uint32_t attrCount = u32();
+            elem->attributes.reserve(attrCount);
+            for (uint32_t i = 0; i < attrCount; ++i) {
+                auto key = str();
+                elem->attributes.emplace_back(key, expr());
+                elem->attributes.back().policy = eventPolicy();
+            }
+            elem->content = nodeList();
+            return elem;
+        }
+        case ASTNodeType::BlockStatement: {
+            auto block = std::make_unique<BlockStatementNode>();
+            block->statements = nodeList();
+            return block;
+        }
+        case ASTNodeType::ShowStatement: {
+            auto show = std::make_unique<ShowStatementNode>();
+            show->expr = expr();
+            return show;
+        }
+        case ASTNodeType::DefineStatement: {
+            auto def = std::make_unique<DefineStatementNode>();
+            def->identifier = str();
+            def->expression = expr();
+            return def;
+        }
+        case ASTNodeType::DeriveStatement: {
+            auto der = std::make_unique<DeriveStatementNode>();
+            der->identifier = str();
+            der->declaredType = str();
+            der->expression = expr();
+            return der;
+        }
+        case ASTNodeType::UnbindStatement: {
+            auto unbind = std::make_unique<UnbindStatementNode>();
+            unbind->identifier = str();
+            return unbind;
+        }
+        case ASTNodeType::StoreStatement: {
+            auto store = std::make_unique<StoreStatementNode>();
+            store->targetScope = str();
+            store->variableName = str();
+            return store;
+        }
+        case ASTNodeType::AssignmentStatement: {
+            auto assign = std::make_unique<AssignmentStatementNode>();
+            assign->lhs = expr();
+            assign->rhs = expr();
+            return assign;
+        }
+        case ASTNodeType::ExpressionStatement: {
+            auto exprNode = std::make_unique<ExpressionNode>();
+            exprNode->expression = expr();
+            return exprNode;
+        }
+        case ASTNodeType::ReturnStatement: {
+            auto ret = std::make_unique<ReturnStatementNode>();
+            ret->expr = expr();
+            return ret;
+        }
+        case ASTNodeType::ThrowStatement: {
+            auto thr = std::make_unique<ThrowStatementNode>();
+            thr->expression = expr();
+            return thr;
+        }
+        case ASTNodeType::IfStatement: {
+            auto ifNode = std::make_unique<IfStatementNode>();
+            ifNode->condition = expr();
+            ifNode->thenStatements = nodeList();
+            ifNode->elseStatements = nodeList();
+            return ifNode;
+        }
+        case ASTNodeType::WhileStatement: {
+            auto whileNode = std::make_unique<WhileStatementNode>();
+            whileNode->condition = expr();
+            whileNode->body = nodeList();
+            return whileNode;
+        }
+        case ASTNodeType::ForStatement: {
+            auto forNode = std::make_unique<ForStatementNode>();
+            forNode->iteratorName = str();
+            forNode->iterableExpression = expr();
+            forNode->rangeEndExpr = expr();
+            forNode->windowSize = static_cast<size_t>(u64());
+            forNode->body = nodeList();
+            return forNode;
+        }
+        case ASTNodeType::TryExceptThen: {
+            auto tryNode = std::make_unique<TryExceptThenNode>();
+            tryNode->tryBlock = nodeList();
+            tryNode->hasCatch = u8() != 0;
+            tryNode->catchIdentifier = str();
+            tryNode->catchBlock = nodeList();
+            tryNode->hasFinally = u8() != 0;
+            tryNode->finallyBlock = nodeList();
+            return tryNode;
+        }
+        case ASTNodeType::BreakStatement:
+            return std::make_unique<BreakStatementNode>();
+        case ASTNodeType::ContinueStatement:
+            return std::make_unique<ContinueStatementNode>();
+        case ASTNodeType::NoOp:
+            return std::make_unique<NoOpStatementNode>();
+        case ASTNodeType::FunctionDeclaration: {
+            auto name = str();
+            uint32_t paramCount = u32();
+            std::vector<Parameter> params;
+            params.reserve(paramCount);
+            for (uint32_t i = 0; i < paramCount; ++i) {
+                Parameter p;
+                p.name = str();
+                p.type = str();
+                params.push_back(std::move(p));
+            }
+            auto returnType = str();
+            auto body = nodeList();
+            return std::make_unique<FunctionDeclarationNode>(name, params, returnType, std::move(body));
+        }
+        case ASTNodeType::SubscribeStatement: {
+            auto sub = std::make_unique<SubscribeStatementNode>();
+            sub->functionName = str();
+            sub->variableName = str();
+            return sub;
+        }
+        case ASTNodeType::UnsubscribeStatement: {
+            auto unsub = std::make_unique<UnsubscribeStatementNode>();
+            unsub->functionName = str();
+            unsub->variableName = str();
+            return unsub;
+        }
+        case ASTNodeType::ClassDeclaration: {
+            auto name = str();
+            auto parentName = str();
+            return std::make_unique<ClassDeclarationNode>(name, parentName, nodeList());
+        }
+        case ASTNodeType::ImportStatement: {
+            auto imp = std::make_unique<ImportStatementNode>();
+            imp->modulePath = str();
+            imp->alias = str();
+            return imp;
+        }
+    }
+    throw std::runtime_error("ProgramCache: unknown node tag " + std::to_string(tag));
+}
+
+std::string toHex(uint64_t v) {
+    char buf[17];
+    std::snprintf(buf, sizeof buf, "%016llx", static_cast<unsigned long long>(v));
+    return buf;
+}
+
+// A temp file next to `path` that no other writer uses: this process, this
+// thread, and a counter for the thread's successive writes
+std::string uniqueTempPath(const std::string& path) {
+    static std::atomic<uint64_t> counter{0};
+#ifdef _WIN32
+    const int pid = _getpid();
+#else
+    const int pid = static_cast<int>(getpid());
+#endif
+    std::ostringstream name;
+    name << path << "." << pid << "." << std::hash<std::thread::id>()(std::this_thread::get_id())
+         << "." << counter.fetch_add(1) << ".tmp";
+    return name.str();
+}
+
+} // namespace
+
+// ------------------- ProgramCache Implementations -------------------
+
+ProgramCache::ProgramCache(std::string cacheDir)
+    : m_cacheDir(std::move(cacheDir)) {}
+
+uint64_t ProgramCache::hashSource(std::string_view source) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : source) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::string ProgramCache::entryPath(const std::string& sourcePath, uint64_t sourceHash) const {
+    if (!m_cacheDir.empty()) {
+        return m_cacheDir + "/" + toHex(sourceHash) + ".jtmlc";
+    }
+    if (sourcePath.empty()) {
+        throw std::runtime_error("ProgramCache: no source path or cache directory for entry");
+    }
+    return sourcePath + "c";  // foo.jtml -> foo.jtmlc
+}
+
+std::string ProgramCache::serialize(const CompiledProgram& compiled) {
+    Writer w;
+    w.bytes(CACHE_MAGIC, sizeof CACHE_MAGIC);
+    w.u32(CACHE_FORMAT_VERSION);
+    w.u64(compiled.sourceHash);
+
+    w.nodeList(compiled.program);
+
+    w.u8(compiled.hasHtml ? 1 : 0);
+    if (compiled.hasHtml) {
+        w.str(compiled.html);
+        w.u32(static_cast<uint32_t>(compiled.bindings.size()));
+        for (const auto& slot : compiled.bindings) {
+            w.u8(static_cast<uint8_t>(slot.kind));
+            w.str(slot.name);
+            w.str(slot.elementId);
+            w.str(slot.attribute);
+            w.str(slot.iteratorName);
+            w.expr(slot.expression.get());
+            w.u64(static_cast<uint64_t>(slot.htmlOffset));
+            w.u64(static_cast<uint64_t>(slot.htmlLength));
+            w.u64(static_cast<uint64_t>(slot.windowSize));
+            w.eventPolicy(slot.eventPolicy);
+            w.u32(static_cast<uint32_t>(slot.rowHoles.size()));
+            for (const auto& hole : slot.rowHoles) {
+                w.u8(static_cast<uint8_t>(hole.kind));
+                w.str(hole.attribute);
+                w.expr(hole.expression.get());
+            }
+        }
+    }
+    return w.take();
+}
+
+void ProgramCache::deserialize(std::string_view bytes, CompiledProgram& out) {
+    Reader r(bytes);
+    if (r.bytes(sizeof CACHE_MAGIC) != std::string_view(CACHE_MAGIC, sizeof CACHE_MAGIC)) {
+        throw std::runtime_error("ProgramCache: bad magic");
+    }
+    if (r.u32() != CACHE_FORMAT_VERSION) {
+        throw std::runtime_error("ProgramCache: format version mismatch");
+    }
+    out.sourceHash = r.u64();
+
+    out.program = r.nodeList();
+
+    out.hasHtml = r.u8() != 0;
+    out.html.clear();
+    out.bindings.clear();
+    if (out.hasHtml) {
+        out.html = r.str();
+        uint32_t slotCount = r.u32();
+        out.bindings.reserve(slotCount);
+        for (uint32_t i = 0; i < slotCount; ++i) {
+            BindingSlot slot;
+            uint8_t kind = r.u8();
+            if (kind > static_cast<uint8_t>(BindingKind::While)) {
+                throw std::runtime_error("ProgramCache: unknown binding kind " + std::to_string(kind));
+            }
+            slot.kind = static_cast<BindingKind>(kind);
+            slot.name = r.str();
+            slot.elementId = r.str();
+            slot.attribute = r.str();
+            slot.iteratorName = r.str();
+            slot.expression = r.expr();
+            uint64_t offset = r.u64();
+            slot.htmlOffset = offset == static_cast<uint64_t>(-1) ? std::string::npos : static_cast<size_t>(offset);
+            slot.htmlLength = static_cast<size_t>(r.u64());
+            slot.windowSize = static_cast<size_t>(r.u64());
+            slot.eventPolicy = r.eventPolicy();
+            uint32_t holeCount = r.u32();
+            for (uint32_t h = 0; h < holeCount; ++h) {
+                RowHole hole;
+                uint8_t holeKind = r.u8();
+                if (holeKind > static_cast<uint8_t>(BindingKind::While)) {
+                    throw std::runtime_error("ProgramCache: unknown row hole kind " + std::to_string(holeKind));
+                }
+                hole.kind = static_cast<BindingKind>(holeKind);
+                hole.attribute = r.str();
+                hole.expression = r.expr();
+                slot.rowHoles.push_back(std::move(hole));
+            }
+            out.bindings.push_back(std::move(slot));
+        }
+    }
+    if (!r.atEnd()) {
+        throw std::runtime_error("ProgramCache: trailing bytes in cache entry");
+    }
+}
+
+bool ProgramCache::load(const std::string& sourcePath, uint64_t sourceHash, CompiledProgram& out) const {
+    std::string path = entryPath(sourcePath, sourceHash);
+    try {
+        MappedFile entry(path);
+        CompiledProgram loaded;
+        deserialize(entry.view(), loaded);
+        if (loaded.sourceHash != sourceHash) {
+            return false;
+        }
+        out = std::move(loaded);
+        return true;
+    } catch (const std::exception&) {
+        return false;  // missing or unreadable entry: recompile
+    }
+}
+
+void ProgramCache::store(const std::string& sourcePath, const CompiledProgram& compiled) const {
+    std::string path = entryPath(sourcePath, compiled.sourceHash);
+    // Writers of the same entry (parallel module compiles, processes
+    // sharing a cache dir) each write their own file and rename it
+    std::string tmpPath = uniqueTempPath(path);
+    try {
+        std::string bytes = serialize(compiled);
+        {
+            std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!ofs.is_open()) {
+                throw std::runtime_error("cannot open " + tmpPath);
+            }
+            ofs.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            if (!ofs) {
+                throw std::runtime_error("write failed for " + tmpPath);
+            }
+        }
+        // Atomic replace so concurrent readers never see a half-written entry
+        if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("cannot rename " + tmpPath + " to " + path);
+        }
+    } catch (const std::exception& e) {
+        std::remove(tmpPath.c_str());
+        std::cerr << "Program cache write failed: " << e.what() << "\n";
+    }
+}
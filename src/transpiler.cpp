@@ -2,16 +2,109 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+
+namespace {
+
+// A value the compiler can compute without the interpreter
+struct StaticValue {
+    enum class Kind { String, Number, Bool } kind = Kind::String;
+    double number = 0.0;
+    std::string text;  // what VarValue::toString() would produce
+};
+
+// Folds literals, composite strings of literals and '+' over them, following
+// the interpreter's rules; anything that could depend on state is not static.
+bool foldStatic(const ExpressionStatementNode* expr, StaticValue& out) {
+    if (!expr) return false;
+    switch (expr->getExprType()) {
+    case ExpressionStatementNodeType::StringLiteral:
+        out.kind = StaticValue::Kind::String;
+        out.text = static_cast<const StringLiteralExpressionStatementNode*>(expr)->value;
+        return true;
+    case ExpressionStatementNodeType::NumberLiteral: {
+        out.kind = StaticValue::Kind::Number;
+        out.number = static_cast<const NumberLiteralExpressionStatementNode*>(expr)->value;
+        std::ostringstream oss;
+        oss << out.number;
+        out.text = oss.str();
+        return true;
+    }
+    case ExpressionStatementNodeType::BooleanLiteral:
+        out.kind = StaticValue::Kind::Bool;
+        out.text = static_cast<const BooleanLiteralExpressionStatementNode*>(expr)->value ? "true" : "false";
+        return true;
+    case ExpressionStatementNodeType::CompositeString: {
+        std::string text;
+        for (const auto& part : static_cast<const CompositeStringExpressionStatementNode*>(expr)->parts) {
+            StaticValue partVal;
+            if (!foldStatic(part.get(), partVal)) return false;
+            text += partVal.text;
+        }
+        out.kind = StaticValue::Kind::String;
+        out.text = std::move(text);
+        return true;
+    }
+    case ExpressionStatementNodeType::Binary: {
+        const auto* bin = static_cast<const BinaryExpressionStatementNode*>(expr);
+        StaticValue l, r;
+        if (bin->op != "+" || !foldStatic(bin->left.get(), l) || !foldStatic(bin->right.get(), r)) {
+            return false;
+        }
+        if (l.kind == StaticValue::Kind::String || r.kind == StaticValue::Kind::String) {
+            out.kind = StaticValue::Kind::String;
+            out.text = l.text + r.text;
+            return true;
+        }
+        if (l.kind == StaticValue::Kind::Number && r.kind == StaticValue::Kind::Number) {
+            out.kind = StaticValue::Kind::Number;
+            out.number = l.number + r.number;
+            std::ostringstream oss;
+            oss << out.number;
+            out.text = oss.str();
+            return true;
+        }
+        return false;  // leave the runtime error to the interpreter
+    }
+    default:
+        return false;
+    }
+}
+
+} // namespace
 
 JtmlTranspiler::JtmlTranspiler() {
     // Initialize any required state for the transpiler
 }
 std::string JtmlTranspiler::transpile(const std::vector<std::unique_ptr<ASTNode>>& program) {
+    return compile(program).html;
+}
+
+CompileResult JtmlTranspiler::compile(const std::vector<std::unique_ptr<ASTNode>>& program) {
+    OutputSink out;
+    CompileResult result;
+    result.bindings = compile(program, out);
+    result.html = out.take();
+    return result;
+}
+
+BindingTable JtmlTranspiler::compile(const std::vector<std::unique_ptr<ASTNode>>& program, std::ostream& target) {
+    OutputSink out(target);
+    BindingTable table = compile(program, out);
+    out.flush();
+    return table;
+}
+
+BindingTable JtmlTranspiler::compile(const std::vector<std::unique_ptr<ASTNode>>& program, OutputSink& out) {
     uniqueElemId = 0;
     uniqueVarId  = 0;
-    nodeID = 0; 
+    uniqueTemplateId = 0;
+    templateDepth = 0;
+    bindings.clear();
+    templates.clear();
+    openHoles.assign(1, {});
+    rowBodies.clear();
 
-    std::ostringstream out;
     out << "<!DOCTYPE html>\n<html>\n<head>\n"
         << "  <meta charset=\"utf-8\">\n"
         << "  <title>JTML Final Example</title>\n"
@@ -19,248 +112,436 @@ std::string JtmlTranspiler::transpile(const std::vector<std::unique_ptr<ASTNode>
 
     // Top-level statements => insideElement=false
     for (auto& node : program) {
-        out << transpileNode(*node, /*insideElement=*/false);
+        transpileNode(*node, /*insideElement=*/false, out);
+    }
+
+    // Branch and loop bodies, hoisted so nested ones stay addressable by id;
+    // their holes were recorded relative to the body and move with it
+    for (auto& tpl : templates) {
+        out << "<template id=\"" << tpl.id << "\">";
+        const size_t base = out.position();
+        for (BindingID id : tpl.holes) {
+            bindings[id].htmlOffset += base;
+        }
+        out << tpl.body << "</template>\n";
+    }
+    templates.clear();
+
+    // Binary frames address a binding by its slot index; the client
+    // resolves it to [elementId, attribute] through this table
+    out << "\n  <script>\n        const bindingTargets = [";
+    for (size_t i = 0; i < bindings.size(); ++i) {
+        if (i > 0) out << ",";
+        out << "[\"" << escapeJS(bindings[i].elementId) << "\"";
+        if (!bindings[i].attribute.empty()) {
+            out << ",\"" << escapeJS(bindings[i].attribute) << "\"";
+        }
+        out << "]";
     }
+    out << "];\n  </script>";
 
     out << generateScriptBlock();
     out << "\n</body>\n</html>\n";
-    return out.str();
+
+    BindingTable table = std::move(bindings);
+    bindings.clear();
+    return table;
+}
+
+//--------------------------------------------------
+// Emit a branch/loop body as a <template>; returns its id
+//--------------------------------------------------
+std::string JtmlTranspiler::transpileTemplate(const std::vector<std::unique_ptr<ASTNode>>& body) {
+    std::string id = "tpl_" + std::to_string(++uniqueTemplateId);
+
+    OutputSink bodySink;
+    openHoles.emplace_back();
+    for (auto& stmt : body) {
+        transpileNode(*stmt, /*insideElement=*/true, bodySink);
+    }
+
+    PendingTemplate tpl;
+    tpl.id = id;
+    tpl.body = bodySink.take();
+    tpl.holes = std::move(openHoles.back());
+    openHoles.pop_back();
+    templates.push_back(std::move(tpl));
+    return id;
+}
+
+//--------------------------------------------------
+// Record a reactive hole (skipped inside loop bodies)
+//--------------------------------------------------
+BindingSlot* JtmlTranspiler::addSlot(BindingKind kind, const std::string& name, const std::string& elementId,
+                                     const ExpressionStatementNode* expr,
+                                     const std::string& attribute, const std::string& iteratorName) {
+    if (templateDepth > 0 || !expr) {
+        return nullptr;
+    }
+    BindingSlot slot;
+    slot.kind = kind;
+    slot.name = name;
+    slot.elementId = elementId;
+    slot.attribute = attribute;
+    slot.iteratorName = iteratorName;
+    slot.expression = expr->clone();
+    bindings.push_back(std::move(slot));
+    return &bindings.back();
+}
+
+//--------------------------------------------------
+// The hole's value goes at the sink's current position
+// (relative to the enclosing template body until it is placed)
+//--------------------------------------------------
+void JtmlTranspiler::markHole(BindingSlot* slot, const OutputSink& out, size_t length) {
+    if (!slot) {
+        return;
+    }
+    slot->htmlOffset = out.position();
+    slot->htmlLength = length;
+    openHoles.back().push_back(static_cast<BindingID>(slot - bindings.data()));
+}
+
+//--------------------------------------------------
+// A hole of a for body, evaluated per row by the interpreter
+//--------------------------------------------------
+int JtmlTranspiler::addRowHole(BindingKind kind, const ExpressionStatementNode* expr, const std::string& attribute) {
+    if (!expr || rowBodies.empty() || rowBodies.back().depth != openHoles.size()) {
+        return -1;
+    }
+    RowHole hole;
+    hole.kind = kind;
+    hole.attribute = attribute;
+    hole.expression = expr->clone();
+    rowBodies.back().holes.push_back(std::move(hole));
+    return static_cast<int>(rowBodies.back().holes.size() - 1);
+}
+
+//--------------------------------------------------
+// Server-side rendering of current values
+//--------------------------------------------------
+std::string JtmlTranspiler::render(const std::string& html, const BindingTable& table,
+                                   const std::function<bool(BindingID, std::string&)>& valueOf) {
+    std::string out;
+    out.reserve(html.size() + html.size() / 4);
+
+    // Mark the page so the client skips its initial sync request
+    size_t cursor = 0;
+    const std::string htmlTag = "<html>";
+    size_t tagPos = html.find(htmlTag);
+    if (tagPos != std::string::npos) {
+        out.append(html, 0, tagPos);
+        out += "<html data-jtml-ssr>";
+        cursor = tagPos + htmlTag.size();
+    }
+
+    // Template bodies are placed after the content they belong to, so slot
+    // order is not page order
+    std::vector<std::pair<size_t, BindingID>> holes;
+    for (BindingID id = 0; id < table.size(); ++id) {
+        if (table[id].htmlOffset != std::string::npos) {
+            holes.emplace_back(table[id].htmlOffset, id);
+        }
+    }
+    std::sort(holes.begin(), holes.end());
+
+    std::string value;
+    for (const auto& [offset, id] : holes) {
+        const BindingSlot& slot = table[id];
+        if (offset < cursor) {
+            continue;
+        }
+        if (!valueOf(id, value)) {
+            continue;
+        }
+        out.append(html, cursor, slot.htmlOffset - cursor);
+        if (slot.kind == BindingKind::Content) {
+            out += escapeHTML(value);
+        } else if (slot.kind == BindingKind::Attribute) {
+            out += " " + slot.attribute + "=\"" + escapeHTML(value) + "\"";
+        } else {
+            // if/for hosts: the client instantiates their template on load
+            out += " data-jtml-value=\"" + escapeHTML(value) + "\"";
+        }
+        cursor = slot.htmlOffset + slot.htmlLength;
+    }
+    out.append(html, cursor, std::string::npos);
+    return out;
+}
+
+std::string JtmlTranspiler::withWebSocketPort(const std::string& html, uint16_t port) {
+    // The client reads the port off the root element
+    const std::string htmlTag = "<html";
+    size_t tagPos = html.find(htmlTag);
+    if (tagPos == std::string::npos) {
+        return html;
+    }
+    std::string out = html;
+    out.insert(tagPos + htmlTag.size(), " data-jtml-ws-port=\"" + std::to_string(port) + "\"");
+    return out;
 }
 
 //--------------------------------------------------
 // Distinguish node type and top-level vs. inside-element
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileNode(const ASTNode& node, bool insideElement) {
+void JtmlTranspiler::transpileNode(const ASTNode& node, bool insideElement, OutputSink& out) {
     switch (node.getType()) {
     case ASTNodeType::JtmlElement:
         // For an element, we always do transpileElement
-        return transpileElement(static_cast<const JtmlElementNode&>(node));
+        transpileElement(static_cast<const JtmlElementNode&>(node), out);
+        break;
 
     case ASTNodeType::IfStatement: {
         const auto& ifNode = static_cast<const IfStatementNode&>(node);
-        return insideElement ? 
-            transpileIfInsideElement(ifNode) :
-            transpileIfTopLevel(ifNode);
+        if (insideElement) transpileIfInsideElement(ifNode, out);
+        else transpileIfTopLevel(ifNode, out);
+        break;
     }
     case ASTNodeType::ForStatement: {
         const auto& forNode = static_cast<const ForStatementNode&>(node);
-        return insideElement ? 
-            transpileForInsideElement(forNode) :
-            transpileForTopLevel(forNode);
+        if (insideElement) transpileForInsideElement(forNode, out);
+        else transpileForTopLevel(forNode, out);
+        break;
     }
     case ASTNodeType::WhileStatement: {
         const auto& whileNode = static_cast<const WhileStatementNode&>(node);
-        return insideElement ?
-            transpileWhileInsideElement(whileNode) :
-            transpileWhileTopLevel(whileNode);
+        if (insideElement) transpileWhileInsideElement(whileNode, out);
+        else transpileWhileTopLevel(whileNode, out);
+        break;
     }
     case ASTNodeType::ShowStatement:
-        return transpileShow(static_cast<const ShowStatementNode&>(node));
+        transpileShow(static_cast<const ShowStatementNode&>(node), out);
+        break;
 
     // For define, function, class, etc. we might produce minimal placeholders
     // or skip
     default:
-        return "<!-- " + node.toString() + " not explicitly transpiled. -->\n";
+        out << "<!-- " << node.toString() << " not explicitly transpiled. -->\n";
     }
 }
 
 //--------------------------------------------------
 // Transpile an element (with attributes + content)
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileElement(const JtmlElementNode& elem) {
+void JtmlTranspiler::transpileElement(const JtmlElementNode& elem, OutputSink& out) {
     ++uniqueElemId;
-    nodeID++;
     std::string domId = "elem_" + std::to_string(uniqueElemId);
 
-    std::ostringstream out;
-    out << "<" << elem.tagName << " id=\"" << domId << "\"";
+    // A constant id attribute becomes the element's DOM id
+    bool explicitId = false;
+    for (auto& attr : elem.attributes) {
+        StaticValue idVal;
+        if (attr.key == "id" && foldStatic(attr.value.get(), idVal)) {
+            domId = idVal.text;
+            explicitId = true;
+        }
+    }
+
+    // A generated id in a loop body would repeat on every iteration
+    out << "<" << elem.tagName;
+    if (explicitId || templateDepth == 0) {
+        out << " id=\"";
+        out.writeText(domId);
+        out << "\"";
+    }
 
     // Transpile attributes, adding reactivity for expressions
     for (auto& attr : elem.attributes) {
-        std::string valStr = attr.value->toString();
+        StaticValue constVal;
             
        if (attr.key == "onClick" || attr.key == "onInput" || attr.key == "onMouseOver" || attr.key == "onScroll") {
             ++uniqueVarId;
             std::string derivedVarName = "attr_" + std::to_string(uniqueVarId);
 
-            // Store in nodeDerivedMap
-            nodeDerivedMap[nodeID][attr.key] = derivedVarName;
+            // The client sends the derived name back as the event's elementId
+            if (BindingSlot* slot = addSlot(BindingKind::Event, derivedVarName, derivedVarName, attr.value.get(), attr.key)) {
+                slot->eventPolicy = attr.policy;
+            }
             // Ensure that the attribute value represents the JTML function or handler
             std::string functionCall = escapeJS(attr.value->toString());
 
             // Handle special cases for events with arguments (e.g., onInput, onScroll)
-            std::ostringstream args;
+            std::string args;
             if (attr.key == "onInput") {
-                args << ", event.target.value"; // Pass the input value as an argument
+                args = ", event.target.value"; // Pass the input value as an argument
             } else if (attr.key == "onScroll") {
-                args << ", 'window.scrollY'"; // Pass the scroll position as an argument
+                args = ", 'window.scrollY'"; // Pass the scroll position as an argument
             }
 
             // Generate the event handler
-            out << " " << attr.key << "=\"sendEvent('" << derivedVarName << "', '" << attr.key << "', ['" << functionCall << "'" << args.str() << "])\"";
+            out << " " << attr.key << "=\"sendEvent('" << derivedVarName << "', '" << attr.key << "', ['" << functionCall << "'" << args << "])\"";
         
+        } else if (foldStatic(attr.value.get(), constVal)) {
+            // Constant => inline it, no derived variable or binding
+            if (attr.key != "id") {
+                out << " " << attr.key << "=\"";
+                out.writeText(constVal.text);
+                out << "\"";
+            }
+        } else if (int rowHole = addRowHole(BindingKind::Attribute, attr.value.get(), attr.key); rowHole >= 0) {
+            // Set per row from the row's value
+            out << " data-jtml-hole-" << attr.key << "=\"" << std::to_string(rowHole) << "\"";
         } else {
             ++uniqueVarId;
             std::string derivedVarName = "attr_" + std::to_string(uniqueVarId);
 
-            // Store in nodeDerivedMap
-            nodeDerivedMap[nodeID][attr.key] = derivedVarName;
+            BindingSlot* slot = addSlot(BindingKind::Attribute, derivedVarName, domId, attr.value.get(), attr.key);
 
             // Add a data attribute for the front-end to identify
             out << " data-jtml-attr-" << attr.key << "=\"" << derivedVarName << "\"";
+            markHole(slot, out, 0);
         }
     }
 
     out << ">";
     // Child statements => insideElement=true
-    out << transpileChildren(elem.content, /*insideElement=*/true);
+    transpileChildren(elem.content, /*insideElement=*/true, out);
     out << "</" << elem.tagName << ">\n";
-
-    return out.str();
 }
 
 //--------------------------------------------------
 // If top-level => minimal or comment
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileIfTopLevel(const IfStatementNode& node) {
-    return "<!-- IfStatement at top-level: server logic only -->\n";
+void JtmlTranspiler::transpileIfTopLevel(const IfStatementNode& node, OutputSink& out) {
+    out << "<!-- IfStatement at top-level: server logic only -->\n";
 }
 
 //--------------------------------------------------
 // If inside an element => data-jtml-if
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileIfInsideElement(const IfStatementNode& node) {
+void JtmlTranspiler::transpileIfInsideElement(const IfStatementNode& node, OutputSink& out) {
     ++uniqueVarId;
-    nodeID++;
     std::string condName = "cond_" + std::to_string(uniqueVarId);
-    nodeDerivedMap[nodeID]["if"] = condName;
-
-    // transpile "then" block
-    std::ostringstream thenSS;
-    for (auto& stmt : node.thenStatements) {
-        thenSS << transpileNode(*stmt, /*insideElement=*/true);
-    }
-    std::string thenHTML = escapeHTML(thenSS.str());
+    BindingSlot* slot = addSlot(BindingKind::If, condName, condName, node.condition.get());
+    const BindingID slotId = slot ? static_cast<BindingID>(slot - bindings.data()) : 0;
 
-    // transpile "else" block
-    std::string elseHTML;
-    if (!node.elseStatements.empty()) {
-        std::ostringstream elseSS;
-        for (auto& stmt : node.elseStatements) {
-            elseSS << transpileNode(*stmt, /*insideElement=*/true);
-        }
-        elseHTML = escapeHTML(elseSS.str());
-    }
+    // Branches become <template>s; the host references them by id
+    std::string thenId = transpileTemplate(node.thenStatements);
+    std::string elseId = node.elseStatements.empty() ? "" : transpileTemplate(node.elseStatements);
 
-    std::ostringstream out;
-    out << "<div data-jtml-if=\"" << condName << "\" "
-        << "data-then=\"" << thenHTML << "\" "
-        << "data-else=\"" << elseHTML << "\">"
+    out << "<div id=\"" << condName << "\" data-jtml-if=\"" << condName << "\" "
+        << "data-then=\"" << thenId << "\" "
+        << "data-else=\"" << elseId << "\"";
+    markHole(slot ? &bindings[slotId] : nullptr, out, 0);
+    out << ">"
         << "</div>\n";
-
-    return out.str();
 }
 
 //--------------------------------------------------
 // For top-level => minimal
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileForTopLevel(const ForStatementNode& node) {
-    return "<!-- ForStatement at top-level: server logic only -->\n";
+void JtmlTranspiler::transpileForTopLevel(const ForStatementNode& node, OutputSink& out) {
+    out << "<!-- ForStatement at top-level: server logic only -->\n";
 }
 
 //--------------------------------------------------
 // For inside element => data-jtml-for
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileForInsideElement(const ForStatementNode& node) {
+void JtmlTranspiler::transpileForInsideElement(const ForStatementNode& node, OutputSink& out) {
     // 1) Generate a unique name for the loop's iterable (to store in the environment or for the front-end)
     ++uniqueVarId;
-    nodeID++;
     std::string rangeName = "range_" + std::to_string(uniqueVarId);
 
-    // 2) Register in nodeDerivedMap
-    //    "for" => the derived variable for the iterable
-    //    "iteratorName" => node.iteratorName
-    nodeDerivedMap[nodeID]["for"] = rangeName;
-    nodeDerivedMap[nodeID]["iteratorName"] = node.iteratorName;
-
-    // 3) Transpile the loop body statements
-    std::ostringstream bodyStream;
-    for (auto& stmt : node.body) {
-        // Recursively transpile each child statement inside the loop
-        bodyStream << transpileNode(*stmt, /*insideElement=*/true);
+    // 2) Register the iterable's slot (the iterator name rides along)
+    BindingSlot* slot = addSlot(BindingKind::For, rangeName, rangeName, node.iterableExpression.get(), "", node.iteratorName);
+    const BindingID slotId = slot ? static_cast<BindingID>(slot - bindings.data()) : 0;
+    if (slot) {
+        slot->windowSize = node.windowSize;
     }
-    std::string escapedBody = escapeHTML(bodyStream.str());
 
-    // 4) Produce final HTML with data-jtml-for and data-jtml-iterator
-    std::ostringstream out;
-    out << "<div data-jtml-for=\"" << rangeName 
-        << "\" data-jtml-iterator=\"" << node.iteratorName
-        << "\" data-body=\"" << escapedBody << "\"></div>\n";
+    // 3) The loop body becomes a <template> cloned once per item; what it
+    //    shows of the item is filled into each clone from the row's value
+    ++templateDepth;
+    rowBodies.push_back({ openHoles.size() + 1, {} });
+    std::string bodyId = transpileTemplate(node.body);
+    std::vector<RowHole> rowHoles = std::move(rowBodies.back().holes);
+    rowBodies.pop_back();
+    --templateDepth;
 
-    return out.str();
+    // 4) Produce the host with data-jtml-for and data-jtml-iterator
+    out << "<div id=\"" << rangeName << "\" data-jtml-for=\"" << rangeName 
+        << "\" data-jtml-iterator=\"" << node.iteratorName
+        << "\" data-body=\"" << bodyId << "\"";
+    if (node.windowSize > 0) {
+        out << " data-jtml-window=\"" << std::to_string(node.windowSize) << "\"";
+    }
+    if (slot && !rowHoles.empty()) {
+        out << " data-jtml-row-holes";
+        bindings[slotId].rowHoles = std::move(rowHoles);
+    }
+    markHole(slot ? &bindings[slotId] : nullptr, out, 0);
+    out << "></div>\n";
 }
 
 //--------------------------------------------------
 // While top-level => minimal
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileWhileTopLevel(const WhileStatementNode& node) {
-    return "<!-- WhileStatement at top-level: server logic only -->\n";
+void JtmlTranspiler::transpileWhileTopLevel(const WhileStatementNode& node, OutputSink& out) {
+    out << "<!-- WhileStatement at top-level: server logic only -->\n";
 }
 
 //--------------------------------------------------
 // While inside element => data-jtml-while
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileWhileInsideElement(const WhileStatementNode& node) {
+void JtmlTranspiler::transpileWhileInsideElement(const WhileStatementNode& node, OutputSink& out) {
     ++uniqueVarId;
-    nodeID++;
     std::string condName = "cond_" + std::to_string(uniqueVarId);
 
-    nodeDerivedMap[nodeID]["while"] = condName;
+    addSlot(BindingKind::While, condName, condName, node.condition.get());
 
-    std::ostringstream bodySS;
-    for (auto& stmt : node.body) {
-        bodySS << transpileNode(*stmt, /*insideElement=*/true);
-    }
-    std::string bodyHTML = escapeHTML(bodySS.str());
+    ++templateDepth;
+    std::string bodyId = transpileTemplate(node.body);
+    --templateDepth;
 
-    std::ostringstream out;
-    out << "<div data-jtml-while=\"" << condName << "\" "
-        << "data-body=\"" << bodyHTML << "\">"
+    out << "<div id=\"" << condName << "\" data-jtml-while=\"" << condName << "\" "
+        << "data-body=\"" << bodyId << "\">"
         << "</div>\n";
-    return out.str();
 }
 
 //--------------------------------------------------
 // Show => produce placeholders
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileShow(const ShowStatementNode& node) {
+void JtmlTranspiler::transpileShow(const ShowStatementNode& node, OutputSink& out) {
     if(!node.expr) {
-        return "<p><!-- show with no expr? --></p>\n";
+        out << "<p><!-- show with no expr? --></p>\n";
+        return;
+    }
+    StaticValue constVal;
+    if (foldStatic(node.expr.get(), constVal)) {
+        // Constant => render the text now, nothing for the interpreter to track
+        out << "<div>";
+        out.writeText(constVal.text);
+        out << "</div>\n";
+        return;
     }
+    // produce placeholder
+    // e.g. <p>{{someExpr}}</p>
+    std::string placeholder = escapeHTML("{{" + node.expr->toString() + "}}");
+
+    // In a for body: filled per row from the row's value
+    int rowHole = addRowHole(BindingKind::Content, node.expr.get());
+    if (rowHole >= 0) {
+        out << "<div data-jtml-hole=\"" << std::to_string(rowHole) << "\">" << placeholder << "</div>\n";
+        return;
+    }
+
     ++uniqueVarId;
-    nodeID++;
     std::string exprVarName = "expr_" + std::to_string(uniqueVarId);
 
-    nodeDerivedMap[nodeID]["show"] = exprVarName;
+    BindingSlot* slot = addSlot(BindingKind::Content, exprVarName, exprVarName, node.expr.get());
 
-    // produce placeholder
-    // e.g. <p>{{someExpr}}</p>
-    std::string placeholder = "{{" + node.expr->toString() + "}}";
-
-    std::ostringstream out;
-    out << "<div id=\""<< exprVarName << "\">" << placeholder << "</div>\n";
-    return out.str();
+    out << "<div id=\""<< exprVarName << "\">";
+    markHole(slot, out, placeholder.size());
+    out << placeholder << "</div>\n";
 }
 
 //--------------------------------------------------
 // Helper to transpile a list of child statements
 //--------------------------------------------------
-std::string JtmlTranspiler::transpileChildren(const std::vector<std::unique_ptr<ASTNode>>& children, bool insideElement) {
-    std::ostringstream out;
+void JtmlTranspiler::transpileChildren(const std::vector<std::unique_ptr<ASTNode>>& children, bool insideElement, OutputSink& out) {
     for (auto& c : children) {
-        out << transpileNode(*c, insideElement);
+        transpileNode(*c, insideElement, out);
     }
-    return out.str();
 }
 
 //--------------------------------------------------
@@ -269,81 +550,583 @@ std::string JtmlTranspiler::transpileChildren(const std::vector<std::unique_ptr<
 std::string JtmlTranspiler::generateScriptBlock() {
     return R"(
   <script>
-        const ws = new WebSocket('ws://localhost:8080');
+        let ws = null;
+        const utf8 = new TextDecoder();
+
+        // Journal position of the state on screen; a reconnect resumes from it
+        let serverEpoch = '';
+        let lastVersion = 0;
+        let connectedBefore = false;
+
+        // Version each binding was last set at, keyed like the server's
+        // conflation keys: replies to this client's own events can overtake
+        // other updates, so a value older than the one shown is skipped (as
+        // is one older than the last snapshot)
+        let seenVersions = {};
+        let snapshotVersion = 0;
+        function isCurrent(key, version) {
+            if (version === undefined) return true;
+            if (version < snapshotVersion || seenVersions[key] > version) return false;
+            seenVersions[key] = version;
+            return true;
+        }
+
+        // Changes can overtake the snapshot asked for, and build on state
+        // this client may not have yet: between asking and getting it (or a
+        // resume) they are held, then replayed if the state is older
+        let syncPending = false;
+        let heldChanges = [];
+        let heldFrames = [];
+        function requestSync(request) {
+            syncPending = true;
+            heldChanges = [];
+            heldFrames = [];
+            ws.send(JSON.stringify(request));
+        }
+
+        function endSync() {
+            const frames = heldFrames;
+            syncPending = false;
+            heldChanges = [];
+            heldFrames = [];
+            // Binary records only set values, each skipped unless newer
+            frames.forEach(applyBinaryFrame);
+            sendInterest();
+        }
 
-        ws.onopen = () => {
+        // Binary framing when the server agrees to it, JSON text otherwise
+        function connect() {
+            const port = document.documentElement.getAttribute('data-jtml-ws-port') || '8080';
+            ws = new WebSocket('ws://' + (location.hostname || 'localhost') + ':' + port, ['jtml.bin.v1', 'jtml.json']);
+            ws.binaryType = 'arraybuffer';
+            ws.onopen = onOpen;
+            ws.onmessage = onMessage;
+            ws.onclose = () => {
+                console.log('WebSocket connection closed.');
+                // Spread reconnects out so a restart is not hit all at once
+                setTimeout(connect, 500 + Math.random() * 2000);
+            };
+        }
+
+        function onOpen() {
             console.log('WebSocket connection established.');
-        };
+            // A server-rendered page already shows current values on its first
+            // connect; otherwise ask for them, or for what was missed since
+            chunkStreams = {};
+            shownSlots = new Set();
+            interestDeclared = false;
+            if (connectedBefore || !document.documentElement.hasAttribute('data-jtml-ssr')) {
+                requestSync(serverEpoch
+                    ? { type: 'sync', epoch: serverEpoch, version: lastVersion }
+                    : { type: 'sync' });
+            } else {
+                sendInterest();
+            }
+            connectedBefore = true;
+            document.querySelectorAll('[data-jtml-window]').forEach((host) => { host._jtmlViewport = ''; });
+            reportViewports();
+        }
+
+        // Last values seen, re-applied to freshly cloned template content
+        const knownContent = {};
+        const knownAttributes = {};
+
+        function setContent(elementId, value) {
+            knownContent[elementId] = value;
+            const elem = document.getElementById(elementId);
+            if (elem) {
+                elem.textContent = value;
+            }
+        }
+
+        // FNV-1a over UTF-16 code units, as the server hashes a splice's base
+        function textHash(text) {
+            let hash = 0x811c9dc5;
+            for (let i = 0; i < text.length; i++) {
+                hash ^= text.charCodeAt(i);
+                hash = Math.imul(hash, 0x01000193) >>> 0;
+            }
+            return hash;
+        }
+
+        // Edit long content in place; false if it is not the text the
+        // splice was made against
+        function spliceContent(elementId, at, remove, insert, length, base) {
+            const elem = document.getElementById(elementId);
+            const text = elementId in knownContent ? knownContent[elementId] : (elem ? elem.textContent : '');
+            if (text.length !== length || textHash(text) !== base) {
+                return false;
+            }
+            knownContent[elementId] = text.slice(0, at) + insert + text.slice(at + remove);
+            if (elem && elem.childNodes.length === 1 && elem.firstChild.nodeType === Node.TEXT_NODE) {
+                elem.firstChild.replaceData(at, remove, insert);
+            } else if (elem) {
+                elem.textContent = knownContent[elementId];
+            }
+            return true;
+        }
+
+        function setAttributeValue(elementId, attr, value) {
+            (knownAttributes[elementId] = knownAttributes[elementId] || {})[attr] = value;
+            const elem = document.getElementById(elementId);
+            if (elem) {
+                elem.setAttribute(attr, value);
+            }
+        }
+
+        function isTruthy(value) {
+            return value !== '' && value !== 'false' && value !== '0' && value !== 'undefined';
+        }
+
+        // Clone a <template> body and bring it up to date before inserting
+        function instantiate(templateId) {
+            const tpl = templateId ? document.getElementById(templateId) : null;
+            if (!tpl) {
+                return null;
+            }
+            const fragment = tpl.content.cloneNode(true);
+            for (const elem of fragment.querySelectorAll('[id]')) {
+                if (elem.id in knownContent) {
+                    elem.textContent = knownContent[elem.id];
+                }
+                for (const [attr, value] of Object.entries(knownAttributes[elem.id] || {})) {
+                    elem.setAttribute(attr, value);
+                }
+            }
+            hydrate(fragment);
+            return fragment;
+        }
+
+        function renderIf(host, value) {
+            const fragment = instantiate(isTruthy(value) ? host.dataset.then : host.dataset.else);
+            host.replaceChildren();
+            if (fragment) {
+                host.appendChild(fragment);
+            }
+            reportInterest();
+        }
+
+        // One row of a for-host: its body wrapped in a layout-neutral element
+        // carrying the row's key, so patches can find and move it
+        function makeRow(host, key, value) {
+            const row = document.createElement('div');
+            row.style.display = 'contents';
+            row.dataset.jtmlKey = key;
+            const fragment = instantiate(host.dataset.body);
+            if (fragment) {
+                row.appendChild(fragment);
+            }
+            fillRow(host, row, value);
+            return row;
+        }
+
+        // A row's value is what the body's holes show for its item (a JSON
+        // array, by hole index); hosts whose body shows none ignore it
+        function fillRow(host, row, value) {
+            if (!('jtmlRowHoles' in host.dataset)) {
+                return;
+            }
+            const holes = JSON.parse(value);
+            for (const elem of row.querySelectorAll('*')) {
+                for (const name of elem.getAttributeNames()) {
+                    if (name === 'data-jtml-hole') {
+                        elem.textContent = holes[elem.getAttribute(name)];
+                    } else if (name.startsWith('data-jtml-hole-')) {
+                        elem.setAttribute(name.slice('data-jtml-hole-'.length), holes[elem.getAttribute(name)]);
+                    }
+                }
+            }
+        }
+
+        function renderFor(host, list) {
+            host.replaceChildren(...list.items.map((value, i) => makeRow(host, list.keys[i], value)));
+            if (list.start !== undefined) {
+                placeWindow(host, list.start, list.total);
+            }
+            reportInterest();
+        }
+
+        // Windowed for-hosts hold only the rows around the viewport; padding
+        // stands in for the rest so the page scrolls as if all were there
+        function placeWindow(host, start, total) {
+            const pad = host._jtmlPad || { top: 0, bottom: 0 };
+            const rows = host.children.length;
+            const height = host.getBoundingClientRect().height - pad.top - pad.bottom;
+            if (rows > 0 && height > 0) {
+                host._jtmlRowHeight = height / rows;
+            }
+            const rowHeight = host._jtmlRowHeight || 0;
+            host._jtmlPad = { top: start * rowHeight, bottom: Math.max(0, total - start - rows) * rowHeight };
+            host.style.paddingTop = host._jtmlPad.top + 'px';
+            host.style.paddingBottom = host._jtmlPad.bottom + 'px';
+            reportViewport(host);
+        }
+
+        // Tell the server which rows of a windowed host are on screen
+        function reportViewport(host) {
+            if (!ws || ws.readyState !== WebSocket.OPEN) {
+                return;
+            }
+            // Until a row has been measured, ask for the first window
+            const rowHeight = host._jtmlRowHeight;
+            const top = host.getBoundingClientRect().top;
+            const first = rowHeight ? Math.floor(Math.max(0, -top) / rowHeight) : 0;
+            const count = rowHeight ? Math.ceil(window.innerHeight / rowHeight) + 1 : 0;
+            if (host._jtmlViewport === first + ':' + count) {
+                return;
+            }
+            host._jtmlViewport = first + ':' + count;
+            ws.send(JSON.stringify({ type: 'viewport', elementId: host.id, first: first, count: count }));
+        }
+
+        let viewportFrame = 0;
+        function reportViewports() {
+            if (!viewportFrame) {
+                viewportFrame = requestAnimationFrame(() => {
+                    viewportFrame = 0;
+                    document.querySelectorAll('[data-jtml-window]').forEach(reportViewport);
+                });
+            }
+        }
+        window.addEventListener('scroll', reportViewports, { passive: true });
+        window.addEventListener('resize', reportViewports);
+
+        // Slots whose element is on the page: the server sends changes for
+        // these only, and a slot's current value when it appears. Until the
+        // first report (sent once the page has its state) it sends everything.
+        let shownSlots = new Set();
+        let interestDeclared = false;
+        let interestFrame = 0;
+        function reportInterest() {
+            if (!interestFrame) {
+                interestFrame = requestAnimationFrame(() => {
+                    interestFrame = 0;
+                    sendInterest();
+                });
+            }
+        }
 
-        ws.onmessage = (event) => {
-            const message = JSON.parse(event.data);
+        function sendInterest() {
+            if (!ws || ws.readyState !== WebSocket.OPEN || (syncPending && !interestDeclared)) {
+                return;
+            }
+            const shown = new Set();
+            bindingTargets.forEach((target, slot) => {
+                if (document.getElementById(target[0])) shown.add(slot);
+            });
+            const add = [...shown].filter((slot) => !shownSlots.has(slot));
+            const remove = [...shownSlots].filter((slot) => !shown.has(slot));
+            shownSlots = shown;
+            if (add.length || remove.length || !interestDeclared) {
+                interestDeclared = true;
+                ws.send(JSON.stringify({ type: 'interest', add: add, remove: remove }));
+            }
+        }
+
+        // Keyed patch from the server: remove/detach from the back, then
+        // re-attach/insert from the front, reusing the detached rows' nodes
+        function applyListPatch(host, ops) {
+            const detached = {};
+            for (const [kind, index, arg, value] of ops) {
+                const rows = host.children;
+                if (kind === 'i' || kind === 'a') {
+                    const row = kind === 'i' ? makeRow(host, arg, value) : detached[arg];
+                    if (!row || index > rows.length) {
+                        return false;
+                    }
+                    host.insertBefore(row, rows[index] || null);
+                    continue;
+                }
+                const row = rows[index];
+                if (!row) {
+                    return false;
+                }
+                if (kind === 'd') {
+                    detached[row.dataset.jtmlKey] = row;
+                    row.remove();
+                } else if (kind === 'r') {
+                    row.remove();
+                } else if (kind === 'u') {
+                    fillRow(host, row, arg);
+                }
+            }
+            reportInterest();
+            return true;
+        }
+
+        // Server-rendered hosts carry their value; build their content
+        function hydrate(root) {
+            for (const host of root.querySelectorAll('[data-jtml-if][data-jtml-value]')) {
+                renderIf(host, host.getAttribute('data-jtml-value'));
+            }
+            for (const host of root.querySelectorAll('[data-jtml-for][data-jtml-value]')) {
+                renderFor(host, JSON.parse(host.getAttribute('data-jtml-value')));
+            }
+        }
+
+        // Apply if/for values; a host nested in another host's template only
+        // exists once its parent has been rendered, so retry until settled
+        function applyStructure(ifValues, forValues) {
+            const pending = [
+                ...Object.entries(ifValues || {}).map(([id, value]) => [id, (host) => renderIf(host, value)]),
+                ...Object.entries(forValues || {}).map(([id, list]) => [id, (host) => renderFor(host, list)])
+            ];
+            let progressed = true;
+            while (pending.length && progressed) {
+                progressed = false;
+                for (let i = pending.length - 1; i >= 0; i--) {
+                    const host = document.getElementById(pending[i][0]);
+                    if (host) {
+                        pending[i][1](host);
+                        pending.splice(i, 1);
+                        progressed = true;
+                    }
+                }
+            }
+        }
+
+        // Unsigned LEB128 at bytes[at.pos], advancing it
+        function readVarint(bytes, at) {
+            let value = 0;
+            let scale = 1;
+            let byte;
+            do {
+                byte = bytes[at.pos++];
+                value += (byte & 0x7f) * scale;
+                scale *= 128;
+            } while (byte & 0x80);
+            return value;
+        }
+
+        // A binary frame is a version record (opcode, varint version) and a
+        // run of records: opcode, varint binding id, varint byte length, UTF-8 value
+        function applyBinaryFrame(bytes) {
+            const at = { pos: 0 };
+            let version;
+            while (at.pos < bytes.length) {
+                const op = bytes[at.pos++];
+                if (op === 4) {
+                    version = readVarint(bytes, at);
+                    lastVersion = Math.max(lastVersion, version);
+                    continue;
+                }
+                if (op === 6) {
+                    ackedSeq = Math.max(ackedSeq, readVarint(bytes, at));
+                    continue;
+                }
+                const target = bindingTargets[readVarint(bytes, at)] || [];
+                const length = readVarint(bytes, at);
+                const value = utf8.decode(bytes.subarray(at.pos, at.pos + length));
+                at.pos += length;
+                if (op === 1) {
+                    if (isCurrent('c:' + target[0], version)) setContent(target[0], value);
+                } else if (op === 2) {
+                    if (isCurrent('a:' + target[0] + ':' + target[1], version)) setAttributeValue(target[0], target[1], value);
+                } else if (op === 3) {
+                    if (isCurrent('i:' + target[0], version)) applyStructure({ [target[0]]: value }, null);
+                }
+            }
+        }
+
+        // Pieces of chunked messages by stream, until the last one is in. A
+        // stream missing a piece (dropped for a slow connection) is given
+        // up; the server asks for a resync then anyway.
+        let chunkStreams = {};
+        function takeChunk(bytes) {
+            const at = { pos: 1 };
+            const stream = readVarint(bytes, at);
+            const index = readVarint(bytes, at);
+            const count = readVarint(bytes, at);
+            const binary = bytes[at.pos++] === 1;
+            if (index === 0) {
+                chunkStreams[stream] = [];
+            }
+            const parts = chunkStreams[stream];
+            if (!parts || parts.length !== index) {
+                delete chunkStreams[stream];
+                return null;
+            }
+            parts.push(bytes.subarray(at.pos));
+            if (parts.length < count) {
+                return null;
+            }
+            delete chunkStreams[stream];
+            const whole = new Uint8Array(parts.reduce((size, part) => size + part.length, 0));
+            let offset = 0;
+            for (const part of parts) {
+                whole.set(part, offset);
+                offset += part.length;
+            }
+            return { bytes: whole, binary: binary };
+        }
+
+        hydrate(document);
+
+        // Frames are handled strictly in arrival order, including the ones
+        // that have to be inflated first
+        let inbox = Promise.resolve();
+        function onMessage(event) {
+            inbox = inbox.then(() => handleFrame(event.data)).catch((error) => console.error(error));
+        }
+
+        async function handleFrame(data) {
+            if (typeof data !== 'string') {
+                const bytes = new Uint8Array(data);
+                if (bytes[0] === 7) {
+                    // Handled once the whole message is in
+                    const whole = takeChunk(bytes);
+                    if (whole) {
+                        await handleFrame(whole.binary ? whole.bytes.buffer : utf8.decode(whole.bytes));
+                    }
+                    return;
+                }
+                if (bytes[0] !== 5) {
+                    if (syncPending) {
+                        heldFrames.push(bytes);
+                    } else {
+                        applyBinaryFrame(bytes);
+                    }
+                    return;
+                }
+                // Deflated: one JSON message, compressed once on the server
+                const inflated = new Blob([bytes.subarray(1)]).stream().pipeThrough(new DecompressionStream('deflate'));
+                data = await new Response(inflated).text();
+            }
+            applyMessage(JSON.parse(data));
+        }
+
+        function applyMessage(message) {
             if (message.type === 'populateBindings') {
+                if (message.epoch !== serverEpoch) {
+                    lastVersion = 0;  // a new run counts from scratch
+                }
+                serverEpoch = message.epoch;
+                lastVersion = Math.max(lastVersion, message.version);
+                // Nothing shown is newer than the snapshot: what is, is held
+                seenVersions = {};
+                snapshotVersion = message.version;
+                const held = heldChanges;
                 const bindings = message.bindings;
+                // Remember values first so hosts instantiate up to date
+                for (const [elementId, value] of Object.entries(bindings.content || {})) {
+                    knownContent[elementId] = value;
+                }
+                for (const [elementId, attrs] of Object.entries(bindings.attributes || {})) {
+                    knownAttributes[elementId] = Object.assign(knownAttributes[elementId] || {}, attrs);
+                }
+                applyStructure(bindings.if, bindings.for);
                 // Handle content bindings
-                if (bindings.content) {
-                    for (const [elementId, value] of Object.entries(bindings.content)) {
-                        const elem = document.getElementById(elementId);
-                        if (elem) {
-                            elem.textContent = value;
-                        }
-                    }
+                for (const [elementId, value] of Object.entries(bindings.content || {})) {
+                    setContent(elementId, value);
                 }
                 // Handle attribute bindings
-                if (bindings.attributes) {
-                    for (const [elementId, attrs] of Object.entries(bindings.attributes)) {
-                        const elem = document.getElementById(elementId);
-                        if (elem) {
-                            for (const [attr, value] of Object.entries(attrs)) {
-                                elem.setAttribute(attr, value);
-                            }
-                        }
+                for (const [elementId, attrs] of Object.entries(bindings.attributes || {})) {
+                    for (const [attr, value] of Object.entries(attrs)) {
+                        setAttributeValue(elementId, attr, value);
                     }
                 }
+                endSync();
+                held.filter((change) => change.version > message.version).forEach(applyMessage);
+                return;
+            }
+            if (syncPending && message.version !== undefined) {
+                heldChanges.push(message);
+                return;
+            }
+            if (message.version !== undefined) {
+                lastVersion = Math.max(lastVersion, message.version);
+            }
+            if (message.type === 'resume') {
+                // What this client missed, which covers what was held
+                endSync();
+                message.updates.forEach(applyMessage);
             }
             else if (message.type === 'updateBinding') {
-                const elementId = message.elementId;
-                const value = message.value;
-                const elem = document.getElementById(elementId);
-                if (elem) {
-                    elem.textContent = value;
+                if (isCurrent('c:' + message.elementId, message.version)) {
+                    setContent(message.elementId, message.value);
                 }
-                if (message.type === 'attribute') {
-                    const elem = document.getElementById(binding.elementId);
-                    if (elem) {
-                        elem.setAttribute(binding.attribute, binding.value);
-                    }
+            }
+            else if (message.type === 'spliceBinding') {
+                // Out of step with the server: fetch every value again
+                if (isCurrent('c:' + message.elementId, message.version) &&
+                    !spliceContent(message.elementId, message.at, message.remove, message.insert,
+                                   message.length, message.base)) {
+                    requestSync({ type: 'sync' });
+                }
+            }
+            else if (message.type === 'updateAttribute') {
+                if (isCurrent('a:' + message.elementId + ':' + message.attribute, message.version)) {
+                    setAttributeValue(message.elementId, message.attribute, message.value);
+                }
+            }
+            else if (message.type === 'updateIf') {
+                if (isCurrent('i:' + message.elementId, message.version)) {
+                    applyStructure({ [message.elementId]: message.value }, null);
                 }
             }
-            else if (message.type === 'acknowledgment') {
-                console.log('Acknowledgment:', message.message);
+            else if (message.type === 'updateFor') {
+                applyStructure(null, { [message.elementId]: message.list });
+            }
+            else if (message.type === 'patchFor') {
+                const host = document.getElementById(message.elementId);
+                // Out of step with the server: fetch every value again
+                if (host && !applyListPatch(host, message.ops)) {
+                    requestSync({ type: 'sync' });
+                } else if (host && message.start !== undefined) {
+                    placeWindow(host, message.start, message.total);
+                }
+            }
+            else if (message.type === 'resync') {
+                // The server dropped updates this client was too slow for
+                requestSync({ type: 'sync' });
+            }
+            else if (message.type === 'batch') {
+                // The reply to our eventBatch (with its ack), or the changes
+                // another client's batch made
+                if (message.ack !== undefined) {
+                    ackedSeq = Math.max(ackedSeq, message.ack);
+                }
+                message.updates.forEach(applyMessage);
             }
             else if (message.type === 'error') {
                 console.error('Error from server:', message.error);
             }
-        };
+        }
+
+        connect();
 
-        ws.onclose = () => {
-            console.log('WebSocket connection closed.');
-        };
+        // Events are numbered and go out once per animation frame as one
+        // eventBatch; the server handles a batch as one transaction and
+        // acks the last event in its reply (nextSeq - 1 - ackedSeq are in flight)
+        let nextSeq = 1;
+        let ackedSeq = 0;
+        let queuedEvents = [];
+        let flushRequested = false;
 
-        // Function to send events to the server
         function sendEvent(elementId, eventType, args = []) {
             // Check if WebSocket connection is open
-            if (ws && ws.readyState === WebSocket.OPEN) {
-                const message = {
-                    type: 'event',
-                    elementId: elementId,
-                    eventType: eventType,
-                    args: args
-                };
-                try {
-                    ws.send(JSON.stringify(message));
-                    console.log(`[DEBUG] Sent event: ${JSON.stringify(message)}`);
-                } catch (error) {
-                    console.error(`[ERROR] Failed to send event: ${error.message}`);
-                }
-            } else {
+            if (!ws || ws.readyState !== WebSocket.OPEN) {
                 console.error(`[ERROR] WebSocket is not open. Event not sent: ElementID=${elementId}, EventType=${eventType}`);
+                return;
+            }
+            queuedEvents.push({ seq: nextSeq++, elementId: elementId, eventType: eventType, args: args });
+            if (!flushRequested) {
+                flushRequested = true;
+                requestAnimationFrame(flushEvents);
+            }
+        }
+
+        function flushEvents() {
+            flushRequested = false;
+            const events = queuedEvents;
+            queuedEvents = [];
+            if (!events.length || !ws || ws.readyState !== WebSocket.OPEN) {
+                return;
+            }
+            try {
+                ws.send(JSON.stringify({ type: 'eventBatch', events: events }));
+            } catch (error) {
+                console.error(`[ERROR] Failed to send events: ${error.message}`);
             }
         }
 
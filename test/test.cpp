@@ -8,6 +8,9 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <set>
+#include <thread>
 
 // Helper function to capture interpreter output
 std::string runInterpreter(const std::string& code) {
@@ -599,3 +602,892 @@ TEST(InterpreterTests, SimpleIfElse) {
     EXPECT_NE(output.find("[SHOW] Less than 5"), std::string::npos);
     EXPECT_EQ(output.find("[SHOW] Greater or equal 5"), std::string::npos);
 }
+
+TEST(ParserTests, StreamingParserMatchesTokenVector) {
+    std::string code = R"JTML(
+        define items = [1, 2, 3]\\
+        derive total = items.size() * 2\\
+        for (i in items)\\
+            show "Item: " + i\\
+        \\
+    )JTML";
+
+    Lexer vectorLexer(code);
+    Parser vectorParser(vectorLexer.tokenize());
+    auto expected = vectorParser.parseProgram();
+
+    Lexer streamLexer(code);
+    Parser streamParser(streamLexer);
+    auto actual = streamParser.parseProgram();
+
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i]->toString(), actual[i]->toString());
+    }
+    EXPECT_TRUE(streamLexer.getErrors().empty());
+}
+
+TEST(ParserTests, PowerOperatorPrecedence) {
+    std::string code = R"JTML(define p = -2 ^ 3 ^ 2 * 4\\)JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto ast = parser.parseProgram();
+    ASSERT_EQ(ast.size(), 1u);
+    // '^' is right-associative, binds tighter than unary minus and '*'
+    EXPECT_NE(ast[0]->toString().find("((- (2.000000000000000 ^ (3.000000000000000 ^ 2.000000000000000))) * 4.000000000000000)"),
+              std::string::npos);
+}
+
+TEST(ParserTests, ImportStatementAlias) {
+    std::string code = R"JTML(
+        import "widgets/buttons.jtml"\\
+        import "shared/util.jtml" as u\\
+    )JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto ast = parser.parseProgram();
+    ASSERT_EQ(ast.size(), 2u);
+    ASSERT_EQ(ast[0]->getType(), ASTNodeType::ImportStatement);
+    const auto& first = static_cast<const ImportStatementNode&>(*ast[0]);
+    const auto& second = static_cast<const ImportStatementNode&>(*ast[1]);
+    EXPECT_EQ(first.modulePath, "widgets/buttons.jtml");
+    EXPECT_EQ(first.alias, "buttons");
+    EXPECT_EQ(second.alias, "u");
+    EXPECT_TRUE(parser.getErrors().empty());
+}
+
+TEST(TranspilerTests, CompileEmitsBindingTable) {
+    std::string code = R"JTML(
+        define x = 3\\
+        element div class=x onClick=inc()\\
+            show x * 2\\
+            if (x > 2)\\
+                show "big"\\
+            \\
+        #
+    )JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    JtmlTranspiler compiler;
+    CompileResult result = compiler.compile(program);
+
+    // One slot per reactive hole, in emission order; the slot index is the
+    // binding ID. The constant show "big" is inlined and gets no slot.
+    ASSERT_EQ(result.bindings.size(), 4u);
+    EXPECT_EQ(result.bindings[0].kind, BindingKind::Attribute);
+    EXPECT_EQ(result.bindings[0].elementId, "elem_1");
+    EXPECT_EQ(result.bindings[0].attribute, "class");
+    EXPECT_EQ(result.bindings[1].kind, BindingKind::Event);
+    EXPECT_EQ(result.bindings[2].kind, BindingKind::Content);
+    EXPECT_EQ(result.bindings[2].name, "expr_3");
+    EXPECT_EQ(result.bindings[3].kind, BindingKind::If);
+    EXPECT_NE(result.html.find("<div id=\"expr_3\">"), std::string::npos);
+}
+
+TEST(TranspilerTests, ConstantAttributesAndShowAreInlined) {
+    std::string code = R"JTML(
+        element div id="panel" style="display: grid;" title="n=" + 2\
+            show "Sidebar"\
+            show 1 + 2\
+        #
+    )JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    JtmlTranspiler compiler;
+    CompileResult result = compiler.compile(program);
+
+    EXPECT_TRUE(result.bindings.empty());
+    EXPECT_NE(result.html.find("<div id=\"panel\" style=\"display: grid;\" title=\"n=2\">"), std::string::npos);
+    EXPECT_NE(result.html.find("<div>Sidebar</div>"), std::string::npos);
+    EXPECT_NE(result.html.find("<div>3</div>"), std::string::npos);
+}
+
+TEST(TranspilerTests, RenderSplicesCurrentValues) {
+    std::string code = R"JTML(
+        define x = 3\\
+        element div class=x\\
+            show x * 2\\
+        #
+    )JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    JtmlTranspiler compiler;
+    CompileResult result = compiler.compile(program);
+    ASSERT_EQ(result.bindings.size(), 2u);
+
+    std::string page = compiler.render(result.html, result.bindings,
+        [](BindingID id, std::string& value) {
+            value = (id == 0) ? "big<&>" : "6";
+            return true;
+        });
+    EXPECT_NE(page.find("<html data-jtml-ssr>"), std::string::npos);
+    EXPECT_NE(page.find("data-jtml-attr-class=\"attr_1\" class=\"big&lt;&amp;&gt;\""), std::string::npos);
+    EXPECT_NE(page.find("<div id=\"expr_2\">6</div>"), std::string::npos);
+    EXPECT_EQ(page.find("{{"), std::string::npos);
+}
+
+TEST(TranspilerTests, OutputSinkEscapesText) {
+    OutputSink out;
+    out << "<a>";
+    out.writeText("<b>&\"'");
+    out << "</a>";
+    // Markup as is, text with the same entities as escapeHTML
+    EXPECT_EQ(out.take(), "<a>&lt;b&gt;&amp;&quot;&#39;</a>");
+}
+
+TEST(TranspilerTests, StreamingCompileMatchesStringCompile) {
+    std::string code = R"JTML(
+        define x = 1\\
+        element div class=x\\
+            if (x > 0)\\
+                show "a < b"\\
+            \\
+            show x\\
+        #
+    )JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    JtmlTranspiler compiler;
+    CompileResult inMemory = compiler.compile(program);
+
+    std::ostringstream streamed;
+    BindingTable table = compiler.compile(program, streamed);
+
+    EXPECT_EQ(streamed.str(), inMemory.html);
+    ASSERT_EQ(table.size(), inMemory.bindings.size());
+    for (size_t i = 0; i < table.size(); ++i) {
+        EXPECT_EQ(table[i].htmlOffset, inMemory.bindings[i].htmlOffset);
+    }
+}
+
+TEST(TranspilerTests, BranchBodiesBecomeTemplates) {
+    std::string code = R"JTML(
+        define x = 3\\
+        element div\\
+            if (x > 2)\\
+                show "a & b"\\
+                if (x > 5)\\
+                    show x\\
+                \\
+            \\
+        #
+    )JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    JtmlTranspiler compiler;
+    CompileResult result = compiler.compile(program);
+
+    // Hosts reference hoisted templates; bodies are escaped once, not per level
+    EXPECT_NE(result.html.find("data-jtml-if=\"cond_1\" data-then=\"tpl_1\""), std::string::npos);
+    EXPECT_NE(result.html.find("<template id=\"tpl_1\"><div>a &amp; b</div>"), std::string::npos);
+    EXPECT_NE(result.html.find("<template id=\"tpl_2\">"), std::string::npos);
+    EXPECT_EQ(result.html.find("&amp;amp;"), std::string::npos);
+
+    // Holes inside templates still have page offsets for SSR
+    ASSERT_EQ(result.bindings.size(), 3u);
+    const BindingSlot& nested = result.bindings[2];
+    ASSERT_NE(nested.htmlOffset, std::string::npos);
+    EXPECT_EQ(result.html.compare(nested.htmlOffset, nested.htmlLength, "{{x}}"), 0);
+}
+
+TEST(RendererTests, KeyedListDiffMovesRowsInPlace) {
+    using JTML::ListEntry;
+    std::vector<ListEntry> before = {{"k:1", "a"}, {"k:2", "b"}, {"k:3", "c"}, {"k:4", "d"}};
+
+    // Last row to the front: one detach + re-attach, nothing re-created
+    std::vector<ListEntry> moved = {{"k:4", "d"}, {"k:1", "a"}, {"k:2", "b"}, {"k:3", "c"}};
+    auto ops = JTML::diffLists(before, moved);
+    ASSERT_EQ(ops.size(), 2u);
+    EXPECT_EQ(ops[0].kind, 'd');
+    EXPECT_EQ(ops[0].index, 3u);
+    EXPECT_EQ(ops[1].kind, 'a');
+    EXPECT_EQ(ops[1].index, 0u);
+    EXPECT_EQ(ops[1].key, "k:4");
+
+    // Same key with a new value is an update; a missing key is a remove
+    std::vector<ListEntry> edited = {{"k:1", "a"}, {"k:2", "B"}, {"k:4", "d"}, {"k:5", "e"}};
+    ops = JTML::diffLists(before, edited);
+    ASSERT_EQ(ops.size(), 3u);
+    EXPECT_EQ(ops[0].kind, 'r');
+    EXPECT_EQ(ops[0].index, 2u);
+    EXPECT_EQ(ops[1].kind, 'u');
+    EXPECT_EQ(ops[1].value, "B");
+    EXPECT_EQ(ops[2].kind, 'i');
+    EXPECT_EQ(ops[2].index, 3u);
+
+    EXPECT_TRUE(JTML::diffLists(before, before).empty());
+}
+
+TEST(TranspilerTests, WindowedForKeepsItsWindowSize) {
+    std::string code = R"JTML(
+        define rows = [1, 2, 3, 4, 5, 6]\\
+        element div\\
+            for (r in rows) window 2\\
+                show "row"\\
+            \\
+        #
+    )JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+
+    JtmlTranspiler compiler;
+    CompileResult result = compiler.compile(program);
+    ASSERT_EQ(result.bindings.size(), 1u);
+    EXPECT_EQ(result.bindings[0].kind, BindingKind::For);
+    EXPECT_EQ(result.bindings[0].windowSize, 2u);
+    EXPECT_NE(result.html.find("data-jtml-window=\"2\""), std::string::npos);
+
+    // A window converts only its own rows
+    auto rows = std::make_shared<JTML::VarValue>(std::string("abc"));
+    EXPECT_EQ(JTML::listLength(rows), 3u);
+    auto window = JTML::listEntriesOf(rows, 1, 5);
+    ASSERT_EQ(window.size(), 2u);
+    EXPECT_EQ(window[0].value, "b");
+    EXPECT_EQ(window[1].key, "v:c");
+}
+
+TEST(RendererTests, BinaryRecordsUseVarintBindingIds) {
+    std::string frame;
+    JTML::appendRecord(frame, JTML::WireOp::Content, 300, "hi");
+
+    // opcode, 300 as two varint bytes, length, value
+    ASSERT_EQ(frame.size(), 6u);
+    EXPECT_EQ(static_cast<uint8_t>(frame[0]), 0x01);
+    EXPECT_EQ(static_cast<uint8_t>(frame[1]), 0xAC);
+    EXPECT_EQ(static_cast<uint8_t>(frame[2]), 0x02);
+    EXPECT_EQ(static_cast<uint8_t>(frame[3]), 2);
+    EXPECT_EQ(frame.substr(4), "hi");
+
+    size_t pos = 1;
+    uint64_t id = 0;
+    ASSERT_TRUE(JTML::readVarint(frame, pos, id));
+    EXPECT_EQ(id, 300u);
+    EXPECT_EQ(pos, 3u);
+}
+
+TEST(RendererTests, StateJournalResumesOrFallsBackToSnapshot) {
+    JTML::StateJournal journal(/*maxEntries=*/3);
+    journal.storeSnapshot(0, "snapshot@0");
+    std::string snapshot;
+    ASSERT_TRUE(journal.cachedSnapshot(snapshot));
+    EXPECT_EQ(snapshot, "snapshot@0");
+
+    for (uint64_t v = 1; v <= 5; ++v) {
+        journal.record(v, "change " + std::to_string(v));
+    }
+    // Any change drops the cached snapshot
+    EXPECT_FALSE(journal.cachedSnapshot(snapshot));
+
+    std::vector<std::string> missed;
+    ASSERT_TRUE(journal.changesSince(3, missed));
+    EXPECT_EQ(missed, (std::vector<std::string>{"change 4", "change 5"}));
+
+    missed.clear();
+    EXPECT_TRUE(journal.changesSince(5, missed));
+    EXPECT_TRUE(missed.empty());
+
+    // Versions 1 and 2 were trimmed; a future version is not from this run
+    EXPECT_FALSE(journal.changesSince(1, missed));
+    EXPECT_FALSE(journal.changesSince(9, missed));
+
+    // A snapshot built before the latest change is not cached
+    journal.storeSnapshot(4, "stale");
+    EXPECT_FALSE(journal.cachedSnapshot(snapshot));
+}
+
+TEST(RendererTests, SnapshotIsPrecompressedOnce) {
+    std::string json = "{\"type\": \"populateBindings\", \"bindings\": {\"content\": {";
+    for (int i = 0; i < 100; ++i) {
+        json += "\"expr_" + std::to_string(i) + "\": \"same value\", ";
+    }
+    json += "\"last\": \"\"}}}";
+
+    std::string frame;
+#ifdef JTML_WITH_DEFLATE
+    ASSERT_TRUE(JTML::deflateFrame(json, frame));
+    EXPECT_EQ(static_cast<uint8_t>(frame[0]), static_cast<uint8_t>(JTML::WireOp::Deflated));
+    EXPECT_LT(frame.size(), json.size() / 4);
+#else
+    EXPECT_FALSE(JTML::deflateFrame(json, frame));
+    EXPECT_TRUE(frame.empty());
+    frame = "precompressed";
+#endif
+
+    // The journal hands the same compressed bytes to every connection
+    JTML::StateJournal journal;
+    journal.storeSnapshot(0, json, frame);
+    std::string snapshot, compressed;
+    ASSERT_TRUE(journal.cachedSnapshot(snapshot, &compressed));
+    EXPECT_EQ(compressed, frame);
+
+    journal.record(1, "{\"type\": \"updateBinding\", \"version\": 1}");
+    EXPECT_FALSE(journal.cachedSnapshot(snapshot, &compressed));
+}
+
+TEST(RendererTests, OutboundQueueAppliesBackpressurePolicy) {
+    using Queue = JTML::OutboundQueue<std::string>;
+    using Result = Queue::PushResult;
+    auto frame = [](const std::string& payload, const std::string& key = std::string()) {
+        return Queue::Frame{ std::make_shared<std::string>(payload), payload.size(), key };
+    };
+
+    // A broadcast pushes one shared message to every queue
+    Queue first, second;
+    Queue::Frame shared = frame("update");
+    first.push(shared);
+    second.push(shared);
+    Queue::Frame out;
+    ASSERT_TRUE(first.pop(out));
+    EXPECT_EQ(out.message, shared.message);
+
+    // Conflate: a newer value of the same binding replaces the queued one
+    // and moves behind what was queued after it
+    Queue conflating(JTML::BackpressurePolicy::Conflate, 3);
+    EXPECT_EQ(conflating.push(frame("a1", "c:a")), Result::Queued);
+    EXPECT_EQ(conflating.push(frame("patch")), Result::Queued);
+    EXPECT_EQ(conflating.push(frame("a2", "c:a")), Result::Conflated);
+    EXPECT_EQ(conflating.size(), 2u);
+    ASSERT_TRUE(conflating.pop(out));
+    EXPECT_EQ(*out.message, "patch");
+    ASSERT_TRUE(conflating.pop(out));
+    EXPECT_EQ(*out.message, "a2");
+    EXPECT_TRUE(conflating.empty());
+
+    // DropOldest: the oldest frames go, and the client is told to resync first
+    Queue dropping(JTML::BackpressurePolicy::DropOldest, 2);
+    dropping.push(frame("1"));
+    dropping.push(frame("2"));
+    EXPECT_EQ(dropping.push(frame("3")), Result::Dropped);
+    EXPECT_TRUE(dropping.takeResync());
+    EXPECT_FALSE(dropping.takeResync());
+    ASSERT_TRUE(dropping.pop(out));
+    EXPECT_EQ(*out.message, "2");
+    ASSERT_TRUE(dropping.pop(out));
+    EXPECT_EQ(*out.message, "3");
+    EXPECT_FALSE(dropping.pop(out));
+
+    // Disconnect: a full queue refuses the frame and keeps what it had
+    Queue strict(JTML::BackpressurePolicy::Disconnect, 4, 10);
+    EXPECT_EQ(strict.push(frame("12345678")), Result::Queued);
+    EXPECT_EQ(strict.push(frame("123")), Result::Overflow);
+    EXPECT_EQ(strict.size(), 1u);
+    EXPECT_EQ(strict.bytes(), 8u);
+}
+
+TEST(EnvironmentTests, ForkCopiesOnlyWhatItWrites) {
+    auto program = std::make_shared<JTML::Environment>(nullptr, 0);
+    JTML::CompositeKey count{ 0, "count" };
+    JTML::CompositeKey title{ 0, "title" };
+    JTML::CompositeKey items{ 0, "items" };
+    program->setVariable(count, std::make_shared<JTML::VarValue>(1.0));
+    program->setVariable(title, std::make_shared<JTML::VarValue>(std::string("shared")));
+    auto list = program->createReactiveArray(items);
+    list->push(std::make_shared<JTML::VarValue>(std::string("a")));
+    program->setVariable(items, std::make_shared<JTML::VarValue>(list));
+
+    auto first = program->fork(nullptr);
+    auto second = program->fork(nullptr);
+    EXPECT_TRUE(first->variables.empty());
+    EXPECT_EQ(&first->getBindings(), &program->getBindings());
+
+    // Untouched values are the program's own objects
+    EXPECT_EQ(first->getVariable(title), program->getVariable(title));
+
+    first->setVariable(count, std::make_shared<JTML::VarValue>(2.0));
+    EXPECT_EQ(first->getVariable(count)->toString(), "2");
+    EXPECT_EQ(second->getVariable(count)->toString(), "1");
+    EXPECT_EQ(program->getVariable(count)->toString(), "1");
+
+    // Lists change in place, so a fork works on its own copy
+    first->getVariable(items)->getArray()->push(std::make_shared<JTML::VarValue>(std::string("b")));
+    EXPECT_EQ(first->getVariable(items)->getArray()->size(), 2u);
+    EXPECT_EQ(second->peekVariable(items)->getArray()->size(), 1u);
+    EXPECT_EQ(program->getVariable(items)->getArray()->size(), 1u);
+
+    // Structure is only copied once a fork changes it
+    first->registerBinding(JTML::BindingInfo{ count, "expr_0", "", "content", nullptr });
+    EXPECT_NE(&first->getBindings(), &program->getBindings());
+    EXPECT_EQ(&second->getBindings(), &program->getBindings());
+    EXPECT_EQ(program->getBindings().count("count"), 0u);
+}
+
+TEST(InterpreterTests, InterpretersRunInParallelWithOwnLogs) {
+    // Nothing process-wide is shared: each logs to its own stream and
+    // neither blocks on the other
+    auto run = [](const std::string& name, std::ostringstream& log) {
+        Interpreter interpreter;
+        interpreter.setLogStreams(log, log);
+        for (int i = 0; i < 50; ++i) {
+            interpreter.interpret("define " + name + " = " + std::to_string(i) + "\\\\\nshow " + name + "\\\\\n");
+        }
+    };
+    std::ostringstream firstLog;
+    std::ostringstream secondLog;
+    std::thread first(run, "alpha", std::ref(firstLog));
+    std::thread second(run, "beta", std::ref(secondLog));
+    first.join();
+    second.join();
+
+    EXPECT_NE(firstLog.str().find("[SHOW] 49"), std::string::npos);
+    EXPECT_NE(secondLog.str().find("[SHOW] 49"), std::string::npos);
+    EXPECT_EQ(firstLog.str().find("beta"), std::string::npos);
+    EXPECT_EQ(secondLog.str().find("alpha"), std::string::npos);
+}
+
+TEST(InterpreterTests, SecondPageIsRejected) {
+    std::ostringstream log;
+    Interpreter interpreter;
+    interpreter.setLogStreams(log, log);
+    std::string page = "define x = 1\\\\\nelement div\\\\\nshow x\\\\\n#\n";
+    interpreter.interpret(page);
+    std::string value;
+    ASSERT_TRUE(interpreter.bindingValue(0, value));
+    EXPECT_EQ(value, "1");
+
+    // Statements alone keep the loaded page live
+    std::string update = "x = 2\\\\\n";
+    interpreter.interpret(update);
+    ASSERT_TRUE(interpreter.bindingValue(0, value));
+    EXPECT_EQ(value, "2");
+
+    // Another page would reuse slot 0 for a different binding
+    std::string other = "define y = 7\\\\\nelement p\\\\\nshow y\\\\\n#\n";
+    interpreter.interpret(other);
+    EXPECT_NE(log.str().find("already loaded"), std::string::npos);
+    ASSERT_TRUE(interpreter.bindingValue(0, value));
+    EXPECT_EQ(value, "2");
+}
+
+TEST(InterpreterTests, ForRowsShowTheirItem) {
+    std::string code = R"JTML(
+        define names = ["ann", "bob"]\\
+        define suffix = "!"\\
+        element div\\
+            for (n in names)\\
+                element span title=n\\
+                    show n + suffix\\
+                #
+            \\
+        #
+    )JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    JtmlTranspiler compiler;
+    CompileResult result = compiler.compile(program);
+
+    // The body's holes belong to the for slot; rows repeat no ids
+    ASSERT_EQ(result.bindings.size(), 1u);
+    ASSERT_EQ(result.bindings[0].rowHoles.size(), 2u);
+    EXPECT_EQ(result.bindings[0].rowHoles[0].kind, BindingKind::Attribute);
+    EXPECT_EQ(result.bindings[0].rowHoles[0].attribute, "title");
+    EXPECT_EQ(result.bindings[0].rowHoles[1].kind, BindingKind::Content);
+    EXPECT_NE(result.html.find("data-jtml-row-holes"), std::string::npos);
+    EXPECT_NE(result.html.find("<span data-jtml-hole-title=\"0\">"), std::string::npos);
+    EXPECT_NE(result.html.find("<div data-jtml-hole=\"1\">"), std::string::npos);
+    EXPECT_EQ(result.html.find("expr_"), std::string::npos);
+
+    // Each row's value is what its holes show, with the iterator bound
+    std::ostringstream log;
+    Interpreter interpreter;
+    interpreter.setLogStreams(log, log);
+    interpreter.interpret(code);
+    std::string value;
+    ASSERT_TRUE(interpreter.bindingValue(0, value));
+    auto list = nlohmann::json::parse(value);
+    ASSERT_EQ(list["items"].size(), 2u);
+    EXPECT_EQ(list["items"][0], "[\"ann\",\"ann!\"]");
+    EXPECT_EQ(list["items"][1], "[\"bob\",\"bob!\"]");
+    EXPECT_EQ(list["keys"][0], "v:ann");
+
+    // A change to what the holes read besides the item re-renders the rows
+    std::string update = "suffix = \"?\"\\\\\n";
+    interpreter.interpret(update);
+    ASSERT_TRUE(interpreter.bindingValue(0, value));
+    EXPECT_EQ(nlohmann::json::parse(value)["items"][1], "[\"bob\",\"bob?\"]");
+}
+
+TEST(WorkerPoolTests, PinnedWorkRunsInOrderOnOneThread) {
+    JTML::WorkerPool pool(2);
+    auto first = pool.pin();
+    auto second = pool.pin();
+    EXPECT_NE(first, second);
+
+    std::vector<int> order;
+    std::set<std::thread::id> threads;
+    for (int i = 0; i < 100; ++i) {
+        pool.post(first, [&order, &threads, i] {
+            order.push_back(i);
+            threads.insert(std::this_thread::get_id());
+        });
+    }
+    pool.drain(first);
+    ASSERT_EQ(order.size(), 100u);
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+    EXPECT_EQ(threads.size(), 1u);
+
+    // A released worker is the next one handed out
+    pool.unpin(first);
+    EXPECT_EQ(pool.pin(), first);
+}
+
+TEST(WorkerPoolTests, MpscQueueKeepsEachProducersOrder) {
+    JTML::MpscQueue<std::pair<int, int>> queue;
+    const int producers = 4;
+    const int perProducer = 10000;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p] {
+            for (int i = 0; i < perProducer; ++i) {
+                queue.push({ p, i });
+            }
+        });
+    }
+
+    // Consume while they push: every item arrives once, each producer's in order
+    std::vector<int> next(producers, 0);
+    int received = 0;
+    std::pair<int, int> item;
+    while (received < producers * perProducer) {
+        if (!queue.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(item.second, next[item.first]);
+        ++next[item.first];
+        ++received;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_FALSE(queue.pop(item));
+}
+
+TEST(TranspilerTests, EventModifiersBecomeSlotPolicies) {
+    std::string code = R"JTML(
+        element div onMouseOver.throttle(20)=track(), onInput.debounce(300)=search(), onClick.coalesce=add(), onScroll=scrolled()\\
+            show "panel"\\
+        #
+    )JTML";
+    Lexer lexer(code);
+    Parser parser(lexer);
+    auto program = parser.parseProgram();
+    ASSERT_TRUE(parser.getErrors().empty());
+
+    JtmlTranspiler compiler;
+    CompileResult result = compiler.compile(program);
+    ASSERT_EQ(result.bindings.size(), 4u);
+    EXPECT_EQ(result.bindings[0].eventPolicy.kind, EventPolicy::Kind::Throttle);
+    EXPECT_EQ(result.bindings[0].eventPolicy.value, 20u);
+    EXPECT_EQ(result.bindings[1].eventPolicy.kind, EventPolicy::Kind::Debounce);
+    EXPECT_EQ(result.bindings[1].eventPolicy.value, 300u);
+    EXPECT_EQ(result.bindings[2].eventPolicy.kind, EventPolicy::Kind::Coalesce);
+    EXPECT_EQ(result.bindings[3].eventPolicy.kind, EventPolicy::Kind::None);
+
+    // Modifiers only apply to events
+    std::string badCode = "element div class.throttle(5)=x\\\\\n#\n";
+    Lexer badLexer(badCode);
+    Parser badParser(badLexer);
+    badParser.parseProgram();
+    EXPECT_FALSE(badParser.getErrors().empty());
+}
+
+TEST(RendererTests, EventGateRunsOnlyTheLatestEvent) {
+    std::vector<JTML::EventGate::Task> queued;
+    std::vector<std::pair<uint32_t, JTML::EventGate::Task>> timers;
+    std::vector<std::string> ran;
+    JTML::EventGate gate(
+        [&queued](JTML::EventGate::Task task) { queued.push_back(std::move(task)); },
+        [&timers](uint32_t ms, JTML::EventGate::Task task) { timers.emplace_back(ms, std::move(task)); },
+        [&ran](JTML::EventGate::Source, const std::string& msg) { ran.push_back(msg); });
+    gate.setPolicy("attr_1", EventPolicy{ EventPolicy::Kind::Coalesce, 0 });
+    gate.setPolicy("attr_2", EventPolicy{ EventPolicy::Kind::Throttle, 10 });
+    gate.setPolicy("attr_3", EventPolicy{ EventPolicy::Kind::Debounce, 1 });
+
+    EXPECT_FALSE(gate.offer(1, "attr_9", "plain"));
+
+    // Coalesce: three events while the first run is queued => one run
+    EXPECT_TRUE(gate.offer(1, "attr_1", "move 1"));
+    gate.offer(1, "attr_1", "move 2");
+    gate.offer(1, "attr_1", "move 3");
+    ASSERT_EQ(queued.size(), 1u);
+    queued[0]();
+    EXPECT_EQ(ran, std::vector<std::string>{ "move 3" });
+
+    // Throttle: the first runs at once, the next waits for its slot
+    queued.clear();
+    ran.clear();
+    gate.offer(1, "attr_2", "scroll 1");
+    ASSERT_EQ(queued.size(), 1u);
+    queued[0]();
+    gate.offer(1, "attr_2", "scroll 2");
+    gate.offer(1, "attr_2", "scroll 3");
+    ASSERT_EQ(timers.size(), 1u);
+    EXPECT_LE(timers[0].first, 100u);
+    timers[0].second();
+    EXPECT_EQ(ran, (std::vector<std::string>{ "scroll 1", "scroll 3" }));
+
+    // Debounce: runs once the events stop; other connections are separate
+    timers.clear();
+    ran.clear();
+    gate.offer(1, "attr_3", "typed a");
+    gate.offer(2, "attr_3", "other");
+    gate.offer(1, "attr_3", "typed ab");
+    ASSERT_EQ(timers.size(), 2u);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    timers[0].second();
+    EXPECT_EQ(ran, std::vector<std::string>{ "typed ab" });
+
+    // A closed connection's waiting event never runs
+    gate.drop(2);
+    timers[1].second();
+    EXPECT_EQ(ran.size(), 1u);
+    EXPECT_EQ(gate.waitingCount(), 3u);
+}
+
+TEST(RendererTests, TransactionHandsOverOneConflatedBatch) {
+    JTML::Renderer renderer;
+    renderer.setBinaryWanted(true);
+    std::vector<std::string> sent;
+    renderer.setFrontendCallback([&sent](const JTML::Renderer::Message& message) {
+        sent.push_back(message.text);
+    });
+
+    renderer.beginTransaction();
+    renderer.sendBindingUpdate("expr_1", "1", 0);
+    renderer.sendAttributeUpdate("elem_1", "class", "wide", 1);
+    renderer.sendBindingUpdate("expr_1", "2", 0);
+    EXPECT_TRUE(sent.empty());
+    JTML::Renderer::Batch batch = renderer.endTransaction();
+
+    // expr_1 once, with its last value, after the attribute
+    ASSERT_EQ(batch.updates.size(), 2u);
+    EXPECT_NE(batch.updates[0].find("\"wide\""), std::string::npos);
+    EXPECT_NE(batch.updates[1].find("\"value\": \"2\""), std::string::npos);
+    EXPECT_FALSE(batch.binary.empty());
+    // Every change is still journaled for resuming clients
+    EXPECT_EQ(renderer.journal().version(), 3u);
+
+    renderer.sendBindingUpdate("expr_1", "3", 0);
+    EXPECT_EQ(sent.size(), 1u);
+}
+
+TEST(RendererTests, OutboundQueuePopsByLane) {
+    using Queue = JTML::OutboundQueue<std::string>;
+    auto frame = [](const std::string& payload, JTML::Lane lane, const std::string& key = std::string()) {
+        return Queue::Frame{ std::make_shared<std::string>(payload), payload.size(), key, lane };
+    };
+    Queue::Frame out;
+
+    // A reply to the client's input goes ahead of updates, and both ahead
+    // of a snapshot queued before them
+    Queue queue;
+    queue.push(frame("snapshot", JTML::Lane::Bulk));
+    queue.push(frame("a1", JTML::Lane::Updates, "c:a"));
+    queue.push(frame("ack", JTML::Lane::Interactive));
+    ASSERT_TRUE(queue.pop(out));
+    EXPECT_EQ(*out.message, "ack");
+    ASSERT_TRUE(queue.pop(out));
+    EXPECT_EQ(*out.message, "a1");
+    ASSERT_TRUE(queue.pop(out));
+    EXPECT_EQ(*out.message, "snapshot");
+
+    // ...but never ahead of a list patch it may build on
+    queue.push(frame("patch", JTML::Lane::Updates));
+    queue.push(frame("ack", JTML::Lane::Interactive));
+    EXPECT_EQ(queue.size(JTML::Lane::Interactive), 0u);
+    ASSERT_TRUE(queue.pop(out));
+    EXPECT_EQ(*out.message, "patch");
+    ASSERT_TRUE(queue.pop(out));
+    EXPECT_EQ(*out.message, "ack");
+
+    // Past the limit, the lowest lane gives way first
+    Queue dropping(JTML::BackpressurePolicy::DropOldest, 2);
+    dropping.push(frame("update", JTML::Lane::Updates, "c:a"));
+    dropping.push(frame("snapshot", JTML::Lane::Bulk));
+    EXPECT_EQ(dropping.push(frame("ack", JTML::Lane::Interactive)), Queue::PushResult::Dropped);
+    EXPECT_EQ(dropping.size(JTML::Lane::Bulk), 0u);
+    EXPECT_EQ(dropping.size(), 2u);
+
+    // A large payload is cut into pieces that reassemble in order
+    std::string payload(10000, 'x');
+    payload[9999] = 'y';
+    std::vector<std::string> chunks = JTML::chunkFrames(payload, false, 7, 4096);
+    ASSERT_EQ(chunks.size(), 3u);
+    std::string joined;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        size_t pos = 1;
+        uint64_t stream = 0, index = 0, count = 0;
+        ASSERT_EQ(static_cast<JTML::WireOp>(chunks[i][0]), JTML::WireOp::Chunk);
+        ASSERT_TRUE(JTML::readVarint(chunks[i], pos, stream));
+        ASSERT_TRUE(JTML::readVarint(chunks[i], pos, index));
+        ASSERT_TRUE(JTML::readVarint(chunks[i], pos, count));
+        EXPECT_EQ(stream, 7u);
+        EXPECT_EQ(index, i);
+        EXPECT_EQ(count, 3u);
+        EXPECT_EQ(chunks[i][pos], 0);  // JSON text
+        joined += chunks[i].substr(pos + 1);
+    }
+    EXPECT_EQ(joined, payload);
+}
+
+TEST(RendererTests, UnchangedValuesAreNotResent) {
+    JTML::Renderer renderer;
+    std::vector<JTML::Renderer::Message> sent;
+    renderer.setFrontendCallback([&sent](const JTML::Renderer::Message& message) {
+        sent.push_back(message);
+    });
+
+    // Each connection is skipped for a value it already has
+    JTML::SentValues sentValues;
+    sentValues.open(1);
+    sentValues.open(2);
+    auto deliver = [&](const std::vector<JTML::SentValues::Source>& to) {
+        return sentValues.changed(to, 0, sent.back().value);
+    };
+    renderer.sendBindingUpdate("expr_1", "1", 0);
+    EXPECT_EQ(deliver({ 1 }).size(), 1u);
+    renderer.sendBindingUpdate("expr_1", "1", 0);
+    EXPECT_TRUE(deliver({ 1 }).empty());
+    // Connection 2 connected after the first send: it still gets it
+    EXPECT_EQ(deliver({ 1, 2 }), std::vector<JTML::SentValues::Source>{ 2 });
+    // Stamped texts differ; the values compared are the unstamped ones
+    EXPECT_NE(sent[0].text, sent[1].text);
+    renderer.sendBindingUpdate("expr_1", "2", 0);
+    EXPECT_EQ(deliver({ 1, 2 }).size(), 2u);
+
+    // After a snapshot (or a patch of the slot) the next value goes out
+    sentValues.forget(1);
+    sentValues.forget({ 2 }, { 0 });
+    EXPECT_EQ(deliver({ 1, 2 }).size(), 2u);
+    const JTML::SentValues::Stats spared = sentValues.drop(1);
+    EXPECT_EQ(spared.unchanged, 2u);
+    EXPECT_GT(spared.unchangedBytes, 0u);
+    EXPECT_EQ(sentValues.drop(1).unchanged, 0u);
+
+    // Within a batch, a binding set twice goes out once
+    renderer.beginTransaction();
+    renderer.sendBindingUpdate("expr_1", "3");
+    renderer.sendBindingUpdate("expr_1", "4");
+    renderer.sendBindingUpdate("expr_1", "4");
+    EXPECT_EQ(renderer.endTransaction().updates.size(), 1u);
+
+    JTML::Renderer::Stats stats = renderer.stats();
+    EXPECT_EQ(stats.sent, 4u);
+    EXPECT_EQ(stats.conflated, 2u);
+
+    // The queue counts what it conflated on the connection's behalf
+    using Queue = JTML::OutboundQueue<std::string>;
+    Queue queue;
+    queue.push(Queue::Frame{ std::make_shared<std::string>("a1"), 2, "c:a" });
+    queue.push(Queue::Frame{ std::make_shared<std::string>("a2"), 2, "c:a" });
+    EXPECT_EQ(queue.stats().conflated, 1u);
+    EXPECT_EQ(queue.stats().conflatedBytes, 2u);
+}
+
+TEST(RendererTests, CallbackRunsWithoutTheRendererLock) {
+    JTML::Renderer renderer;
+    std::vector<std::string> sent;
+    renderer.setFrontendCallback([&](const JTML::Renderer::Message& message) {
+        sent.push_back(message.text);
+        // Re-entering the renderer neither deadlocks nor jumps the queue
+        if (sent.size() == 1) {
+            EXPECT_EQ(renderer.stats().sent, 1u);
+            renderer.sendBindingUpdate("expr_2", "b");
+            EXPECT_EQ(sent.size(), 1u);
+        }
+    });
+    renderer.sendBindingUpdate("expr_1", "a");
+    ASSERT_EQ(sent.size(), 2u);
+    EXPECT_NE(sent[0].find("expr_1"), std::string::npos);
+    EXPECT_NE(sent[1].find("expr_2"), std::string::npos);
+}
+
+TEST(RendererTests, InterestIndexRoutesSlotsToTheirConnections) {
+    JTML::InterestIndex interest;
+    auto sorted = [](std::vector<JTML::InterestIndex::Source> sources) {
+        std::sort(sources.begin(), sources.end());
+        return sources;
+    };
+    using Sources = std::vector<JTML::InterestIndex::Source>;
+
+    // Until it says what it shows, a connection gets everything
+    interest.open(1);
+    interest.open(2);
+    EXPECT_EQ(sorted(interest.audience({ 5 })), (Sources{ 1, 2 }));
+
+    EXPECT_TRUE(interest.update(1, { 5, 6 }, {}));
+    EXPECT_FALSE(interest.update(1, { 7 }, { 6 }));
+    EXPECT_TRUE(interest.update(2, { 6 }, {}));
+    EXPECT_EQ(interest.audience({ 5 }), (Sources{ 1 }));
+    EXPECT_EQ(interest.audience({ 6 }), (Sources{ 2 }));
+    EXPECT_TRUE(interest.audience({ 8 }).empty());
+    EXPECT_EQ(sorted(interest.audience({ 5, 6, 7 })), (Sources{ 1, 2 }));
+    EXPECT_TRUE(interest.wants(1, 7));
+    EXPECT_FALSE(interest.wants(1, 6));
+
+    interest.drop(1);
+    EXPECT_TRUE(interest.audience({ 5 }).empty());
+    EXPECT_FALSE(interest.wants(1, 5));
+
+    // The renderer names the slot of each change it sends
+    JTML::Renderer renderer;
+    std::vector<uint32_t> slots;
+    renderer.setFrontendCallback([&slots](const JTML::Renderer::Message& message) {
+        slots.push_back(message.bindingId);
+    });
+    renderer.sendBindingUpdate("expr_1", "1", 3);
+    renderer.sendBatchBindingUpdates({ { "expr_2", "2" } }, {});
+    EXPECT_EQ(slots, (std::vector<uint32_t>{ 3, JTML::NO_BINDING_ID }));
+}
+
+TEST(RendererTests, LongContentIsSentAsSplices) {
+    JTML::Renderer renderer;
+    std::vector<JTML::Renderer::Message> sent;
+    renderer.setFrontendCallback([&sent](const JTML::Renderer::Message& message) {
+        sent.push_back(message);
+    });
+
+    const std::string log(JTML::Renderer::SPLICE_MIN_BYTES, 'a');
+    renderer.sendBindingUpdate("expr_1", log, 0);
+    renderer.sendBindingUpdate("expr_1", log + "line \xC3\xA9\n", 0);
+    renderer.sendBindingUpdate("expr_1", log + "line \xC3\xA9\n", 0);
+    renderer.sendBindingUpdate("expr_1", std::string(JTML::Renderer::SPLICE_MIN_BYTES, 'b'), 0);
+    ASSERT_EQ(sent.size(), 3u);
+
+    // Appending sends just the new line, against the text it extends;
+    // tracked content never conflates, as each splice builds on the last
+    auto splice = nlohmann::json::parse(sent[1].text);
+    EXPECT_EQ(splice["type"], "spliceBinding");
+    EXPECT_EQ(splice["at"], log.size());
+    EXPECT_EQ(splice["remove"], 0u);
+    EXPECT_EQ(splice["insert"], "line \xC3\xA9\n");
+    EXPECT_EQ(splice["length"], log.size());
+    EXPECT_EQ(splice["base"], JTML::utf16Hash(log));
+    EXPECT_TRUE(sent[1].key.empty());
+
+    // A rewrite goes out whole
+    EXPECT_EQ(nlohmann::json::parse(sent[2].text)["type"], "updateBinding");
+
+    JTML::Renderer::Stats stats = renderer.stats();
+    EXPECT_EQ(stats.spliced, 1u);
+    EXPECT_EQ(stats.unchanged, 1u);
+    EXPECT_GT(stats.splicedBytesSaved, 0u);
+
+    // Offsets count UTF-16 code units, like the client's strings
+    JTML::TextSplice edit = JTML::diffText("\xF0\x9F\x98\x80 one", "\xF0\x9F\x98\x80 two");
+    EXPECT_EQ(edit.at, 3u);
+    EXPECT_EQ(edit.remove, 3u);
+    EXPECT_EQ(edit.insert, "two");
+}